@@ -0,0 +1,147 @@
+#include "libmna.h"
+#include "allocationcounter.h"
+#include "threadpool.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+
+/* Check, that steps of execution do not allocate on the heap (see AllocationCounter).
+ *
+ * allocationcheck [--steps=N]
+ *
+ * Every combination of matching mode and word representation, with and without cycle detection
+ * and the parallel search, executes the algorithms for N and for 10N steps; the heap allocations
+ * of the whole execution (start of the word included) must be the same for both runs,
+ * otherwise steps allocate. Exits with 1 if some combination allocates.
+ * Built with COUNT_ALLOCATIONS only (allocationcheck.pro). */
+
+
+#define SEARCH_THREADS  3
+#define WORD_SIZE       256
+
+
+/* Binary counters of fixed width, that never stop and never repeat a word for N steps.
+ * The source word alternates the bits (system symbols are written in it, so the instructions,
+ * that look for "@", match from the first step), so runs of the word are as many as they may get
+ * from the first step. The second counter grows and shrinks the word by one symbol
+ * on every carry and erases the overflow. */
+struct Algorithm {
+    const char *name;
+    const char *instructions;
+};
+
+static const Algorithm ALGORITHMS[] = {
+    { "counter",            "0c->10\n1c->c0\n!c->!0\n1@->c@\n0@->1@\n" },
+    { "inserting counter",  "0c->1\n1c->c0\n!c->!\n1@->c0@\n0@->1@\n" }
+};
+
+
+struct Engine {
+    const char *name;
+    Execution::MatchingMode matchingMode;
+    Execution::WordRepresentation wordRepresentation;
+};
+
+static const Engine ENGINES[] = {
+    { "sequential, gap buffer",  Execution::SequentialMatching,  Execution::GapBufferWord },
+    { "automaton, gap buffer",   Execution::AutomatonMatching,   Execution::GapBufferWord },
+    { "incremental, gap buffer", Execution::IncrementalMatching, Execution::GapBufferWord },
+    { "sequential, run-length",  Execution::SequentialMatching,  Execution::RunLengthWord },
+    { "automaton, run-length",   Execution::AutomatonMatching,   Execution::RunLengthWord },
+    { "incremental, run-length", Execution::IncrementalMatching, Execution::RunLengthWord }
+};
+
+
+static bool countAllocations(const RuleSet &rules, const Execution::Options &options, std::size_t steps,
+                             uint64_t &count) {
+
+    /* Counts heap allocations of the execution of @steps steps.
+     * Returns false if execution stopped before. */
+
+    const uint64_t initialCount = AllocationCounter::count();
+
+    bool isRunning;
+    {
+        Execution execution(rules, options);
+        execution.start(rules.sourceWord(), rules.sourceWordSize());
+        isRunning = execution.run(steps) && execution.stepsCount() == steps;
+    }
+
+    count = AllocationCounter::count() - initialCount;
+    return isRunning;
+}
+
+
+int main(int argc, char* argv[]) {
+    std::size_t steps = 10000;
+
+    for (int i=1; i<argc; ++i) {
+        if (std::strncmp(argv[i], "--steps=", 8) == 0)
+            steps = std::strtoul(argv[i] + 8, 0, 10);
+        else {
+            std::cout << "Unknown argument \"" << argv[i] << "\". Process stopped." << std::endl;
+            return 1;
+        }
+    }
+
+    if (! AllocationCounter::isEnabled()) {
+        std::cout << "Allocations are not counted: the check must be built with COUNT_ALLOCATIONS." << std::endl;
+        return 1;
+    }
+
+    ThreadPool searchPool(SEARCH_THREADS);
+    std::string sourceWord = "!";
+    for (std::size_t i=0; i<WORD_SIZE; ++i)
+        sourceWord += i % 2 ? '1' : '0';
+    sourceWord += '@';
+
+    bool isPassed = true;
+
+    for (std::size_t a=0; a<sizeof(ALGORITHMS)/sizeof(ALGORITHMS[0]); ++a) {
+        MarkovAlgorithm algorithm;
+        algorithm.setSourceWordOnly(true);
+        if (! algorithm.parse(std::string("T={0,1,c}\nV=") + sourceWord + "\n" + ALGORITHMS[a].instructions)) {
+            std::cout << "Algorithm \"" << ALGORITHMS[a].name << "\" is not loaded:" << std::endl
+                      << algorithm.messages() << std::endl;
+            return 1;
+        }
+
+        for (std::size_t e=0; e<sizeof(ENGINES)/sizeof(ENGINES[0]); ++e)
+        for (int isDetectingCycles=0; isDetectingCycles<2; ++isDetectingCycles)
+        for (int isParallel=0; isParallel<2; ++isParallel) {
+            Execution::Options options;
+            options.matchingMode = ENGINES[e].matchingMode;
+            options.wordRepresentation = ENGINES[e].wordRepresentation;
+            options.isDetectingCycles = isDetectingCycles;
+            if (isParallel)
+                options.searchPool = &searchPool;
+
+            /* The first run grows the queues of the search pool, which outlives the executions. */
+            uint64_t shortCount = 0;
+            uint64_t longCount = 0;
+            const bool isExecuted = countAllocations(algorithm.rules(), options, steps, shortCount)
+                                 && countAllocations(algorithm.rules(), options, steps, shortCount)
+                                 && countAllocations(algorithm.rules(), options, steps * 10, longCount);
+            const bool isAllocating = shortCount != longCount;
+
+            std::cout << ALGORITHMS[a].name << ", " << ENGINES[e].name
+                      << (isDetectingCycles ? ", cycles" : "") << (isParallel ? ", parallel search" : "")
+                      << ": " << shortCount << " allocations for " << steps << " steps, "
+                      << longCount << " for " << steps * 10 << " steps";
+            if (! isExecuted)
+                std::cout << " - FAIL: execution stopped before";
+            else if (isAllocating)
+                std::cout << " - FAIL: steps allocate";
+            std::cout << std::endl;
+
+            if (! isExecuted || isAllocating)
+                isPassed = false;
+        }
+    }
+
+    std::cout << (isPassed ? "No allocations in steps." : "Steps allocate.") << std::endl;
+    return isPassed ? 0 : 1;
+}
@@ -0,0 +1,52 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt
+CONFIG += c++11 thread
+
+TARGET = allocationcheck
+
+SOURCES += allocationcheck.cpp \
+    allocationcounter.cpp \
+    libmna.cpp \
+    alphabet.cpp \
+    matcher.cpp \
+    matchindex.cpp \
+    word.cpp \
+    ruleset.cpp \
+    mappedfile.cpp \
+    patternsearch.cpp \
+    execution.cpp \
+    threadpool.cpp \
+    cycledetector.cpp \
+    watchdog.cpp \
+    rulesloader.cpp \
+    rulesanalyzer.cpp \
+    profiler.cpp \
+    checkpoint.cpp \
+    deltatrace.cpp
+
+HEADERS += \
+    allocationcounter.h \
+    libmna.h \
+    alphabet.h \
+    matcher.h \
+    matchindex.h \
+    word.h \
+    ruleset.h \
+    mappedfile.h \
+    patternsearch.h \
+    execution.h \
+    threadpool.h \
+    cycledetector.h \
+    rollinghash.h \
+    fnvhash.h \
+    watchdog.h \
+    rulesloader.h \
+    rulesanalyzer.h \
+    profiler.h \
+    checkpoint.h \
+    deltatrace.h
+
+DEFINES += LINUX
+DEFINES += NDEBUG
+DEFINES += COUNT_ALLOCATIONS
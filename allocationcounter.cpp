@@ -0,0 +1,107 @@
+#include "allocationcounter.h"
+
+#ifdef COUNT_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+
+namespace {
+
+std::atomic<uint64_t> allocationsCount(0);
+
+
+void* allocate(std::size_t size) {
+
+    /* Allocates @size bytes as the default operator new does, and counts the allocation. */
+
+    allocationsCount.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0)
+        size = 1;
+
+    for (;;) {
+        if (void *memory = std::malloc(size))
+            return memory;
+
+        std::new_handler handler = std::get_new_handler();
+        if (! handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+}
+
+
+void* operator new(std::size_t size) {
+    return allocate(size);
+}
+
+
+void* operator new[](std::size_t size) {
+    return allocate(size);
+}
+
+
+void* operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return allocate(size);
+    }
+    catch (const std::bad_alloc &) {
+        return 0;
+    }
+}
+
+
+void* operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return allocate(size);
+    }
+    catch (const std::bad_alloc &) {
+        return 0;
+    }
+}
+
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+
+void operator delete[](void *memory) noexcept {
+    std::free(memory);
+}
+
+
+void operator delete(void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+
+void operator delete[](void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+
+bool AllocationCounter::isEnabled() {
+    return true;
+}
+
+
+uint64_t AllocationCounter::count() {
+    return allocationsCount.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool AllocationCounter::isEnabled() {
+    return false;
+}
+
+
+uint64_t AllocationCounter::count() {
+    return 0;
+}
+
+#endif
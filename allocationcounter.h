@@ -0,0 +1,18 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <stdint.h>
+
+
+/* Counter of heap allocations of the process, to check that steps of execution do not allocate.
+ * Counting replaces the global operator new, so it is compiled only into the build
+ * with COUNT_ALLOCATIONS defined (qmake CONFIG+=count_allocations);
+ * in other builds isEnabled() is false and count() is always 0. */
+class AllocationCounter {
+public:
+    static bool isEnabled();
+    static uint64_t count();
+};
+
+
+#endif // ALLOCATIONCOUNTER_H
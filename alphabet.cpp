@@ -0,0 +1,279 @@
+#include "alphabet.h"
+
+#include <assert.h>
+
+
+#define FIRST_WIDE_UNIT 0x80
+
+
+const std::size_t Alphabet::MAX_WIDE_SYMBOLS;
+const std::size_t Alphabet::NO_CODE;
+
+
+Alphabet::Alphabet() :
+    mDeclaredCount(0), mWideCount(0) {
+
+    for (std::size_t i=0; i<256; ++i)
+        mCodes[i] = NO_CODE;
+}
+
+
+bool Alphabet::addSymbol(const char *symbol, std::size_t length) {
+
+    /* Tries to add new symbol (@length bytes of UTF-8 text) to the alphabet.
+     * If the symbol is already exists, or there is no free unit for it - returns False,
+     * otherwise - returns True. */
+
+    std::size_t code = intern(symbol, length);
+    if (code == NO_CODE || mIsDeclared[code])
+        return false;
+
+    mIsDeclared[code] = true;
+    ++mDeclaredCount;
+    return true;
+}
+
+
+bool Alphabet::addSymbol(char symbol) {
+    return addSymbol(&symbol, 1);
+}
+
+
+bool Alphabet::isSymbolPresent(const char *symbol, std::size_t length) const {
+
+    /* Returns True if symbol "symbol" is in the alphabet.
+     * Otherwise -returns False. */
+
+    std::size_t code = find(symbol, length);
+    return code != NO_CODE && mIsDeclared[code];
+}
+
+
+bool Alphabet::isSymbolPresent(char symbol) const {
+    return isSymbolPresent(&symbol, 1);
+}
+
+
+std::size_t Alphabet::symbolsCount() const {
+    return mDeclaredCount;
+}
+
+
+std::string Alphabet::symbols() const {
+
+    /* Returns UTF-8 text of all interned symbols in the order of their addition.
+     * assign() restores the same units from it. */
+
+    std::string text;
+    for (std::size_t i=0; i<mSymbols.size(); ++i)
+        text += mSymbols[i];
+    return text;
+}
+
+
+void Alphabet::assign(const char *symbols, std::size_t size) {
+
+    /* Replaces the alphabet by symbols of text @symbols, returned by symbols(). */
+
+    *this = Alphabet();
+    for (std::size_t pos=0; pos<size; ) {
+        std::size_t length = symbolLength(symbols + pos, size - pos);
+        addSymbol(symbols + pos, length);
+        pos += length;
+    }
+}
+
+
+bool Alphabet::encode(const char *symbol, std::size_t length, char &unit) {
+
+    /* Writes to @unit the byte, that stands for the symbol in words and rules.
+     * Symbol, that is absent in the alphabet, is interned without adding to it.
+     * Returns false if there is no free unit for the symbol. */
+
+    std::size_t code = intern(symbol, length);
+    if (code == NO_CODE)
+        return false;
+
+    unit = mUnits[code];
+    return true;
+}
+
+
+bool Alphabet::encode(const std::string &text, std::string &units) const {
+    return encode(text.data(), text.size(), units);
+}
+
+
+bool Alphabet::encode(const char *text, std::size_t size, std::string &units) const {
+
+    /* Writes units of @size bytes of UTF-8 @text to @units.
+     * Returns false if @text contains multi-byte symbol, that was never interned. */
+
+    units.clear();
+    for (std::size_t pos=0; pos<size; ) {
+        std::size_t length = symbolLength(text + pos, size - pos);
+        if (length == 1 && (unsigned char)text[pos] < FIRST_WIDE_UNIT)
+            units.push_back(text[pos]);
+        else {
+            std::size_t code = find(text + pos, length);
+            if (code == NO_CODE)
+                return false;
+            units.push_back(mUnits[code]);
+        }
+        pos += length;
+    }
+
+    return true;
+}
+
+
+bool Alphabet::findUnit(const char *symbol, std::size_t length, char &unit) const {
+
+    /* Writes to @unit the byte of the symbol without interning it.
+     * Returns false if the symbol was never interned. */
+
+    std::size_t code = find(symbol, length);
+    if (code == NO_CODE)
+        return false;
+
+    unit = mUnits[code];
+    return true;
+}
+
+
+void Alphabet::decode(const char *units, std::size_t size, std::string &text) const {
+
+    /* Appends UTF-8 text of @size @units to @text. */
+
+    for (std::size_t i=0; i<size; ++i) {
+        unsigned char unit = (unsigned char)units[i];
+        if (unit >= FIRST_WIDE_UNIT && mCodes[unit] != NO_CODE)
+            text += mSymbols[mCodes[unit]];
+        else
+            text.push_back(units[i]);
+    }
+}
+
+
+void Alphabet::printColumn(std::ostream &stream, const char *units, std::size_t size, std::size_t width) const {
+
+    /* Prints text of @size @units, aligned to the left side of the column with @width symbols
+     * (tables of instructions). */
+
+    if (hasWideSymbols()) {
+        std::string text;
+        decode(units, size, text);
+        stream << text;
+    }
+    else
+        stream.write(units, size);
+
+    for (; size < width; ++size)
+        stream.put(' ');
+}
+
+
+bool Alphabet::hasWideSymbols() const {
+
+    /* Returns true if some symbols are not ASCII, so units must be decoded for output. */
+
+    return mWideCount > 0;
+}
+
+
+const std::string& Alphabet::wideSymbol(std::size_t index) const {
+
+    /* Returns UTF-8 text of the symbol with unit 0x80 + @index. */
+
+#ifndef NDEBUG
+    assert(index < mWideCount);
+#endif
+
+    return mSymbols[mCodes[FIRST_WIDE_UNIT + index]];
+}
+
+
+std::size_t Alphabet::wideSymbolsCount() const {
+    return mWideCount;
+}
+
+
+std::size_t Alphabet::symbolLength(const char *text, std::size_t size) {
+
+    /* Returns length in bytes of UTF-8 symbol at the beginning of @text.
+     * Invalid sequences are taken by one byte, so text in other encodings is read byte by byte. */
+
+
+#ifndef NDEBUG
+    assert(size > 0);
+#endif
+
+    unsigned char lead = (unsigned char)text[0];
+    std::size_t length = 1;
+    if (lead >= 0xC2 && lead <= 0xDF)
+        length = 2;
+    else if (lead >= 0xE0 && lead <= 0xEF)
+        length = 3;
+    else if (lead >= 0xF0 && lead <= 0xF4)
+        length = 4;
+
+    if (length > size)
+        return 1;
+    for (std::size_t i=1; i<length; ++i)
+        if (((unsigned char)text[i] & 0xC0) != 0x80)
+            return 1;
+
+    return length;
+}
+
+
+bool Alphabet::isAscii(const char *text, std::size_t size) {
+
+    /* Returns true if @size bytes of @text are ASCII, so the alphabet without wide symbols
+     * can take them as units (other bytes are never its symbols, see encode()). */
+
+    for (std::size_t i=0; i<size; ++i)
+        if ((unsigned char)text[i] >= FIRST_WIDE_UNIT)
+            return false;
+    return true;
+}
+
+
+std::size_t Alphabet::intern(const char *symbol, std::size_t length) {
+
+    /* Returns code of the symbol, adding it to the table if it is new.
+     * Returns NO_CODE if all wide units are taken. */
+
+    std::size_t code = find(symbol, length);
+    if (code != NO_CODE)
+        return code;
+
+    unsigned char unit = (unsigned char)symbol[0];
+    if (length > 1 || unit >= FIRST_WIDE_UNIT) {
+        if (mWideCount == MAX_WIDE_SYMBOLS)
+            return NO_CODE;
+
+        unit = (unsigned char)(FIRST_WIDE_UNIT + mWideCount++);
+        mWideSymbols[std::string(symbol, length)] = mSymbols.size();
+    }
+
+    code = mSymbols.size();
+    mCodes[unit] = code;
+    mSymbols.push_back(std::string(symbol, length));
+    mUnits.push_back((char)unit);
+    mIsDeclared.push_back(false);
+    return code;
+}
+
+
+std::size_t Alphabet::find(const char *symbol, std::size_t length) const {
+
+    /* Returns code of the symbol, or NO_CODE if it was never interned. */
+
+    if (length == 1 && (unsigned char)symbol[0] < FIRST_WIDE_UNIT)
+        return mCodes[(unsigned char)symbol[0]];
+
+    std::unordered_map<std::string, std::size_t>::const_iterator it =
+            mWideSymbols.find(std::string(symbol, length));
+    return it == mWideSymbols.end() ? NO_CODE : it->second;
+}
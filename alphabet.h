@@ -0,0 +1,61 @@
+#ifndef ALPHABET_H
+#define ALPHABET_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+
+/* Interned symbols of the algorithm. Every symbol - ASCII character or multi-byte UTF-8
+ * sequence - gets a dense code in the order of addition and one byte (unit), that stands for it
+ * in words and rules: ASCII symbols are units themselves, other symbols take free units
+ * 0x80..0xFF. So words and rules are arrays of units, one per symbol, and matchers, search and
+ * hashing work with them as with bytes. Lookups are constant-time: units by table,
+ * multi-byte symbols by hash. */
+class Alphabet {
+public:
+    static const std::size_t MAX_WIDE_SYMBOLS = 128;
+
+    Alphabet();
+
+    bool addSymbol(const char *symbol, std::size_t length);
+    bool addSymbol(char symbol);
+    bool isSymbolPresent(const char *symbol, std::size_t length) const;
+    bool isSymbolPresent(char symbol) const;
+    std::size_t symbolsCount() const;
+    std::string symbols() const;
+    void assign(const char *symbols, std::size_t size);
+
+    bool encode(const char *symbol, std::size_t length, char &unit);
+    bool encode(const std::string &text, std::string &units) const;
+    bool encode(const char *text, std::size_t size, std::string &units) const;
+    bool findUnit(const char *symbol, std::size_t length, char &unit) const;
+    void decode(const char *units, std::size_t size, std::string &text) const;
+    void printColumn(std::ostream &stream, const char *units, std::size_t size, std::size_t width) const;
+    bool hasWideSymbols() const;
+    const std::string& wideSymbol(std::size_t index) const;
+    std::size_t wideSymbolsCount() const;
+
+    static std::size_t symbolLength(const char *text, std::size_t size);
+    static bool isAscii(const char *text, std::size_t size);
+
+private:
+    std::size_t intern(const char *symbol, std::size_t length);
+    std::size_t find(const char *symbol, std::size_t length) const;
+
+private:
+    static const std::size_t NO_CODE = (std::size_t)-1;
+
+    std::vector<std::string> mSymbols;      /* code -> UTF-8 text */
+    std::vector<char> mUnits;               /* code -> unit */
+    std::vector<bool> mIsDeclared;          /* code -> symbol is defined by "T={...}" */
+    std::size_t mDeclaredCount;
+
+    std::size_t mCodes[256];                /* unit -> code */
+    std::size_t mWideCount;                 /* taken units 0x80.. */
+    std::unordered_map<std::string, std::size_t> mWideSymbols;     /* UTF-8 text -> code */
+};
+
+
+#endif // ALPHABET_H
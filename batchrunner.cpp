@@ -0,0 +1,255 @@
+#include "batchrunner.h"
+#include "ruleset.h"
+#include "alphabet.h"
+#include "watchdog.h"
+#include "resultcache.h"
+
+#include <deque>
+#include <exception>
+
+
+#define WORDS_PER_BLOCK   256
+#define BLOCKS_PER_THREAD 4
+#define CACHE_FLUSH_SIZE  (16 << 20)    /* bytes of new results */
+
+
+static void appendNumber(std::string &str, std::size_t number) {
+
+    /* Appends decimal @number to @str. */
+
+    char digits[24];
+    std::size_t size = 0;
+    do {
+        digits[size++] = (char)('0' + number % 10);
+        number /= 10;
+    } while (number);
+
+    while (size)
+        str.push_back(digits[--size]);
+}
+
+
+BatchRunner::BatchRunner(const RuleSet &rules, const Alphabet &alphabet, const Execution::Options &options,
+                         std::size_t threadsCount) :
+    mAlphabet(alphabet), mPool(threadsCount), mWatchdog(options.watchdog), mResultCache(0),
+    mFirstStopReason(Execution::NotStopped), mHasErrors(false) {
+
+    for (std::size_t i=0; i<mPool.threadsCount(); ++i)
+        mExecutions.push_back(new Execution(rules, options));
+}
+
+
+BatchRunner::~BatchRunner() {
+
+    mPool.wait();
+    for (std::size_t i=0; i<mExecutions.size(); ++i)
+        delete mExecutions[i];
+}
+
+
+void BatchRunner::setResultCache(ResultCache *cache) {
+
+    /* Results of words, that are found in opened @cache, are taken from it without execution;
+     * results of executed words are added to it and flushed while the input is processed. */
+
+    mResultCache = cache;
+}
+
+
+bool BatchRunner::run(std::istream &input, std::ostream &output) {
+
+    /* Reads words from @input line by line and writes results to @output.
+     * At most BLOCKS_PER_THREAD blocks per worker are in flight, so memory does not depend
+     * on the input size; blocks are reused after their output is written.
+     * When the watchdog raises the alarm, the rest of the input is not read. */
+
+
+    const std::size_t maxBlocks = BLOCKS_PER_THREAD * mPool.threadsCount();
+    std::deque<Block *> inFlight;
+    std::vector<Block *> freeBlocks;
+    bool isInputOver = false;
+
+    for (;;) {
+        if (mWatchdog && mWatchdog->alarm() != Watchdog::NoAlarm)
+            isInputOver = true;
+
+        while (! isInputOver && inFlight.size() < maxBlocks) {
+            Block *block = 0;
+            if (freeBlocks.empty())
+                block = new Block();
+            else {
+                block = freeBlocks.back();
+                freeBlocks.pop_back();
+            }
+
+            isInputOver = ! readBlock(input, *block);
+            if (block->wordsCount == 0) {
+                freeBlocks.push_back(block);
+                break;
+            }
+
+            inFlight.push_back(block);
+            mPool.submit([this, block](std::size_t worker) { processBlock(*block, worker); });
+        }
+
+        if (inFlight.empty())
+            break;
+
+        Block *block = inFlight.front();
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            while (! block->isDone)
+                mBlockDone.wait(lock);
+        }
+
+        output.write(block->output.data(), block->output.size());
+        if (mFirstStopReason == Execution::NotStopped)
+            mFirstStopReason = block->stopReason;
+        if (block->hasErrors)
+            mHasErrors = true;
+        inFlight.pop_front();
+        freeBlocks.push_back(block);
+
+        if (mResultCache && mResultCache->pendingSize() >= CACHE_FLUSH_SIZE)
+            mResultCache->flush();
+    }
+
+    if (mResultCache)
+        mResultCache->flush();
+
+    for (std::size_t i=0; i<freeBlocks.size(); ++i)
+        delete freeBlocks[i];
+
+    output.flush();
+    if (output.fail()) {
+        output << "ERROR: Can't write results. Process stopped." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+Execution::StopReason BatchRunner::firstStopReason() const {
+
+    /* Returns the reason, why the first (in the order of the input) of abnormally stopped words
+     * was stopped, or NotStopped if all words were processed normally. */
+
+    return mFirstStopReason;
+}
+
+
+bool BatchRunner::hasErrors() const {
+
+    /* Returns true if some word was not processed: it contains absent symbol or its execution failed. */
+
+    return mHasErrors;
+}
+
+
+bool BatchRunner::readBlock(std::istream &input, Block &block) {
+
+    /* Reads up to WORDS_PER_BLOCK lines into @block.
+     * Returns false if the input is over. */
+
+    if (block.words.size() < WORDS_PER_BLOCK)
+        block.words.resize(WORDS_PER_BLOCK);
+    block.wordsCount = 0;
+    block.output.clear();
+    block.stopReason = Execution::NotStopped;
+    block.hasErrors = false;
+    block.isDone = false;
+
+    while (block.wordsCount < WORDS_PER_BLOCK) {
+        std::string &word = block.words[block.wordsCount];
+        if (! std::getline(input, word))
+            return false;
+
+        /* Files with Windows line ends. */
+        if (! word.empty() && word[word.size() - 1] == '\r')
+            word.resize(word.size() - 1);
+
+        ++block.wordsCount;
+    }
+
+    return true;
+}
+
+
+void BatchRunner::processBlock(Block &block, std::size_t worker) {
+
+    /* Executes the rule set for every word of @block with execution state of @worker
+     * (or takes its result from the result cache). Error in one word is reported in its result line
+     * and does not stop the others. */
+
+    Execution &execution = *mExecutions[worker];
+
+    /* Without non-ASCII symbols in the alphabet units are the bytes of the text. */
+    const bool isEncoded = mAlphabet.hasWideSymbols();
+    std::string units;
+
+    for (std::size_t i=0; i<block.wordsCount; ++i) {
+        const std::string *word = &block.words[i];
+        if (isEncoded ? ! mAlphabet.encode(*word, units) : ! Alphabet::isAscii(word->data(), word->size())) {
+            block.output += "ERROR: The word contains non-ASCII symbol, that is absent in the alphabet.\n";
+            block.hasErrors = true;
+            continue;
+        }
+        if (isEncoded)
+            word = &units;
+
+        try {
+            ResultCache::Result cached;
+            cached.word = 0;
+            if (! mResultCache || ! mResultCache->find(word->data(), word->size(), cached)) {
+                execution.start(word->data(), word->size());
+                execution.run();
+                if (mResultCache)
+                    mResultCache->add(word->data(), word->size(), execution);
+
+                cached.stopReason = execution.stopReason();
+                cached.stepsCount = execution.stepsCount();
+                cached.cycleLength = cached.stopReason == Execution::CycleDetected ? execution.cycleLength() : 0;
+            }
+
+            const Execution::StopReason reason = cached.stopReason;
+            if (Execution::isAbnormalStop(reason) && block.stopReason == Execution::NotStopped)
+                block.stopReason = reason;
+
+            if (reason == Execution::CycleDetected) {
+                block.output += "ERROR: The word repeats after ";
+                appendNumber(block.output, cached.cycleLength);
+                block.output += " steps, execution never stops.";
+            }
+            else if (Execution::isAbnormalStop(reason)) {
+                block.output += "ERROR: Execution stopped after ";
+                appendNumber(block.output, cached.stepsCount);
+                block.output += " steps: ";
+                block.output += Execution::stopReasonText(reason);
+            }
+            else if (cached.word) {
+                if (isEncoded)
+                    mAlphabet.decode(cached.word, cached.wordSize, block.output);
+                else
+                    block.output.append(cached.word, cached.wordSize);
+            }
+            else if (isEncoded) {
+                units.clear();
+                execution.word().appendTo(units);
+                mAlphabet.decode(units.data(), units.size(), block.output);
+            }
+            else
+                execution.word().appendTo(block.output);
+        } catch (std::exception &) {
+            block.output += "ERROR: Unknown error occured.";
+            block.hasErrors = true;
+        }
+        block.output.push_back('\n');
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        block.isDone = true;
+    }
+    mBlockDone.notify_all();
+}
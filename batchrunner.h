@@ -0,0 +1,65 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <condition_variable>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "execution.h"
+#include "threadpool.h"
+
+
+class Alphabet;
+class ResultCache;
+class RuleSet;
+
+
+/* Executes one rule set for every line of the input on the thread pool.
+ * The rule set is shared by all workers read-only, every worker has its own Execution.
+ * Lines are processed by blocks; results are written in the order of the input,
+ * one line (the result word) per input line. Words are UTF-8 text, executed by units of the alphabet. */
+class BatchRunner {
+public:
+    BatchRunner(const RuleSet &rules, const Alphabet &alphabet, const Execution::Options &options,
+                std::size_t threadsCount = 0);
+    ~BatchRunner();
+
+    void setResultCache(ResultCache *cache);
+    bool run(std::istream &input, std::ostream &output);
+    Execution::StopReason firstStopReason() const;
+    bool hasErrors() const;
+
+private:
+    BatchRunner(const BatchRunner &);
+    BatchRunner& operator=(const BatchRunner &);
+
+    struct Block {
+        std::vector<std::string> words;
+        std::size_t wordsCount;
+        std::string output;
+        Execution::StopReason stopReason;   /* of the first word, that was stopped abnormally */
+        bool hasErrors;                     /* some word got ERROR instead of the result */
+        bool isDone;
+    };
+
+    bool readBlock(std::istream &input, Block &block);
+    void processBlock(Block &block, std::size_t worker);
+
+private:
+    const Alphabet &mAlphabet;
+    ThreadPool mPool;
+    std::vector<Execution *> mExecutions;      /* worker -> execution state */
+    const Watchdog *mWatchdog;
+    ResultCache *mResultCache;                 /* 0 - every word is executed */
+    Execution::StopReason mFirstStopReason;
+    bool mHasErrors;
+
+    std::mutex mMutex;
+    std::condition_variable mBlockDone;
+};
+
+
+#endif // BATCHRUNNER_H
@@ -0,0 +1,474 @@
+/* Benchmark of the interpreter on canonical Markov algorithms at input sizes 10..10^7.
+ * Every case is generated as text file, loaded and executed the same way as Interpreter does it
+ * (RulesLoader, RulesAnalyzer, Execution) in a separate process, so peak memory of the case
+ * is measured alone. Quadratic and cubic algorithms are stopped by the time limit:
+ * steps per second are measured by the executed steps.
+ *
+ * mnabench [--matching=auto|sequential|automaton|incremental] [--word=gap|rle] [--algorithm=name]
+ *          [--max-size=N] [--time-limit=seconds] [--output=results.csv] [--baseline=results.csv]
+ *
+ * Results are printed as a table and written as CSV, which can be passed as the baseline
+ * to the run of another commit: the last column shows its speedup by ns/step. */
+
+#include "../alphabet.h"
+#include "../ruleset.h"
+#include "../rulesloader.h"
+#include "../rulesanalyzer.h"
+#include "../execution.h"
+#include "../watchdog.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+
+/* Algorithm of the corpus: text of the file and generator of the source word of given size.
+ * Expected result is computed from the source word only if execution has finished. */
+struct Algorithm {
+    const char *name;
+    const char *alphabet;
+    const char *instructions;
+    void (*generate)(std::size_t size, std::string &word);
+    std::string (*result)(const std::string &word);
+};
+
+
+struct Settings {
+    Settings() :
+        matchingMode(Execution::AutoMatching), wordRepresentation(Execution::GapBufferWord),
+        maxSize(10000000), timeLimit(2) {}
+
+    Execution::MatchingMode matchingMode;
+    Execution::WordRepresentation wordRepresentation;
+    std::string algorithm;
+    std::size_t maxSize;
+    double timeLimit;
+    std::string outputFileName;
+    std::string baselineFileName;
+};
+
+
+/* Measurements of one case, passed from the process of the case by pipe. */
+struct Measurement {
+    char status[16];            /* "ok", "wrong", "time-limit", "error" */
+    double loadTime;            /* seconds */
+    double executionTime;
+    uint64_t steps;
+    uint64_t peakMemory;        /* KB, filled by the parent */
+};
+
+
+static std::mt19937 generator(12345);
+
+
+static std::size_t count(const std::string &word, char symbol) {
+    return std::count(word.begin(), word.end(), symbol);
+}
+
+
+static void unaryAddition(std::size_t size, std::string &word) {
+
+    /* 1^a+1^b -> 1^(a+b): "+" is moved to the beginning, a steps. */
+
+    const std::size_t a = (size - 1) / 2;
+    word.assign(size, '1');
+    word[a] = '+';
+}
+
+
+static std::string unaryAdditionResult(const std::string &word) {
+    return "!" + std::string(count(word, '1'), '1') + "@";
+}
+
+
+static void unaryMultiplication(std::size_t size, std::string &word) {
+
+    /* 1^a*1^b -> 1^(a*b): for every digit of a the marker passes b and leaves b digits behind it,
+     * about a*b*(a+b)/2 steps. */
+
+    const std::size_t a = (size - 1) / 2;
+    word.assign(size, '1');
+    word[a] = '*';
+}
+
+
+static std::string unaryMultiplicationResult(const std::string &word) {
+    const std::size_t a = word.find('*');
+    return "!" + std::string(a * (word.size() - a - 1), '1') + "@";
+}
+
+
+static void binaryIncrement(std::size_t size, std::string &word) {
+
+    /* 11...1 + 1 = 100...0: the carry "c" passes all digits, size steps. */
+
+    word.assign(size, '1');
+    word[size - 1] = 'c';
+}
+
+
+static std::string binaryIncrementResult(const std::string &word) {
+    return "!1" + std::string(word.size() - 1, '0') + "@";
+}
+
+
+static void bubbleSort(std::size_t size, std::string &word) {
+
+    /* Random word of a, b, c is sorted by transpositions, a step per inversion. */
+
+    word.resize(size);
+    for (std::size_t i=0; i<size; ++i)
+        word[i] = "abc"[generator() % 3];
+}
+
+
+static std::string bubbleSortResult(const std::string &word) {
+    std::string result(word);
+    std::sort(result.begin(), result.end());
+    return "!" + result + "@";
+}
+
+
+static void palindromeCheck(std::size_t size, std::string &word) {
+
+    /* Random palindrome between explicit "!" and "@": the first symbol is carried to the end
+     * and compared with the last one, about size^2/4 steps. */
+
+    word.resize(size + 2);
+    word[0] = '!';
+    word[size + 1] = '@';
+    for (std::size_t i=0; i<(size + 1) / 2; ++i)
+        word[1 + i] = word[size - i] = "ab"[generator() % 2];
+}
+
+
+static std::string palindromeCheckResult(const std::string &) {
+    return "!y@";
+}
+
+
+static void markerTransport(std::size_t size, std::string &word) {
+
+    /* Marker "m" is moved through random word to its end, size steps. */
+
+    word.resize(size);
+    word[0] = 'm';
+    for (std::size_t i=1; i<size; ++i)
+        word[i] = "ab"[generator() % 2];
+}
+
+
+static std::string markerTransportResult(const std::string &word) {
+    return "!" + word.substr(1) + "@";
+}
+
+
+static const Algorithm ALGORITHMS[] = {
+    { "unary-addition",       "T={1,+}",
+                              "1+->+1\n+->!\n",
+                              unaryAddition, unaryAdditionResult },
+    { "unary-multiplication", "T={1,*,m,r}",
+                              "r1->1r\nm1->1mr\nmr->rm\nm->!\n1*->*m\n*1->*\n*->!\nr->1\n",
+                              unaryMultiplication, unaryMultiplicationResult },
+    { "binary-increment",     "T={0,1,c}",
+                              "1c->c0\n0c->.1\n!c->.!1\n",
+                              binaryIncrement, binaryIncrementResult },
+    { "bubble-sort",          "T={a,b,c}",
+                              "ba->ab\nca->ac\ncb->bc\n",
+                              bubbleSort, bubbleSortResult },
+    { "palindrome-check",     "T={a,b,A,B,y,n,!,@}",
+                              "Aa->aA\nAb->bA\nBa->aB\nBb->bB\naA@->@\nbB@->@\nbA@->.n@\naB@->.n@\n"
+                              "!A@->.!y@\n!B@->.!y@\n!a->!A\n!b->!B\n!@->.!y@\n",
+                              palindromeCheck, palindromeCheckResult },
+    { "marker-transport",     "T={a,b,m}",
+                              "ma->am\nmb->bm\nm->.!\n",
+                              markerTransport, markerTransportResult }
+};
+
+
+static const char* matchingName(Execution::MatchingMode mode) {
+    switch (mode) {
+    case Execution::SequentialMatching:
+        return "sequential";
+    case Execution::IncrementalMatching:
+        return "incremental";
+    case Execution::AutoMatching:
+        return "auto";
+    default:
+        return "automaton";
+    }
+}
+
+
+static const char* wordName(Execution::WordRepresentation representation) {
+    return representation == Execution::RunLengthWord ? "rle" : "gap";
+}
+
+
+static void runCase(const Algorithm &algorithm, std::size_t size, const Settings &settings,
+                    Measurement &measurement) {
+
+    /* Generates the file of the case, loads and executes it as Interpreter does.
+     * Runs in the process of the case. */
+
+    std::strcpy(measurement.status, "error");
+
+    char fileName[] = "/tmp/mnabench-XXXXXX";
+    const int file = mkstemp(fileName);
+    if (file < 0)
+        return;
+    close(file);
+
+    {
+        std::string word;
+        algorithm.generate(size, word);
+
+        std::ofstream output(fileName);
+        output << algorithm.alphabet << "\nV=" << word << "\n" << algorithm.instructions;
+        if (! output)
+            return;
+    }
+
+    std::ostringstream log;
+    Alphabet alphabet;
+    RuleSet rules;
+
+    const std::chrono::steady_clock::time_point loadStart = std::chrono::steady_clock::now();
+    RulesLoader loader(alphabet, log);
+    const bool isLoaded = loader.load(fileName, rules);
+    if (isLoaded) {
+        RulesAnalyzer analyzer(rules);
+        analyzer.analyze();
+        rules.prune(analyzer.removedInstructions());
+    }
+    measurement.loadTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+
+    std::remove(fileName);
+    if (! isLoaded) {
+        std::cerr << log.str();
+        return;
+    }
+
+    Watchdog watchdog;
+    Execution::Options options;
+    options.matchingMode = settings.matchingMode;
+    options.wordRepresentation = settings.wordRepresentation;
+    options.watchdog = &watchdog;
+    Execution execution(rules, options);
+
+    watchdog.start(settings.timeLimit, 0);
+    const std::chrono::steady_clock::time_point executionStart = std::chrono::steady_clock::now();
+    execution.start(rules.sourceWord(), rules.sourceWordSize());
+    execution.run();
+    watchdog.stop();
+    measurement.executionTime =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - executionStart).count();
+    measurement.steps = execution.stepsCount();
+
+    switch (execution.stopReason()) {
+    case Execution::NoInstructionFound:
+    case Execution::FinalInstructionExecuted: {
+        const std::string word(rules.sourceWord(), rules.sourceWordSize());
+        std::strcpy(measurement.status, execution.word().str() == algorithm.result(word) ? "ok" : "wrong");
+        break;
+    }
+    case Execution::TimeLimitReached:
+        std::strcpy(measurement.status, "time-limit");
+        break;
+    default:
+        break;
+    }
+}
+
+
+static bool measure(const Algorithm &algorithm, std::size_t size, const Settings &settings,
+                    Measurement &measurement) {
+
+    /* Runs the case in a child process and reads its measurement.
+     * Peak memory is the maximum resident set of the child. */
+
+    Measurement empty = {"error", 0, 0, 0, 0};
+    measurement = empty;
+
+    int channel[2];
+    if (pipe(channel) != 0)
+        return false;
+
+    std::cout.flush();
+    const pid_t pid = fork();
+    if (pid < 0)
+        return false;
+
+    if (pid == 0) {
+        close(channel[0]);
+        runCase(algorithm, size, settings, measurement);
+        const bool isWritten = write(channel[1], &measurement, sizeof(measurement)) == (ssize_t)sizeof(measurement);
+        _exit(isWritten ? 0 : 1);
+    }
+
+    close(channel[1]);
+    Measurement result = empty;
+    const bool isRead = read(channel[0], &result, sizeof(result)) == (ssize_t)sizeof(result);
+    close(channel[0]);
+
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid || ! isRead || ! WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        return false;
+
+    measurement = result;
+    measurement.peakMemory = usage.ru_maxrss;
+    return true;
+}
+
+
+static std::map<std::string, double> readBaseline(const std::string &fileName) {
+
+    /* Reads ns/step of the cases from CSV file, written by --output. */
+
+    std::map<std::string, double> baseline;
+    std::ifstream input(fileName.c_str());
+    std::string line;
+    std::getline(input, line);
+
+    while (std::getline(input, line)) {
+        std::vector<std::string> fields;
+        std::istringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, ','))
+            fields.push_back(field);
+
+        if (fields.size() >= 9)
+            baseline[fields[0] + "," + fields[1] + "," + fields[2] + "," + fields[3]] = std::atof(fields[8].c_str());
+    }
+
+    return baseline;
+}
+
+
+static bool processArguments(int argc, char* argv[], Settings &settings) {
+    for (int i=1; i<argc; ++i) {
+        if (std::strcmp(argv[i], "--matching=sequential") == 0)
+            settings.matchingMode = Execution::SequentialMatching;
+        else if (std::strcmp(argv[i], "--matching=automaton") == 0)
+            settings.matchingMode = Execution::AutomatonMatching;
+        else if (std::strcmp(argv[i], "--matching=incremental") == 0)
+            settings.matchingMode = Execution::IncrementalMatching;
+        else if (std::strcmp(argv[i], "--matching=auto") == 0)
+            settings.matchingMode = Execution::AutoMatching;
+        else if (std::strcmp(argv[i], "--word=gap") == 0)
+            settings.wordRepresentation = Execution::GapBufferWord;
+        else if (std::strcmp(argv[i], "--word=rle") == 0)
+            settings.wordRepresentation = Execution::RunLengthWord;
+        else if (std::strncmp(argv[i], "--algorithm=", 12) == 0)
+            settings.algorithm = argv[i] + 12;
+        else if (std::strncmp(argv[i], "--max-size=", 11) == 0)
+            settings.maxSize = std::strtoul(argv[i] + 11, 0, 10);
+        else if (std::strncmp(argv[i], "--time-limit=", 13) == 0)
+            settings.timeLimit = std::strtod(argv[i] + 13, 0);
+        else if (std::strncmp(argv[i], "--output=", 9) == 0)
+            settings.outputFileName = argv[i] + 9;
+        else if (std::strncmp(argv[i], "--baseline=", 11) == 0)
+            settings.baselineFileName = argv[i] + 11;
+        else {
+            std::cerr << "Unknown argument \"" << argv[i] << "\"." << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+int main(int argc, char* argv[]) {
+    Settings settings;
+    if (! processArguments(argc, argv, settings))
+        return 1;
+
+    std::map<std::string, double> baseline;
+    if (! settings.baselineFileName.empty())
+        baseline = readBaseline(settings.baselineFileName);
+
+    std::ofstream output;
+    if (! settings.outputFileName.empty()) {
+        output.open(settings.outputFileName.c_str());
+        output << std::fixed;
+        output << "algorithm,size,matching,word,status,steps,seconds,steps_per_second,ns_per_step,"
+                  "load_seconds,peak_rss_kb" << std::endl;
+    }
+
+    std::cout << "Matching: " << matchingName(settings.matchingMode)
+              << ", word: " << wordName(settings.wordRepresentation)
+              << ", time limit: " << settings.timeLimit << " s\n\n"
+              << std::setw(22) << std::left << "Algorithm"
+              << std::setw(10) << std::right << "Size"
+              << std::setw(12) << "Status"
+              << std::setw(14) << "Steps"
+              << std::setw(14) << "Steps/s"
+              << std::setw(12) << "ns/step"
+              << std::setw(10) << "Load, s"
+              << std::setw(12) << "Peak, KB"
+              << std::setw(10) << "Speedup" << '\n';
+
+    bool isCorrect = true;
+    for (std::size_t a=0; a<sizeof(ALGORITHMS)/sizeof(ALGORITHMS[0]); ++a) {
+        const Algorithm &algorithm = ALGORITHMS[a];
+        if (! settings.algorithm.empty() && settings.algorithm != algorithm.name)
+            continue;
+
+        for (std::size_t size=10; size<=settings.maxSize; size*=10) {
+            Measurement measurement;
+            if (! measure(algorithm, size, settings, measurement))
+                std::strcpy(measurement.status, "error");
+
+            const std::string status = measurement.status;
+            if (status == "wrong" || status == "error")
+                isCorrect = false;
+
+            const double stepsPerSecond = measurement.executionTime > 0 ? measurement.steps / measurement.executionTime : 0;
+            const double nsPerStep = measurement.steps ? measurement.executionTime * 1e9 / measurement.steps : 0;
+
+            std::cout << std::setw(22) << std::left << algorithm.name
+                      << std::setw(10) << std::right << size
+                      << std::setw(12) << status
+                      << std::setw(14) << measurement.steps
+                      << std::setw(14) << std::fixed << std::setprecision(0) << stepsPerSecond
+                      << std::setw(12) << std::setprecision(1) << nsPerStep
+                      << std::setw(10) << std::setprecision(3) << measurement.loadTime
+                      << std::setw(12) << measurement.peakMemory;
+
+            std::ostringstream key;
+            key << algorithm.name << "," << size << "," << matchingName(settings.matchingMode)
+                << "," << wordName(settings.wordRepresentation);
+
+            std::map<std::string, double>::const_iterator old = baseline.find(key.str());
+            if (old != baseline.end() && nsPerStep > 0)
+                std::cout << std::setw(10) << std::setprecision(2) << old->second / nsPerStep;
+            std::cout << std::endl;
+
+            if (output.is_open())
+                output << key.str() << "," << status << "," << measurement.steps << ","
+                       << std::setprecision(6) << measurement.executionTime << ","
+                       << std::setprecision(0) << stepsPerSecond << ","
+                       << std::setprecision(2) << nsPerStep << ","
+                       << std::setprecision(6) << measurement.loadTime << ","
+                       << measurement.peakMemory << std::endl;
+        }
+    }
+
+    return isCorrect ? 0 : 1;
+}
@@ -0,0 +1,23 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt
+CONFIG += c++11 thread
+
+SOURCES += mnabench.cpp \
+    ../alphabet.cpp \
+    ../matcher.cpp \
+    ../matchindex.cpp \
+    ../word.cpp \
+    ../ruleset.cpp \
+    ../mappedfile.cpp \
+    ../patternsearch.cpp \
+    ../execution.cpp \
+    ../threadpool.cpp \
+    ../cycledetector.cpp \
+    ../watchdog.cpp \
+    ../rulesloader.cpp \
+    ../rulesanalyzer.cpp \
+    ../profiler.cpp
+
+DEFINES += LINUX
+DEFINES += NDEBUG
@@ -0,0 +1,111 @@
+/* Micro-benchmark of PatternSearch kernels.
+ * Every kernel searches a pattern, that occurs only at the end of a long word,
+ * and is compared with std::string::find(). Results of all kernels are checked to be equal. */
+
+#include "../patternsearch.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+
+struct BenchCase {
+    const char *name;
+    const char *alphabet;
+    const char *pattern;
+};
+
+
+static std::string makeWord(const char *alphabet, std::size_t size, const std::string &pattern) {
+
+    /* Random word over @alphabet, that ends with @pattern. */
+
+    std::mt19937 generator(12345);
+    const std::size_t alphabetSize = std::char_traits<char>::length(alphabet);
+
+    std::string word(size - pattern.size(), ' ');
+    for (std::size_t i=0; i<word.size(); ++i)
+        word[i] = alphabet[generator() % alphabetSize];
+
+    return word + pattern;
+}
+
+
+template<typename Search>
+static double measure(Search search, std::size_t wordSize, std::size_t &result) {
+
+    /* Returns nanoseconds per searched symbol. About 1 GB is scanned. */
+
+    const std::size_t repeats = std::max<std::size_t>(1, (1u << 30) / wordSize);
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (std::size_t i=0; i<repeats; ++i)
+        result = search();
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    double nanoseconds = std::chrono::duration<double, std::nano>(end - begin).count();
+    return nanoseconds / repeats / wordSize;
+}
+
+
+int main() {
+    const BenchCase cases[] = {
+        { "rare last symbol",  "abcd", "abcz"     },
+        { "binary alphabet",   "ab",   "abbacbba" },
+        { "single symbol",     "ab",   "c"        },
+        { "long pattern",      "abc",  "abcabcabcabcabcabcabcabcabcabcab" }
+    };
+    const std::size_t sizes[] = { 1 << 10, 1 << 16, 1 << 20, 1 << 24 };
+    const PatternSearch::Kernel kernels[] = {
+        PatternSearch::ScalarKernel, PatternSearch::Sse2Kernel, PatternSearch::Avx2Kernel
+    };
+
+    std::cout << "Selected kernel: " << PatternSearch::kernelName(PatternSearch::bestKernel()) << "\n\n"
+              << std::setw(18) << std::left << "Case"
+              << std::setw(10) << std::right << "Size"
+              << std::setw(10) << "Kernel"
+              << std::setw(12) << "ns/symbol"
+              << std::setw(10) << "Speedup" << '\n';
+
+    bool isCorrect = true;
+    for (std::size_t c=0; c<sizeof(cases)/sizeof(cases[0]); ++c) {
+        for (std::size_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s) {
+            const std::string pattern = cases[c].pattern;
+            const std::string word = makeWord(cases[c].alphabet, sizes[s], pattern);
+
+            std::size_t expected = 0;
+            double baseline = measure([&]() { return word.find(pattern); }, word.size(), expected);
+            std::cout << std::setw(18) << std::left << cases[c].name
+                      << std::setw(10) << std::right << word.size()
+                      << std::setw(10) << "string"
+                      << std::setw(12) << std::fixed << std::setprecision(4) << baseline
+                      << std::setw(10) << std::setprecision(2) << 1.0 << '\n';
+
+            for (std::size_t k=0; k<sizeof(kernels)/sizeof(kernels[0]); ++k) {
+                const PatternSearch::Kernel kernel = kernels[k];
+                if (! PatternSearch::isSupported(kernel))
+                    continue;
+
+                std::size_t found = 0;
+                double time = measure([&]() {
+                    return PatternSearch::find(kernel, word.data(), word.size(), pattern.data(), pattern.size());
+                }, word.size(), found);
+
+                std::cout << std::setw(18) << "" << std::setw(10) << ""
+                          << std::setw(10) << PatternSearch::kernelName(kernel)
+                          << std::setw(12) << std::setprecision(4) << time
+                          << std::setw(10) << std::setprecision(2) << baseline / time;
+                if (found != expected) {
+                    std::cout << "  ERROR: found at " << found << ", expected " << expected;
+                    isCorrect = false;
+                }
+                std::cout << '\n';
+            }
+        }
+    }
+
+    return isCorrect ? 0 : 1;
+}
@@ -0,0 +1,13 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt
+CONFIG += c++11
+
+SOURCES += searchbench.cpp \
+    ../patternsearch.cpp
+
+HEADERS += \
+    ../patternsearch.h
+
+DEFINES += LINUX
+DEFINES += NDEBUG
@@ -0,0 +1,300 @@
+#include "checkpoint.h"
+#include "alphabet.h"
+#include "execution.h"
+#include "mappedfile.h"
+#include "ruleset.h"
+#include "fnvhash.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef LINUX
+#include <unistd.h>
+#endif
+
+
+#define CHECKPOINT_MAGIC          "MNACHKPT"
+#define CHECKPOINT_FORMAT_VERSION 1
+#define CHECKPOINT_BYTE_ORDER     0x01020304u
+#define BLOCK_SIZE                (1 << 20)
+#define FIRST_SLICE               1024
+#define MAX_SLICE                 (1 << 30)
+#define MIN_SLICE_TIME            0.01      /* seconds */
+#define MAX_SLICE_TIME            0.1
+
+
+namespace {
+
+/* Header of checkpoint file, followed by @wordSize units of the word (with system symbols). */
+struct CheckpointHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t fingerprint;           /* of the rule set (see Checkpoint::fingerprint()) */
+    uint64_t stepsCount;
+    uint64_t lastInstruction;
+    uint64_t wordSize;
+    uint64_t checksum;              /* of the word */
+};
+
+
+/* Writes the word to the file by blocks of BLOCK_SIZE bytes and counts its checksum. */
+class BlockWriter : public WordChunkVisitor {
+public:
+    BlockWriter(std::FILE *file, std::vector<char> &block) :
+        mFile(file), mBlock(block), mUsed(0), mSize(0), mChecksum(FnvHash::FIRST), mIsFailed(false) {
+
+        mBlock.resize(BLOCK_SIZE);
+    }
+
+    bool visit(const char *chunk, std::size_t size) {
+        mChecksum = FnvHash::add(mChecksum, chunk, size);
+        mSize += size;
+
+        while (size > 0 && ! mIsFailed) {
+            std::size_t count = std::min(size, mBlock.size() - mUsed);
+            std::memcpy(&mBlock[mUsed], chunk, count);
+            mUsed += count;
+            chunk += count;
+            size -= count;
+            if (mUsed == mBlock.size())
+                flush();
+        }
+        return ! mIsFailed;
+    }
+
+    bool visitRun(char symbol, std::size_t count) {
+        while (count > 0 && ! mIsFailed) {
+            std::size_t size = std::min(count, mBlock.size() - mUsed);
+            std::memset(&mBlock[mUsed], symbol, size);
+            mChecksum = FnvHash::add(mChecksum, &mBlock[mUsed], size);
+            mSize += size;
+            mUsed += size;
+            count -= size;
+            if (mUsed == mBlock.size())
+                flush();
+        }
+        return ! mIsFailed;
+    }
+
+    bool flush() {
+        if (mUsed > 0 && std::fwrite(&mBlock[0], 1, mUsed, mFile) != mUsed)
+            mIsFailed = true;
+        mUsed = 0;
+        return ! mIsFailed;
+    }
+
+    uint64_t size() const { return mSize; }
+    uint64_t checksum() const { return mChecksum; }
+
+private:
+    std::FILE *mFile;
+    std::vector<char> &mBlock;
+    std::size_t mUsed;
+    uint64_t mSize;
+    uint64_t mChecksum;
+    bool mIsFailed;
+};
+
+}
+
+
+
+Checkpoint::Checkpoint(const std::string &fileName, std::size_t stepsInterval, double timeInterval) :
+    mFileName(fileName), mStepsInterval(stepsInterval), mTimeInterval(timeInterval),
+    mSavedSteps(0), mSlice(FIRST_SLICE) {}
+
+
+void Checkpoint::begin(std::size_t stepsCount) {
+
+    /* Starts counting of the intervals from the execution, that has executed @stepsCount steps. */
+
+    mSavedSteps = stepsCount;
+    mSaveTime = mCheckTime = std::chrono::steady_clock::now();
+    mSlice = FIRST_SLICE;
+}
+
+
+std::size_t Checkpoint::stepsBeforeCheck(std::size_t stepsCount) const {
+
+    /* Returns the number of steps, that can be executed before the next call of isDue().
+     * For the time interval it is the slice, that takes from MIN_SLICE_TIME to MAX_SLICE_TIME. */
+
+    std::size_t steps = mTimeInterval > 0 ? mSlice : (std::size_t)-1;
+    if (mStepsInterval) {
+        const std::size_t done = stepsCount - mSavedSteps;
+        steps = std::min(steps, done < mStepsInterval ? mStepsInterval - done : (std::size_t)1);
+    }
+    return steps;
+}
+
+
+bool Checkpoint::isDue(std::size_t stepsCount) {
+
+    /* Returns true if the checkpoint must be saved after @stepsCount steps.
+     * The slice of steps is adjusted by the time of the previous one. */
+
+    if (mStepsInterval && stepsCount - mSavedSteps >= mStepsInterval)
+        return true;
+
+    if (mTimeInterval <= 0)
+        return false;
+
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    const double sliceTime = std::chrono::duration<double>(now - mCheckTime).count();
+    mCheckTime = now;
+
+    if (sliceTime < MIN_SLICE_TIME && mSlice < MAX_SLICE)
+        mSlice *= 2;
+    else if (sliceTime > MAX_SLICE_TIME && mSlice > 1)
+        mSlice /= 2;
+
+    return std::chrono::duration<double>(now - mSaveTime).count() >= mTimeInterval;
+}
+
+
+bool Checkpoint::save(const Execution &execution, uint64_t fingerprint) {
+
+    /* Writes the state of @execution to the temporary file, flushes it to the disk and renames it
+     * over the checkpoint. Returns false if the file can't be written (see error()),
+     * the previous checkpoint is kept then. */
+
+    const std::string tempFileName = mFileName + ".tmp";
+    std::FILE *file = std::fopen(tempFileName.c_str(), "wb");
+    if (! file) {
+        mError = "Can't create file \"" + tempFileName + "\".";
+        return false;
+    }
+
+    /* The word is written by blocks, buffer of the stream is not needed. */
+    std::setvbuf(file, 0, _IONBF, 0);
+
+    CheckpointHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_FORMAT_VERSION;
+    header.byteOrder = CHECKPOINT_BYTE_ORDER;
+    header.fingerprint = fingerprint;
+    header.stepsCount = execution.stepsCount();
+    header.lastInstruction = execution.lastInstruction();
+
+    /* Header is written after the word, when its size and checksum are known. */
+    bool isWritten = std::fwrite(&header, sizeof(header), 1, file) == 1;
+
+    BlockWriter writer(file, mBlock);
+    isWritten = isWritten && execution.word().scan(writer) && writer.flush();
+
+    header.wordSize = writer.size();
+    header.checksum = writer.checksum();
+    isWritten = isWritten && std::fseek(file, 0, SEEK_SET) == 0
+            && std::fwrite(&header, sizeof(header), 1, file) == 1 && std::fflush(file) == 0;
+
+#ifdef LINUX
+    isWritten = isWritten && fsync(fileno(file)) == 0;
+#endif
+
+    isWritten = std::fclose(file) == 0 && isWritten;
+
+    if (! isWritten) {
+        std::remove(tempFileName.c_str());
+        mError = "Can't write file \"" + tempFileName + "\".";
+        return false;
+    }
+
+    if (std::rename(tempFileName.c_str(), mFileName.c_str()) != 0) {
+        std::remove(tempFileName.c_str());
+        mError = "Can't replace file \"" + mFileName + "\".";
+        return false;
+    }
+
+    mSavedSteps = execution.stepsCount();
+    mSaveTime = std::chrono::steady_clock::now();
+    return true;
+}
+
+
+bool Checkpoint::load(uint64_t fingerprint, State &state) {
+
+    /* Reads the checkpoint to @state. Returns false if it can't be read, it is damaged
+     * or it was written for another rule set (see error()). */
+
+    MappedFile file;
+    if (! file.open(mFileName)) {
+        mError = "Can't open file \"" + mFileName + "\".";
+        return false;
+    }
+
+    CheckpointHeader header;
+    if (file.size() < sizeof(header)) {
+        mError = "File \"" + mFileName + "\" is not a checkpoint.";
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0
+            || header.byteOrder != CHECKPOINT_BYTE_ORDER || header.version != CHECKPOINT_FORMAT_VERSION) {
+        mError = "File \"" + mFileName + "\" is not a checkpoint of this version of the interpreter.";
+        return false;
+    }
+
+    if (header.fingerprint != fingerprint) {
+        mError = "Checkpoint \"" + mFileName + "\" was written for another algorithm.";
+        return false;
+    }
+
+    const char *word = file.data() + sizeof(header);
+    if (header.wordSize != file.size() - sizeof(header)
+            || FnvHash::add(FnvHash::FIRST, word, (std::size_t)header.wordSize) != header.checksum) {
+        mError = "Checkpoint \"" + mFileName + "\" is damaged.";
+        return false;
+    }
+
+    state.word.assign(word, (std::size_t)header.wordSize);
+    state.stepsCount = (std::size_t)header.stepsCount;
+    state.lastInstruction = (std::size_t)header.lastInstruction;
+    return true;
+}
+
+
+void Checkpoint::remove() {
+
+    /* Removes the checkpoint of the finished execution, so it is not resumed again. */
+
+    std::remove(mFileName.c_str());
+}
+
+
+const std::string& Checkpoint::fileName() const {
+    return mFileName;
+}
+
+
+const std::string& Checkpoint::error() const {
+    return mError;
+}
+
+
+uint64_t Checkpoint::fingerprint(const RuleSet &rules, const Alphabet &alphabet) {
+
+    /* Returns hash of everything, that defines the result of execution: the alphabet (units of symbols),
+     * the source word and the instructions. Removed from matching instructions are not counted,
+     * so text file and its compiled rule set have the same fingerprint. */
+
+    const std::string symbols = alphabet.symbols();
+    uint64_t hash = FnvHash::add(FnvHash::FIRST, symbols.size());
+    hash = FnvHash::add(hash, symbols.data(), symbols.size());
+    hash = FnvHash::add(hash, rules.sourceWordSize());
+    hash = FnvHash::add(hash, rules.sourceWord(), rules.sourceWordSize());
+
+    hash = FnvHash::add(hash, rules.instructionsCount());
+    for (std::size_t i=0; i<rules.instructionsCount(); ++i) {
+        hash = FnvHash::add(hash, rules.replacebleLength(i));
+        hash = FnvHash::add(hash, rules.replaceble(i), rules.replacebleLength(i));
+        hash = FnvHash::add(hash, rules.replacerLength(i));
+        hash = FnvHash::add(hash, rules.replacer(i), rules.replacerLength(i));
+        hash = FnvHash::add(hash, (uint64_t)rules.isFinal(i) | (uint64_t)rules.isErasing(i) << 1);
+    }
+
+    return hash;
+}
@@ -0,0 +1,62 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+
+class Alphabet;
+class Execution;
+class RuleSet;
+
+
+/* Periodic saving of the state of long execution: the word, the number of executed steps
+ * and the fingerprint of the rule set, so the execution can be resumed after the restart of the process.
+ * The file is written next to the checkpoint and renamed over it, so the checkpoint is never partial.
+ * Execution is checked by slices of steps (see stepsBeforeCheck()), so the clock is not read at every step. */
+class Checkpoint {
+public:
+    /* State of interrupted execution, read from the file. */
+    struct State {
+        std::string word;           /* units */
+        std::size_t stepsCount;
+        std::size_t lastInstruction;
+    };
+
+    Checkpoint(const std::string &fileName, std::size_t stepsInterval, double timeInterval);
+
+    void begin(std::size_t stepsCount);
+    std::size_t stepsBeforeCheck(std::size_t stepsCount) const;
+    bool isDue(std::size_t stepsCount);
+
+    bool save(const Execution &execution, uint64_t fingerprint);
+    bool load(uint64_t fingerprint, State &state);
+    void remove();
+
+    const std::string& fileName() const;
+    const std::string& error() const;
+
+    static uint64_t fingerprint(const RuleSet &rules, const Alphabet &alphabet);
+
+private:
+    Checkpoint(const Checkpoint &);
+    Checkpoint& operator=(const Checkpoint &);
+
+private:
+    const std::string mFileName;
+    const std::size_t mStepsInterval;       /* 0 - not by steps */
+    const double mTimeInterval;             /* seconds, 0 - not by time */
+
+    std::size_t mSavedSteps;                /* steps count of the last checkpoint */
+    std::chrono::steady_clock::time_point mSaveTime;
+    std::chrono::steady_clock::time_point mCheckTime;
+    std::size_t mSlice;                     /* steps between checks of the clock */
+
+    std::vector<char> mBlock;               /* buffer of writing */
+    std::string mError;                     /* of the last failed saving or loading */
+};
+
+
+#endif // CHECKPOINT_H
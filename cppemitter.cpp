@@ -0,0 +1,281 @@
+#include "cppemitter.h"
+#include "ruleset.h"
+#include "alphabet.h"
+
+#include <map>
+#include <sstream>
+
+#include <assert.h>
+
+
+CppEmitter::CppEmitter(const RuleSet &rules, const Alphabet &alphabet) :
+    mRules(rules), mAlphabet(alphabet) {}
+
+
+void CppEmitter::emit(std::ostream &stream, const std::string &sourceName, const std::string &instructionsTable) const {
+
+    /* Writes the whole translation unit to @stream.
+     * @instructionsTable is printed by the program before execution, as Interpreter does. */
+
+
+#ifndef NDEBUG
+    assert(mRules.instructionsCount() > 0);
+#endif
+
+    stream << "/* Generated by \"mna --emit-cpp\" from \"" << sourceName << "\". Do not edit.\n"
+           << " * Build: g++ -O3 -o program <this file>\n"
+           << " * Usage: program [source word] */\n"
+           << "\n"
+           << "#include <iostream>\n"
+           << "#include <iomanip>\n"
+           << "#include <string>\n"
+           << "#include <exception>\n"
+           << (mAlphabet.hasWideSymbols() ? "#include <cstring>\n" : "")
+           << "\n"
+           << "\n"
+           << "static const char INSTRUCTIONS_TABLE[] = " << stringLiteral(instructionsTable) << ";\n"
+           << "static const char SOURCE_WORD[] = "
+           << stringLiteral(std::string(mRules.sourceWord(), mRules.sourceWordSize())) << ";\n"
+           << "static const std::size_t INSTRUCTIONS_COUNT = " << mRules.instructionsCount() << ";\n"
+           << "\n"
+           << "\n";
+
+    if (mAlphabet.hasWideSymbols())
+        emitWideSymbols(stream);
+    emitFindInstruction(stream);
+    emitExecuteInstruction(stream);
+    emitMain(stream);
+}
+
+
+void CppEmitter::emitFindInstruction(std::ostream &stream) const {
+
+    /* One pass over the word. Every position dispatches on its symbol
+     * to the instructions, which replaceble part starts with this symbol (in their order).
+     * The first met occurrence of an instruction is its leftmost one,
+     * so it is enough to remember the best instruction number. */
+
+
+    std::map<char, std::vector<std::size_t> > byFirstSymbol;
+    for (std::size_t i=0; i<mRules.instructionsCount(); ++i) {
+        if (! mRules.isPruned(i))
+            byFirstSymbol[mRules.replaceble(i)[0]].push_back(i);
+    }
+
+    stream << "static bool findInstruction(const std::string &word, std::size_t &index, std::size_t &pos) {\n"
+           << "    const char *symbols = word.data();\n"
+           << "    const std::size_t size = word.size();\n"
+           << "    std::size_t best = INSTRUCTIONS_COUNT;\n"
+           << "\n"
+           << "    for (std::size_t i=0; i<size && best != 0; ++i) {\n"
+           << "        switch (symbols[i]) {\n";
+
+    std::map<char, std::vector<std::size_t> >::const_iterator it = byFirstSymbol.begin();
+    for (; it != byFirstSymbol.end(); ++it) {
+        stream << "        case " << charLiteral(it->first) << ":\n";
+
+        const std::vector<std::size_t> &indexes = it->second;
+        for (std::size_t k=0; k<indexes.size(); ++k) {
+            const char *replaceble = mRules.replaceble(indexes[k]);
+            const std::size_t length = mRules.replacebleLength(indexes[k]);
+
+            stream << "            " << (k == 0 ? "if" : "else if") << " (" << indexes[k] << " < best";
+            if (length > 1)
+                stream << " && size - i >= " << length;
+            for (std::size_t pos=1; pos<length; ++pos)
+                stream << " && symbols[i+" << pos << "] == " << charLiteral(replaceble[pos]);
+            stream << ") {\n"
+                   << "                best = " << indexes[k] << ";\n"
+                   << "                pos = i;\n"
+                   << "            }\n";
+        }
+
+        stream << "            break;\n";
+    }
+
+    stream << "        }\n"
+           << "    }\n"
+           << "\n"
+           << "    index = best;\n"
+           << "    return best != INSTRUCTIONS_COUNT;\n"
+           << "}\n"
+           << "\n"
+           << "\n";
+}
+
+
+void CppEmitter::emitExecuteInstruction(std::ostream &stream) const {
+
+    /* Replaces (or erases on "!") the replaceble part and restores system symbols.
+     * Returns true if executed instruction is final. */
+
+    stream << "static bool executeInstruction(std::string &word, std::size_t index, std::size_t pos) {\n"
+           << "    bool isFinal = false;\n"
+           << "\n"
+           << "    switch (index) {\n";
+
+    for (std::size_t i=0; i<mRules.instructionsCount(); ++i) {
+        if (mRules.isPruned(i))
+            continue;
+
+        stream << "    case " << i << ":\n";
+        if (mRules.isErasing(i))
+            stream << "        word.erase(pos, " << mRules.replacebleLength(i) << ");\n";
+        else
+            stream << "        word.replace(pos, " << mRules.replacebleLength(i) << ", "
+                   << stringLiteral(std::string(mRules.replacer(i), mRules.replacerLength(i))) << ", "
+                   << mRules.replacerLength(i) << ");\n";
+
+        if (mRules.isFinal(i))
+            stream << "        isFinal = true;\n";
+        stream << "        break;\n";
+    }
+
+    stream << "    }\n"
+           << "\n"
+           << "    if (word.at(0) != '!')\n"
+           << "        word.insert(0, 1, '!');\n"
+           << "    if (word.at(word.size() - 1) != '@')\n"
+           << "        word.push_back('@');\n"
+           << "\n"
+           << "    return isFinal;\n"
+           << "}\n"
+           << "\n"
+           << "\n";
+}
+
+
+void CppEmitter::emitWideSymbols(std::ostream &stream) const {
+
+    /* Table of non-ASCII symbols (symbol with unit 0x80 + i is WIDE_SYMBOLS[i])
+     * and translation of the word between UTF-8 and units. */
+
+    stream << "static const char *const WIDE_SYMBOLS[] = {\n";
+    for (std::size_t i=0; i<mAlphabet.wideSymbolsCount(); ++i)
+        stream << "    " << stringLiteral(mAlphabet.wideSymbol(i)) << ",\n";
+    stream << "};\n"
+           << "static const std::size_t WIDE_SYMBOLS_COUNT = " << mAlphabet.wideSymbolsCount() << ";\n"
+           << "\n"
+           << "\n"
+           << "static std::string encodeWord(const char *text) {\n"
+           << "    std::string word;\n"
+           << "    while (*text) {\n"
+           << "        std::size_t i = 0, length = 1;\n"
+           << "        for (; i<WIDE_SYMBOLS_COUNT; ++i) {\n"
+           << "            length = std::strlen(WIDE_SYMBOLS[i]);\n"
+           << "            if (std::strncmp(text, WIDE_SYMBOLS[i], length) == 0)\n"
+           << "                break;\n"
+           << "        }\n"
+           << "\n"
+           << "        if (i < WIDE_SYMBOLS_COUNT) {\n"
+           << "            word.push_back((char)(0x80 + i));\n"
+           << "            text += length;\n"
+           << "        }\n"
+           << "        else\n"
+           << "            word.push_back(*text++);\n"
+           << "    }\n"
+           << "    return word;\n"
+           << "}\n"
+           << "\n"
+           << "\n"
+           << "static std::string decodeWord(const std::string &word) {\n"
+           << "    std::string text;\n"
+           << "    for (std::size_t i=0; i<word.size(); ++i) {\n"
+           << "        std::size_t unit = (unsigned char)word[i];\n"
+           << "        if (unit >= 0x80 && unit - 0x80 < WIDE_SYMBOLS_COUNT)\n"
+           << "            text += WIDE_SYMBOLS[unit - 0x80];\n"
+           << "        else\n"
+           << "            text.push_back(word[i]);\n"
+           << "    }\n"
+           << "    return text;\n"
+           << "}\n"
+           << "\n"
+           << "\n";
+}
+
+
+void CppEmitter::emitMain(std::ostream &stream) const {
+
+    /* Column widths are the same as in Interpreter::executeInstructions(). */
+
+    const bool isEncoded = mAlphabet.hasWideSymbols();
+
+    stream << "int main(int argc, char *argv[]) {\n"
+           << "    std::string word(SOURCE_WORD, sizeof(SOURCE_WORD) - 1);\n"
+           << "    if (argc > 1)\n"
+           << (isEncoded ? "        word = encodeWord(argv[1]);\n" : "        word = argv[1];\n")
+           << "\n"
+           << "    std::cout << INSTRUCTIONS_TABLE;\n"
+           << "    std::cout << std::endl << \"Executing process: \" << std::endl;\n"
+           << "    std::cout << std::setw(4) << std::left << \"N \"\n"
+           << "              << std::setw(8) << std::left << \"Instr. \"\n"
+           << "              << std::left << \"Source word \"\n"
+           << "              << '\\n';\n"
+           << "\n"
+           << "    try {\n"
+           << "        std::size_t number = 0, index = 0, pos = 0;\n"
+           << "        while (findInstruction(word, index, pos)) {\n"
+           << "            bool isFinal = executeInstruction(word, index, pos);\n"
+           << "\n"
+           << "            ++number;\n"
+           << "            std::cout << std::setw(4) << number\n"
+           << "                      << std::setw(8) << index\n"
+           << (isEncoded ? "                      << decodeWord(word)\n" : "                      << word\n")
+           << "                      << '\\n';\n"
+           << "\n"
+           << "            if (isFinal)\n"
+           << "                break;\n"
+           << "        }\n"
+           << "    } catch (std::exception &) {\n"
+           << "        std::cout << \"ERROR: Unknown error occured. Process stopped.\";\n"
+           << "        return 1;\n"
+           << "    }\n"
+           << "\n"
+           << "    return 0;\n"
+           << "}\n";
+}
+
+
+std::string CppEmitter::stringLiteral(const std::string &str) {
+
+    /* Returns @str as C++ string literal.
+     * Non-printable symbols are written in octal form, so they can't merge with next symbols. */
+
+    std::ostringstream literal;
+    literal << '"';
+
+    for (std::size_t i=0; i<str.size(); ++i) {
+        unsigned char symbol = (unsigned char)str[i];
+
+        if (symbol == '"' || symbol == '\\' || symbol == '?')
+            literal << '\\' << symbol;
+        else if (symbol == '\n')
+            literal << "\\n\"\n    \"";
+        else if (symbol < 32 || symbol >= 127) {
+            literal << '\\'
+                    << (char)('0' + ((symbol >> 6) & 7))
+                    << (char)('0' + ((symbol >> 3) & 7))
+                    << (char)('0' + (symbol & 7));
+        }
+        else
+            literal << symbol;
+    }
+
+    literal << '"';
+    return literal.str();
+}
+
+
+std::string CppEmitter::charLiteral(char symbol) {
+
+    /* Returns @symbol as C++ character literal. */
+
+    if (symbol == '"')
+        return "'\"'";
+    if (symbol == '\'')
+        return "'\\''";
+
+    std::string literal = stringLiteral(std::string(1, symbol));
+    literal[0] = literal[literal.size() - 1] = '\'';
+    return literal;
+}
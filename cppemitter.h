@@ -0,0 +1,40 @@
+#ifndef CPPEMITTER_H
+#define CPPEMITTER_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+
+class Alphabet;
+class RuleSet;
+
+
+/* Generates standalone C++ program, that executes the loaded instructions.
+ * Rules are hard-coded into the program: search dispatches on the symbol of the word
+ * by switch and checks replaceble parts by unrolled comparisons of literals,
+ * execution dispatches on the instruction number with constant lengths.
+ * The program prints the same trace as Interpreter does; non-ASCII symbols are
+ * translated between UTF-8 and units by a table of the alphabet. */
+class CppEmitter {
+public:
+    CppEmitter(const RuleSet &rules, const Alphabet &alphabet);
+
+    void emit(std::ostream &stream, const std::string &sourceName, const std::string &instructionsTable) const;
+
+private:
+    void emitFindInstruction(std::ostream &stream) const;
+    void emitExecuteInstruction(std::ostream &stream) const;
+    void emitWideSymbols(std::ostream &stream) const;
+    void emitMain(std::ostream &stream) const;
+
+    static std::string stringLiteral(const std::string &str);
+    static std::string charLiteral(char symbol);
+
+private:
+    const RuleSet &mRules;
+    const Alphabet &mAlphabet;
+};
+
+
+#endif // CPPEMITTER_H
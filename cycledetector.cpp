@@ -0,0 +1,69 @@
+#include "cycledetector.h"
+#include "word.h"
+
+#include <assert.h>
+
+
+CycleDetector::CycleDetector() :
+    mSavedHash(0), mSavedStep(0), mPower(1), mCycleLength(0) {}
+
+
+void CycleDetector::reset(const Word &word) {
+
+    /* Starts detection from the source @word (step 0). Word hashing must be enabled. */
+
+    mPower = 1;
+    mCycleLength = 0;
+    save(word, 0);
+}
+
+
+bool CycleDetector::check(const Word &word, std::size_t step) {
+
+    /* Must be called with the word after every @step.
+     * Returns true if the word is equal to the word of some previous step. */
+
+
+#ifndef NDEBUG
+    assert(step > mSavedStep);
+#endif
+
+    const std::size_t distance = step - mSavedStep;
+
+    if (word.hash() == mSavedHash && word.size() == mSavedWord.size()
+            && word.compare(0, mSavedWord.data(), mSavedWord.size())) {
+        mCycleLength = distance;
+        return true;
+    }
+
+    if (distance == mPower) {
+        save(word, step);
+        mPower *= 2;
+    }
+
+    return false;
+}
+
+
+std::size_t CycleDetector::cycleLength() const {
+
+    /* Returns the number of steps in the found cycle (0 if not found). */
+
+    return mCycleLength;
+}
+
+
+std::size_t CycleDetector::cycleStep() const {
+
+    /* Returns the step, which word was repeated. */
+
+    return mSavedStep;
+}
+
+
+void CycleDetector::save(const Word &word, std::size_t step) {
+    mSavedWord.clear();
+    word.appendTo(mSavedWord);
+    mSavedHash = word.hash();
+    mSavedStep = step;
+}
@@ -0,0 +1,38 @@
+#ifndef CYCLEDETECTOR_H
+#define CYCLEDETECTOR_H
+
+#include <string>
+#include <stdint.h>
+
+
+class Word;
+
+
+/* Detects repetition of the word with Brent's algorithm.
+ * The word is saved at steps 0, 1, 2, 4, 8... (every time the distance from the saved step
+ * reaches the next power of two), and every next word is compared with the saved one
+ * by its rolling hash; the words are compared completely only if the hashes are equal.
+ * Repetition is found at most about two cycles after the cycle begins. */
+class CycleDetector {
+public:
+    CycleDetector();
+
+    void reset(const Word &word);
+    bool check(const Word &word, std::size_t step);
+
+    std::size_t cycleLength() const;
+    std::size_t cycleStep() const;
+
+private:
+    void save(const Word &word, std::size_t step);
+
+private:
+    std::string mSavedWord;
+    uint64_t mSavedHash;
+    std::size_t mSavedStep;
+    std::size_t mPower;
+    std::size_t mCycleLength;
+};
+
+
+#endif // CYCLEDETECTOR_H
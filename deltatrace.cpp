@@ -0,0 +1,548 @@
+#include "deltatrace.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+#define TRACE_MAGIC               "MNATRACE"
+#define TRACE_INDEX_MAGIC         "MNATINDX"
+#define TRACE_FORMAT_VERSION      1
+#define TRACE_BYTE_ORDER          0x01020304u
+#define BUFFER_SIZE               (1 << 20)
+#define MIN_KEYFRAME_DISTANCE     (1 << 16)     /* bytes of steps between keyframes */
+
+/* Tags of records; tag of step is the index of its instruction + STEP_TAG. */
+#define KEYFRAME_TAG              0
+#define END_TAG                   1
+#define STEP_TAG                  2
+
+
+namespace {
+
+struct TraceHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+};
+
+
+uint64_t encodeDelta(std::size_t pos, std::size_t previous) {
+
+    /* Zigzag encoding of signed distance: small distances both ways give small numbers. */
+
+    const int64_t delta = (int64_t)pos - (int64_t)previous;
+    return ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+}
+
+
+std::size_t decodeDelta(uint64_t number, std::size_t previous) {
+    const int64_t delta = (int64_t)(number >> 1) ^ -(int64_t)(number & 1);
+    return (std::size_t)((int64_t)previous + delta);
+}
+
+}
+
+
+/* Writes the word of keyframe to the trace. */
+class DeltaTraceWriter::WordWriter : public WordChunkVisitor {
+public:
+    WordWriter(DeltaTraceWriter &writer) : mWriter(writer) {}
+
+    bool visit(const char *chunk, std::size_t size) {
+        mWriter.write(chunk, size);
+        return true;
+    }
+
+    bool visitRun(char symbol, std::size_t count) {
+        char symbols[256];
+        std::memset(symbols, symbol, sizeof(symbols));
+        for (std::size_t size; count > 0; count -= size) {
+            size = std::min(count, sizeof(symbols));
+            mWriter.write(symbols, size);
+        }
+        return true;
+    }
+
+private:
+    DeltaTraceWriter &mWriter;
+};
+
+
+
+DeltaTraceWriter::DeltaTraceWriter(const std::string &fileName, const RuleSet &rules, const Alphabet &alphabet) :
+    mFileName(fileName), mRules(rules), mAlphabet(alphabet),
+    mFile(0), mUsed(0), mOffset(0), mLastPosition(0), mKeyframeOffset(0) {}
+
+
+DeltaTraceWriter::~DeltaTraceWriter() {
+    if (mFile)
+        std::fclose(mFile);
+}
+
+
+void DeltaTraceWriter::start(const MarkovContext &context) {
+
+    /* Creates the file and writes the alphabet, the instructions and the first keyframe. */
+
+    mFile = std::fopen(mFileName.c_str(), "wb");
+    if (! mFile) {
+        mError = "Can't create file \"" + mFileName + "\".";
+        return;
+    }
+
+    /* The file is written by the buffer of the trace. */
+    std::setvbuf(mFile, 0, _IONBF, 0);
+    mBuffer.resize(BUFFER_SIZE);
+    mUsed = 0;
+    mOffset = 0;
+    mKeyframes.clear();
+
+    TraceHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_FORMAT_VERSION;
+    header.byteOrder = TRACE_BYTE_ORDER;
+    write(&header, sizeof(header));
+
+    const std::string symbols = mAlphabet.symbols();
+    writeNumber(symbols.size());
+    write(symbols.data(), symbols.size());
+
+    writeNumber(mRules.instructionsCount());
+    for (std::size_t i=0; i<mRules.instructionsCount(); ++i) {
+        writeNumber(mRules.replacebleLength(i));
+        write(mRules.replaceble(i), mRules.replacebleLength(i));
+        writeNumber(mRules.replacerLength(i));
+        write(mRules.replacer(i), mRules.replacerLength(i));
+        writeNumber(mRules.isErasing(i) ? 1 : 0);
+    }
+
+    writeKeyframe(context.execution());
+}
+
+
+void DeltaTraceWriter::step(const MarkovContext &context) {
+
+    /* Writes the last step of @context; keyframe follows, when the steps outweigh the word. */
+
+    if (! mFile)
+        return;
+
+    const Execution &execution = context.execution();
+    writeNumber(execution.lastInstruction() + STEP_TAG);
+    writeNumber(encodeDelta(execution.lastPosition(), mLastPosition));
+    mLastPosition = execution.lastPosition();
+
+    const uint64_t distance = mOffset + mUsed - mKeyframeOffset;
+    if (distance >= MIN_KEYFRAME_DISTANCE && distance >= execution.word().size())
+        writeKeyframe(execution);
+}
+
+
+void DeltaTraceWriter::finish(const MarkovContext &context) {
+
+    /* Writes the stop reason and the index of keyframes and closes the file. */
+
+    if (! mFile)
+        return;
+
+    const Execution &execution = context.execution();
+    writeNumber(END_TAG);
+    writeNumber(execution.stopReason());
+    writeNumber(execution.stepsCount());
+
+    const uint64_t indexOffset = mOffset + mUsed;
+    const uint64_t count = mKeyframes.size() / 2;
+    write(&count, sizeof(count));
+    write(mKeyframes.data(), mKeyframes.size() * sizeof(uint64_t));
+    write(&indexOffset, sizeof(indexOffset));
+    write(TRACE_INDEX_MAGIC, 8);
+    flushBuffer();
+
+    const bool isClosed = std::fclose(mFile) == 0;
+    mFile = 0;
+    if (! isClosed && mError.empty())
+        mError = "Can't write file \"" + mFileName + "\".";
+}
+
+
+const std::string& DeltaTraceWriter::error() const {
+    return mError;
+}
+
+
+void DeltaTraceWriter::writeKeyframe(const Execution &execution) {
+
+    /* Writes the whole word after the last step. Positions of the next steps are counted from 0. */
+
+    mKeyframes.push_back(execution.stepsCount());
+    mKeyframes.push_back(mOffset + mUsed);
+
+    writeNumber(KEYFRAME_TAG);
+    writeNumber(execution.stepsCount());
+    writeNumber(execution.lastInstruction());
+    writeNumber(execution.word().size());
+
+    WordWriter writer(*this);
+    execution.word().scan(writer);
+    mLastPosition = 0;
+    mKeyframeOffset = mOffset + mUsed;
+}
+
+
+void DeltaTraceWriter::writeNumber(uint64_t number) {
+
+    /* Writes @number by 7 bits, the high bit marks that more bytes follow. */
+
+    if (mBuffer.size() - mUsed < 10)
+        flushBuffer();
+
+    while (number >= 0x80) {
+        mBuffer[mUsed++] = (char)(number | 0x80);
+        number >>= 7;
+    }
+    mBuffer[mUsed++] = (char)number;
+}
+
+
+void DeltaTraceWriter::write(const void *data, std::size_t size) {
+    const char *bytes = (const char *)data;
+    while (size > 0) {
+        if (mUsed == mBuffer.size())
+            flushBuffer();
+
+        const std::size_t count = std::min(size, mBuffer.size() - mUsed);
+        std::memcpy(&mBuffer[mUsed], bytes, count);
+        mUsed += count;
+        bytes += count;
+        size -= count;
+    }
+}
+
+
+void DeltaTraceWriter::flushBuffer() {
+
+    /* Writes the buffer to the file. After the first failure the trace is not written any more,
+     * but the offsets are counted, so the records stay consistent. */
+
+    if (mUsed > 0 && mError.empty() && std::fwrite(&mBuffer[0], 1, mUsed, mFile) != mUsed)
+        mError = "Can't write file \"" + mFileName + "\".";
+
+    mOffset += mUsed;
+    mUsed = 0;
+}
+
+
+
+DeltaTraceReader::DeltaTraceReader() :
+    mPos(0), mStepsStart(0), mLastStep(0), mIsFinished(false), mStopReason(Execution::NotStopped),
+    mStepsCount(0), mLastInstruction(0), mLastPosition(0) {}
+
+
+bool DeltaTraceReader::open(const std::string &fileName) {
+
+    /* Reads the alphabet, the instructions and the index of keyframes of trace "fileName".
+     * Trace without the index (of the crashed process) is scanned up to its last whole step.
+     * Returns false if the file is not a trace (see error()). */
+
+    if (! mFile.open(fileName)) {
+        mError = "Can't open file \"" + fileName + "\".";
+        return false;
+    }
+
+    TraceHeader header;
+    if (mFile.size() < sizeof(header))
+        return fail("The file is not a trace.");
+
+    std::memcpy(&header, mFile.data(), sizeof(header));
+    if (std::memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+            || header.byteOrder != TRACE_BYTE_ORDER || header.version != TRACE_FORMAT_VERSION)
+        return fail("The file is not a trace of this version of the interpreter.");
+
+    mPos = sizeof(header);
+    uint64_t size = 0;
+    if (! readNumber(size) || size > mFile.size() - mPos)
+        return fail("The trace is damaged.");
+    mAlphabet.assign(mFile.data() + mPos, (std::size_t)size);
+    mPos += (std::size_t)size;
+
+    uint64_t count = 0;
+    if (! readNumber(count))
+        return fail("The trace is damaged.");
+
+    mInstructions.clear();
+    for (uint64_t i=0; i<count; ++i) {
+        Instruction instruction;
+        uint64_t length = 0, flags = 0;
+
+        if (! readNumber(length) || length > mFile.size() - mPos)
+            return fail("The trace is damaged.");
+        instruction.replaceble.assign(mFile.data() + mPos, (std::size_t)length);
+        mPos += (std::size_t)length;
+
+        if (! readNumber(length) || length > mFile.size() - mPos)
+            return fail("The trace is damaged.");
+        instruction.replacer.assign(mFile.data() + mPos, (std::size_t)length);
+        mPos += (std::size_t)length;
+
+        if (! readNumber(flags))
+            return fail("The trace is damaged.");
+
+        instruction.isErasing = (flags & 1) != 0;
+        mInstructions.push_back(instruction);
+    }
+    mStepsStart = mPos;
+
+    /* Index follows the end record: keyframes count, pairs (step, offset), offset of the index, magic. */
+    const std::size_t trailerSize = 2 * sizeof(uint64_t);
+    const char *trailer = mFile.data() + mFile.size() - trailerSize;
+    uint64_t indexOffset = 0;
+    if (mFile.size() < mStepsStart + trailerSize || std::memcmp(trailer + sizeof(uint64_t), TRACE_INDEX_MAGIC, 8) != 0)
+        return scan();
+
+    std::memcpy(&indexOffset, trailer, sizeof(indexOffset));
+    std::memcpy(&count, mFile.data() + std::min<uint64_t>(indexOffset, mFile.size() - trailerSize), sizeof(count));
+    if (indexOffset < mStepsStart || count > (mFile.size() - trailerSize - indexOffset) / (2 * sizeof(uint64_t)))
+        return scan();
+
+    mKeyframes.clear();
+    for (uint64_t i=0; i<count; ++i) {
+        uint64_t pair[2];
+        std::memcpy(pair, mFile.data() + indexOffset + sizeof(uint64_t) * (1 + 2 * i), sizeof(pair));
+        mKeyframes.push_back(std::make_pair((std::size_t)pair[0], (std::size_t)pair[1]));
+    }
+
+    /* The end record precedes the index, its position is not stored: the last keyframe is followed
+     * by at most MIN_KEYFRAME_DISTANCE or word size of steps, they are scanned. */
+    if (mKeyframes.empty())
+        return fail("The trace is damaged.");
+    mStepsStart = mKeyframes.back().second;
+    return scan();
+}
+
+
+std::size_t DeltaTraceReader::firstStep() const {
+
+    /* Returns the number of the first step (it is not 0 for the trace of resumed execution). */
+
+    return mKeyframes.empty() ? 0 : mKeyframes.front().first;
+}
+
+
+std::size_t DeltaTraceReader::lastStep() const {
+    return mLastStep;
+}
+
+
+std::size_t DeltaTraceReader::keyframesCount() const {
+    return mKeyframes.size();
+}
+
+
+bool DeltaTraceReader::isFinished() const {
+
+    /* Returns true if the trace was closed after the last step, false if the writer was interrupted. */
+
+    return mIsFinished;
+}
+
+
+Execution::StopReason DeltaTraceReader::stopReason() const {
+    return mStopReason;
+}
+
+
+const Alphabet& DeltaTraceReader::alphabet() const {
+    return mAlphabet;
+}
+
+
+std::size_t DeltaTraceReader::instructionsCount() const {
+    return mInstructions.size();
+}
+
+
+bool DeltaTraceReader::seek(std::size_t step) {
+
+    /* Restores the word after @step steps from the nearest keyframe before it.
+     * Returns false if the step is not in the trace. */
+
+    std::vector<std::pair<std::size_t, std::size_t> >::const_iterator keyframe =
+            std::upper_bound(mKeyframes.begin(), mKeyframes.end(), std::make_pair(step, (std::size_t)-1));
+    if (keyframe == mKeyframes.begin() || step > mLastStep) {
+        mError = "The trace has no such step.";
+        return false;
+    }
+
+    mPos = (--keyframe)->second;
+    if (! readKeyframe(true))
+        return false;
+
+    while (mStepsCount < step) {
+        if (! next())
+            return fail("The trace is damaged.");
+    }
+    return true;
+}
+
+
+bool DeltaTraceReader::next() {
+
+    /* Executes the next step of the trace. Returns false after the last step. */
+
+    for (;;) {
+        const std::size_t pos = mPos;
+        uint64_t tag = 0;
+        if (mStepsCount >= mLastStep || ! readNumber(tag) || tag == END_TAG)
+            return false;
+
+        if (tag >= STEP_TAG)
+            return readStep(tag);
+
+        /* The next keyframe has the same word, only positions are counted from it. */
+        mPos = pos;
+        if (! readKeyframe(false))
+            return false;
+    }
+}
+
+
+std::size_t DeltaTraceReader::stepsCount() const {
+    return mStepsCount;
+}
+
+
+std::size_t DeltaTraceReader::lastInstruction() const {
+    return mLastInstruction;
+}
+
+
+const Word& DeltaTraceReader::word() const {
+    return mWord;
+}
+
+
+const std::string& DeltaTraceReader::error() const {
+    return mError;
+}
+
+
+bool DeltaTraceReader::readNumber(uint64_t &number) {
+
+    /* Reads variable-length number (see DeltaTraceWriter::writeNumber()). */
+
+    number = 0;
+    for (unsigned shift=0; mPos < mFile.size() && shift < 64; shift += 7) {
+        const unsigned char byte = (unsigned char)mFile.data()[mPos++];
+        number |= (uint64_t)(byte & 0x7F) << shift;
+        if (! (byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+
+bool DeltaTraceReader::readKeyframe(bool isAssigning) {
+
+    /* Reads the keyframe at the current position (to the word, if @isAssigning). */
+
+    uint64_t tag = 0, step = 0, instruction = 0, size = 0;
+    if (! readNumber(tag) || tag != KEYFRAME_TAG || ! readNumber(step) || ! readNumber(instruction)
+            || ! readNumber(size) || size > mFile.size() - mPos)
+        return fail("The trace is damaged.");
+
+    if (isAssigning)
+        mWord.assign(mFile.data() + mPos, (std::size_t)size);
+    mPos += (std::size_t)size;
+    mStepsCount = (std::size_t)step;
+    mLastInstruction = (std::size_t)instruction;
+    mLastPosition = 0;
+    return true;
+}
+
+
+bool DeltaTraceReader::readStep(uint64_t tag) {
+
+    /* Applies the step with @tag: replaces the occurrence of the instruction and adds system symbols
+     * the same way as Execution does. */
+
+    uint64_t delta = 0;
+    const uint64_t index = tag - STEP_TAG;
+    if (index >= mInstructions.size() || ! readNumber(delta))
+        return fail("The trace is damaged.");
+
+    const Instruction &instruction = mInstructions[(std::size_t)index];
+    const std::size_t pos = decodeDelta(delta, mLastPosition);
+    const std::size_t length = instruction.replaceble.size();
+    if (pos > mWord.size() || length > mWord.size() - pos)
+        return fail("The trace is damaged.");
+
+    if (instruction.isErasing)
+        mWord.erase(pos, length);
+    else
+        mWord.replace(pos, length, instruction.replacer);
+
+    if (mWord.at(0) != '!')
+        mWord.addFirstSymbol();
+    if (mWord.at(mWord.size() - 1) != '@')
+        mWord.addLastSymbol();
+
+    ++mStepsCount;
+    mLastInstruction = (std::size_t)index;
+    mLastPosition = pos;
+    return true;
+}
+
+
+bool DeltaTraceReader::scan() {
+
+    /* Reads the records from mStepsStart to the end record (or the last whole step), collecting
+     * keyframes, the number of the last step and the stop reason. */
+
+    mPos = mStepsStart;
+    mLastStep = (std::size_t)-1;
+    std::size_t steps = 0;
+    bool hasKeyframe = false;
+
+    for (;;) {
+        const std::size_t pos = mPos;
+        uint64_t tag = 0, number = 0;
+        if (! readNumber(tag))
+            break;
+
+        if (tag == KEYFRAME_TAG) {
+            uint64_t step = 0, instruction = 0, size = 0;
+            if (! readNumber(step) || ! readNumber(instruction) || ! readNumber(size) || size > mFile.size() - mPos)
+                break;
+            if (mKeyframes.empty() || mKeyframes.back().first < step)
+                mKeyframes.push_back(std::make_pair((std::size_t)step, pos));
+            mPos += (std::size_t)size;
+            steps = (std::size_t)step;
+            hasKeyframe = true;
+        }
+        else if (tag == END_TAG) {
+            uint64_t reason = 0;
+            if (readNumber(reason) && readNumber(number)) {
+                mIsFinished = true;
+                mStopReason = (Execution::StopReason)reason;
+            }
+            break;
+        }
+        else if (readNumber(number))
+            ++steps;
+        else
+            break;
+    }
+
+    if (! hasKeyframe)
+        return fail("The trace has no steps.");
+
+    mLastStep = steps;
+    return true;
+}
+
+
+bool DeltaTraceReader::fail(const char *message) {
+    mError = message;
+    return false;
+}
@@ -0,0 +1,126 @@
+#ifndef DELTATRACE_H
+#define DELTATRACE_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "libmna.h"
+#include "mappedfile.h"
+
+
+/* Compact binary trace of execution: every step is recorded as its instruction and the position
+ * of the replaced occurrence (delta from the previous one), both as variable-length numbers,
+ * so a step takes 2-3 bytes whatever the length of the word. Removed and inserted symbols
+ * are the replaceble part and the replacer of the instruction, the table of instructions and
+ * the alphabet are written once at the beginning. The whole word is written as a keyframe
+ * at the beginning and whenever the steps after the previous keyframe take as many bytes as the word,
+ * so the trace is at most twice as large as its steps and any step is restored from the nearest
+ * keyframe by replaying at most the size of the word of steps.
+ *
+ * File:  header, alphabet, instructions, keyframe, steps and keyframes..., end, index of keyframes.
+ * Trace of the crashed process has no end and index, DeltaTraceReader reads it by scanning. */
+
+
+/* Writes the trace of the run (see MarkovTrace). */
+class DeltaTraceWriter : public MarkovTrace {
+public:
+    DeltaTraceWriter(const std::string &fileName, const RuleSet &rules, const Alphabet &alphabet);
+    ~DeltaTraceWriter();
+
+    void start(const MarkovContext &context);
+    void step(const MarkovContext &context);
+    void finish(const MarkovContext &context);
+
+    const std::string& error() const;
+
+private:
+    DeltaTraceWriter(const DeltaTraceWriter &);
+    DeltaTraceWriter& operator=(const DeltaTraceWriter &);
+
+    class WordWriter;
+
+    void writeKeyframe(const Execution &execution);
+    inline void writeNumber(uint64_t number);
+    void write(const void *data, std::size_t size);
+    void flushBuffer();
+
+private:
+    const std::string mFileName;
+    const RuleSet &mRules;
+    const Alphabet &mAlphabet;
+
+    std::FILE *mFile;
+    std::vector<char> mBuffer;
+    std::size_t mUsed;                      /* bytes of the buffer */
+    uint64_t mOffset;                       /* offset of the buffer in the file */
+
+    std::size_t mLastPosition;              /* of the previous step */
+    uint64_t mKeyframeOffset;               /* of the end of the last keyframe */
+    std::vector<uint64_t> mKeyframes;       /* pairs (step, offset) */
+    std::string mError;
+};
+
+
+/* Restores the word at any step of the trace. */
+class DeltaTraceReader {
+public:
+    DeltaTraceReader();
+
+    bool open(const std::string &fileName);
+
+    std::size_t firstStep() const;
+    std::size_t lastStep() const;
+    std::size_t keyframesCount() const;
+    bool isFinished() const;
+    Execution::StopReason stopReason() const;
+    const Alphabet& alphabet() const;
+    std::size_t instructionsCount() const;
+
+    bool seek(std::size_t step);
+    bool next();
+
+    std::size_t stepsCount() const;
+    std::size_t lastInstruction() const;
+    const Word& word() const;
+
+    const std::string& error() const;
+
+private:
+    DeltaTraceReader(const DeltaTraceReader &);
+    DeltaTraceReader& operator=(const DeltaTraceReader &);
+
+    struct Instruction {
+        std::string replaceble;
+        std::string replacer;
+        bool isErasing;
+    };
+
+    bool readNumber(uint64_t &number);
+    bool readKeyframe(bool isAssigning);
+    bool readStep(uint64_t tag);
+    bool scan();
+    bool fail(const char *message);
+
+private:
+    MappedFile mFile;
+    std::size_t mPos;                       /* of the next record */
+    std::size_t mStepsStart;                /* offset of the first record */
+
+    Alphabet mAlphabet;
+    std::vector<Instruction> mInstructions;
+    std::vector<std::pair<std::size_t, std::size_t> > mKeyframes;     /* (step, offset) */
+    std::size_t mLastStep;
+    bool mIsFinished;
+    Execution::StopReason mStopReason;
+
+    Word mWord;
+    std::size_t mStepsCount;
+    std::size_t mLastInstruction;
+    std::size_t mLastPosition;
+    std::string mError;
+};
+
+
+#endif // DELTATRACE_H
@@ -0,0 +1,543 @@
+#include "differentialfuzzer.h"
+#include "libmna.h"
+
+#include <algorithm>
+#include <exception>
+#include <sstream>
+#include <stdexcept>
+
+
+#define MAX_SYMBOLS         4
+#define MAX_WORD_LENGTH     12
+#define MAX_INSTRUCTIONS    6
+#define MAX_PART_LENGTH     3
+#define LONG_WORD_CHANCE    16          /* one of programs has the word for the parallel search */
+#define LONG_WORD_LENGTH    (1 << 14)
+#define SEARCH_THREADS      3
+
+
+/* Symbols of the generated alphabets; multi-byte UTF-8 symbols take the wide units of Alphabet. */
+static const char* const SYMBOLS_POOL[] = {
+    "a", "b", "c", "0", "1", "x", "y", "z",
+    "\xCE\xB1", "\xD0\xB6", "\xE2\x82\xAC", "\xF0\x9D\x84\x9E"         /* alpha, zhe, euro, G clef */
+};
+static const std::size_t SYMBOLS_POOL_SIZE = sizeof(SYMBOLS_POOL) / sizeof(SYMBOLS_POOL[0]);
+
+
+/* Reads the input of libFuzzer byte by byte; the input, that is over, reads as zeros. */
+class ByteReader {
+public:
+    ByteReader(const uint8_t *data, std::size_t size) : mData(data), mSize(size), mPos(0) {}
+
+    std::size_t next(std::size_t bound) {
+
+        /* Returns the next number below @bound. */
+
+        const std::size_t value = mPos < mSize ? mData[mPos++] : 0;
+        return value % bound;
+    }
+
+private:
+    const uint8_t *mData;
+    std::size_t mSize;
+    std::size_t mPos;
+};
+
+
+static std::size_t symbolsCount(const std::string &text, std::size_t size) {
+
+    /* Returns the number of UTF-8 symbols in the first @size bytes of @text. */
+
+    std::size_t count = 0;
+    for (std::size_t pos=0; pos<size; ++count)
+        pos += Alphabet::symbolLength(text.data() + pos, size - pos);
+    return count;
+}
+
+
+static std::vector<std::size_t> symbolOffsets(const std::string &text) {
+
+    /* Returns the offsets of the symbols of @text and its size. */
+
+    std::vector<std::size_t> offsets;
+    for (std::size_t pos=0; pos<text.size(); pos+=Alphabet::symbolLength(text.data() + pos, text.size() - pos))
+        offsets.push_back(pos);
+    offsets.push_back(text.size());
+    return offsets;
+}
+
+
+static std::string decodedWord(const Execution &execution, const Alphabet &alphabet) {
+
+    /* Returns UTF-8 text of the word of @execution. */
+
+    const std::string units = execution.word().str();
+    std::string text;
+    alphabet.decode(units.data(), units.size(), text);
+    return text;
+}
+
+
+
+/* The first interpreter, that defines the result of every step (see DifferentialFuzzer). */
+class DifferentialFuzzer::Reference {
+public:
+    Reference(const Program &program, std::size_t maxSteps, std::size_t maxWordLength) :
+        mProgram(program), mMaxSteps(maxSteps), mMaxWordLength(maxWordLength), mWord(program.word),
+        mWordLength(symbolsCount(program.word, program.word.size())), mStepsCount(0), mLastInstruction(0),
+        mLastPosition(0), mStopReason(Execution::NotStopped) {
+
+        mHistory.push_back(mWord);
+    }
+
+    bool step() {
+
+        /* Executes the lowest-numbered instruction at its leftmost occurrence.
+         * Returns false if execution is over. Throws std::out_of_range, if the word gets empty. */
+
+        if (mStopReason != Execution::NotStopped)
+            return false;
+
+        std::size_t index = 0, pos = std::string::npos;
+        for (; index<mProgram.instructions.size(); ++index) {
+            pos = mWord.find(mProgram.instructions[index].replaceble);
+            if (pos != std::string::npos)
+                break;
+        }
+
+        if (pos == std::string::npos) {
+            mStopReason = Execution::NoInstructionFound;
+            return false;
+        }
+
+        if (mMaxSteps && mStepsCount >= mMaxSteps) {
+            mStopReason = Execution::StepsLimitReached;
+            return false;
+        }
+
+        const Instruction &instruction = mProgram.instructions[index];
+        mLastPosition = symbolsCount(mWord, pos);
+        mWordLength -= symbolsCount(instruction.replaceble, instruction.replaceble.size());
+        if (instruction.replacer == "!")
+            mWord.erase(pos, instruction.replaceble.size());
+        else {
+            mWord.replace(pos, instruction.replaceble.size(), instruction.replacer);
+            mWordLength += symbolsCount(instruction.replacer, instruction.replacer.size());
+        }
+
+        if (mWord.at(0) != '!') {
+            mWord.insert(0, "!");
+            ++mWordLength;
+        }
+        if (mWord.at(mWord.size() - 1) != '@') {
+            mWord.push_back('@');
+            ++mWordLength;
+        }
+
+        ++mStepsCount;
+        mLastInstruction = index;
+        mHistory.push_back(mWord);
+
+        if (instruction.isFinal)
+            mStopReason = Execution::FinalInstructionExecuted;
+        else if (mMaxWordLength && mWordLength > mMaxWordLength)
+            mStopReason = Execution::WordLengthLimitReached;
+
+        return true;
+    }
+
+    const std::string& word() const { return mWord; }
+    std::size_t stepsCount() const { return mStepsCount; }
+    std::size_t lastInstruction() const { return mLastInstruction; }
+    std::size_t lastPosition() const { return mLastPosition; }        /* in symbols */
+    Execution::StopReason stopReason() const { return mStopReason; }
+
+    /* Returns the word after @step steps. */
+    const std::string& history(std::size_t step) const { return mHistory[step]; }
+
+private:
+    const Program &mProgram;
+    const std::size_t mMaxSteps;
+    const std::size_t mMaxWordLength;
+
+    std::string mWord;
+    std::size_t mWordLength;            /* symbols */
+    std::size_t mStepsCount;
+    std::size_t mLastInstruction;
+    std::size_t mLastPosition;
+    Execution::StopReason mStopReason;
+    std::vector<std::string> mHistory;
+};
+
+
+
+std::string DifferentialFuzzer::Program::text() const {
+
+    /* Returns the program as the text of .mna file. */
+
+    std::string text = "T={";
+    for (std::size_t i=0; i<symbols.size(); ++i) {
+        if (i > 0)
+            text += ',';
+        text += symbols[i];
+    }
+    text += "}\nV=" + word + "\n";
+
+    for (std::size_t i=0; i<instructions.size(); ++i) {
+        text += instructions[i].replaceble;
+        text += instructions[i].isFinal ? "->." : "->";
+        text += instructions[i].replacer + "\n";
+    }
+    return text;
+}
+
+
+
+DifferentialFuzzer::DifferentialFuzzer(std::size_t maxSteps, std::size_t maxWordLength) :
+    mMaxSteps(maxSteps), mMaxWordLength(maxWordLength), mSearchPool(new ThreadPool(SEARCH_THREADS)),
+    mCheckedCount(0), mRejectedCount(0) {
+
+    /* Every engine executes at most @maxSteps steps, words are limited by @maxWordLength symbols. */
+
+    static const struct {
+        const char *name;
+        Execution::MatchingMode matchingMode;
+        Execution::WordRepresentation wordRepresentation;
+    } combinations[] = {
+        { "sequential, gap buffer",  Execution::SequentialMatching,  Execution::GapBufferWord },
+        { "automaton, gap buffer",   Execution::AutomatonMatching,   Execution::GapBufferWord },
+        { "incremental, gap buffer", Execution::IncrementalMatching, Execution::GapBufferWord },
+        { "sequential, run-length",  Execution::SequentialMatching,  Execution::RunLengthWord },
+        { "automaton, run-length",   Execution::AutomatonMatching,   Execution::RunLengthWord },
+        { "incremental, run-length", Execution::IncrementalMatching, Execution::RunLengthWord }
+    };
+
+    for (std::size_t i=0; i<sizeof(combinations) / sizeof(combinations[0]); ++i) {
+        Engine engine;
+        engine.name = combinations[i].name;
+        engine.options.matchingMode = combinations[i].matchingMode;
+        engine.options.wordRepresentation = combinations[i].wordRepresentation;
+        engine.options.maxSteps = maxSteps;
+        engine.options.maxWordLength = maxWordLength;
+        mEngines.push_back(engine);
+    }
+
+    Engine engine = mEngines[1];
+    engine.name = "automaton, gap buffer, parallel search";
+    engine.options.searchPool = mSearchPool.get();
+    engine.options.parallelSearchSize = 0;
+    mEngines.push_back(engine);
+
+    engine = mEngines[1];
+    engine.name = "automaton, gap buffer, cycle detection";
+    engine.options.isDetectingCycles = true;
+    mEngines.push_back(engine);
+
+    engine = mEngines[5];
+    engine.name = "incremental, run-length, cycle detection";
+    engine.options.isDetectingCycles = true;
+    mEngines.push_back(engine);
+}
+
+
+DifferentialFuzzer::Program DifferentialFuzzer::generate(std::mt19937 &random) {
+
+    /* Returns random program: up to MAX_SYMBOLS symbols, the word of them (sometimes long enough
+     * for the parallel search), up to MAX_INSTRUCTIONS instructions of the symbols and,
+     * in half of programs, the system symbols. */
+
+    std::uniform_int_distribution<std::size_t> percent(0, 99);
+    Program program;
+
+    std::vector<std::string> pool(SYMBOLS_POOL, SYMBOLS_POOL + SYMBOLS_POOL_SIZE);
+    std::shuffle(pool.begin(), pool.end(), random);
+    pool.resize(std::uniform_int_distribution<std::size_t>(1, MAX_SYMBOLS)(random));
+    program.symbols = pool;
+
+    std::uniform_int_distribution<std::size_t> symbol(0, program.symbols.size() - 1);
+    if (percent(random) < 100 / LONG_WORD_CHANCE) {
+
+        /* Long runs, so the instructions occur rarely and the chunks of the search matter. */
+        for (std::size_t length=0; length<LONG_WORD_LENGTH; ) {
+            const std::string &runSymbol = program.symbols[symbol(random)];
+            for (std::size_t run=std::uniform_int_distribution<std::size_t>(1, LONG_WORD_LENGTH / 4)(random);
+                 run>0; --run, ++length)
+                program.word += runSymbol;
+        }
+    }
+    else {
+        const std::size_t length = std::uniform_int_distribution<std::size_t>(1, MAX_WORD_LENGTH)(random);
+        for (std::size_t i=0; i<length; ++i)
+            program.word += program.symbols[symbol(random)];
+    }
+
+    std::vector<std::string> partSymbols = program.symbols;
+    if (percent(random) < 50) {
+        partSymbols.push_back("!");
+        partSymbols.push_back("@");
+    }
+    std::uniform_int_distribution<std::size_t> partSymbol(0, partSymbols.size() - 1);
+    std::uniform_int_distribution<std::size_t> partLength(1, MAX_PART_LENGTH);
+
+    const std::size_t count = std::uniform_int_distribution<std::size_t>(1, MAX_INSTRUCTIONS)(random);
+    for (std::size_t i=0; i<count; ++i) {
+        Instruction instruction;
+        for (std::size_t length=partLength(random); length>0; --length)
+            instruction.replaceble += partSymbols[partSymbol(random)];
+
+        if (percent(random) < 25)
+            instruction.replacer = "!";
+        else
+            for (std::size_t length=partLength(random); length>0; --length)
+                instruction.replacer += partSymbols[partSymbol(random)];
+
+        instruction.isFinal = percent(random) < 15;
+        program.instructions.push_back(instruction);
+    }
+
+    return program;
+}
+
+
+DifferentialFuzzer::Program DifferentialFuzzer::decode(const uint8_t *data, std::size_t size) {
+
+    /* Builds the program from the input of libFuzzer the same way, as generate() does,
+     * taking every choice from the next byte. */
+
+    ByteReader reader(data, size);
+    Program program;
+
+    const std::size_t symbolsCount = 1 + reader.next(MAX_SYMBOLS);
+    while (program.symbols.size() < symbolsCount) {
+        const std::string symbol = SYMBOLS_POOL[reader.next(SYMBOLS_POOL_SIZE)];
+        if (std::find(program.symbols.begin(), program.symbols.end(), symbol) == program.symbols.end())
+            program.symbols.push_back(symbol);
+        else if (reader.next(2) == 0)
+            break;
+    }
+
+    const std::size_t length = 1 + reader.next(MAX_WORD_LENGTH);
+    for (std::size_t i=0; i<length; ++i)
+        program.word += program.symbols[reader.next(program.symbols.size())];
+
+    std::vector<std::string> partSymbols = program.symbols;
+    if (reader.next(2)) {
+        partSymbols.push_back("!");
+        partSymbols.push_back("@");
+    }
+    const std::size_t count = 1 + reader.next(MAX_INSTRUCTIONS);
+    for (std::size_t i=0; i<count; ++i) {
+        Instruction instruction;
+        for (std::size_t length=1+reader.next(MAX_PART_LENGTH); length>0; --length)
+            instruction.replaceble += partSymbols[reader.next(partSymbols.size())];
+
+        if (reader.next(4) == 0)
+            instruction.replacer = "!";
+        else
+            for (std::size_t length=1+reader.next(MAX_PART_LENGTH); length>0; --length)
+                instruction.replacer += partSymbols[reader.next(partSymbols.size())];
+
+        instruction.isFinal = reader.next(8) == 0;
+        program.instructions.push_back(instruction);
+    }
+
+    return program;
+}
+
+
+bool DifferentialFuzzer::check(const Program &program, Divergence &divergence) {
+
+    /* Executes @program by the reference machine and every engine in lockstep.
+     * Returns false if some engine diverges from the reference (see @divergence).
+     * Programs, that are not accepted by the loader, are counted and pass. */
+
+    divergence = Divergence();
+
+    MarkovAlgorithm algorithm;
+    algorithm.setSourceWordOnly(true);
+    if (! algorithm.parse(program.text())) {
+        ++mRejectedCount;
+        return true;
+    }
+
+    ++mCheckedCount;
+    for (std::size_t i=0; i<mEngines.size(); ++i)
+        if (! checkEngine(program, algorithm.rules(), algorithm.alphabet(), mEngines[i], divergence))
+            return false;
+
+    return true;
+}
+
+
+bool DifferentialFuzzer::checkEngine(const Program &program, const RuleSet &rules, const Alphabet &alphabet,
+                                     const Engine &engine, Divergence &divergence) const {
+
+    /* Compares every step of @engine with the reference: the result of the step, the number
+     * of steps, the instruction and its position, the word (decoded by @alphabet) and the stop reason.
+     * Cycle, that is detected by the engine, must be the repetition of the reference word. */
+
+    Reference reference(program, mMaxSteps, mMaxWordLength);
+    Execution execution(rules, engine.options);
+    std::ostringstream description;
+
+    divergence.engine = engine.name;
+
+    try {
+        execution.start(rules.sourceWord(), rules.sourceWordSize());
+    } catch (std::exception &e) {
+        divergence.description = std::string("start() throws ") + e.what() + ".";
+        return false;
+    }
+
+    if (decodedWord(execution, alphabet) != reference.word()) {
+        description << "Source word is \"" << decodedWord(execution, alphabet)
+                    << "\" instead of \"" << reference.word() << "\".";
+        divergence.description = description.str();
+        return false;
+    }
+
+    for (;;) {
+        divergence.step = reference.stepsCount() + 1;
+
+        bool isReferenceStep = false, isReferenceThrown = false;
+        try {
+            isReferenceStep = reference.step();
+        } catch (std::out_of_range &) {
+            isReferenceThrown = true;
+        }
+
+        bool isStep = false;
+        std::string exception;
+        try {
+            isStep = execution.step();
+        } catch (std::exception &e) {
+            exception = e.what();
+            if (exception.empty())
+                exception = "exception";
+        }
+
+        if (isReferenceThrown || ! exception.empty()) {
+            if (! isReferenceThrown)
+                description << "Step throws " << exception << ", the reference does not.";
+            else if (exception.empty())
+                description << "Step does not throw, the reference throws std::out_of_range on the empty word.";
+            else
+                break;
+        }
+        else if (isStep != isReferenceStep)
+            description << "Step returns " << isStep << " instead of " << isReferenceStep
+                        << " (stop reason: \"" << Execution::stopReasonText(execution.stopReason())
+                        << "\" instead of \"" << Execution::stopReasonText(reference.stopReason()) << "\").";
+        else if (execution.stepsCount() != reference.stepsCount())
+            description << "Steps count is " << execution.stepsCount() << " instead of " << reference.stepsCount() << ".";
+        else if (isStep && (execution.lastInstruction() != reference.lastInstruction()
+                            || execution.lastPosition() != reference.lastPosition()))
+            description << "Instruction " << execution.lastInstruction() + 1 << " at " << execution.lastPosition()
+                        << " is executed instead of " << reference.lastInstruction() + 1
+                        << " at " << reference.lastPosition() << ".";
+        else if (decodedWord(execution, alphabet) != reference.word())
+            description << "Word is \"" << decodedWord(execution, alphabet)
+                        << "\" instead of \"" << reference.word() << "\".";
+        else if (execution.stopReason() == Execution::CycleDetected) {
+            const std::size_t step = execution.cycleStep();
+            if (step >= execution.stepsCount() || execution.stepsCount() - step != execution.cycleLength()
+                    || reference.history(step) != reference.word())
+                description << "Cycle of " << execution.cycleLength() << " steps from step " << step
+                            << " is detected, but the word of that step is \"" << reference.history(step) << "\".";
+            else
+                break;
+        }
+        else if (execution.stopReason() != reference.stopReason())
+            description << "Stop reason is \"" << Execution::stopReasonText(execution.stopReason())
+                        << "\" instead of \"" << Execution::stopReasonText(reference.stopReason()) << "\".";
+        else if (! isStep)
+            break;
+
+        if (! description.str().empty()) {
+            divergence.description = description.str();
+            return false;
+        }
+    }
+
+    divergence = Divergence();
+    return true;
+}
+
+
+void DifferentialFuzzer::minimize(Program &program, Divergence &divergence) {
+
+    /* Reduces diverging @program (see reduce()) while it still diverges.
+     * @divergence is updated to the divergence of the reduced program. */
+
+    for (bool isReduced = true; isReduced; ) {
+        isReduced = false;
+
+        std::vector<Program> candidates;
+        reduce(program, candidates);
+        for (std::size_t i=0; i<candidates.size() && ! isReduced; ++i) {
+            Divergence candidateDivergence;
+            if (! check(candidates[i], candidateDivergence)) {
+                program = candidates[i];
+                divergence = candidateDivergence;
+                isReduced = true;
+            }
+        }
+    }
+}
+
+
+void DifferentialFuzzer::reduce(const Program &program, std::vector<Program> &candidates) {
+
+    /* Collects the programs, that are smaller than @program by one change: without an instruction,
+     * without a piece of the word (halves first, then quarters... single symbols),
+     * without a symbol of an instruction, with erasing or not final instruction. */
+
+    for (std::size_t i=0; i<program.instructions.size() && program.instructions.size() > 1; ++i) {
+        candidates.push_back(program);
+        candidates.back().instructions.erase(candidates.back().instructions.begin() + i);
+    }
+
+    const std::vector<std::size_t> word = symbolOffsets(program.word);
+    const std::size_t length = word.size() - 1;
+    for (std::size_t piece=length/2; piece>0; piece/=2) {
+        for (std::size_t pos=0; pos+piece<=length; pos+=piece) {
+            candidates.push_back(program);
+            candidates.back().word.erase(word[pos], word[pos + piece] - word[pos]);
+        }
+    }
+
+    for (std::size_t i=0; i<program.instructions.size(); ++i) {
+        const Instruction &instruction = program.instructions[i];
+
+        const std::vector<std::size_t> replaceble = symbolOffsets(instruction.replaceble);
+        for (std::size_t pos=0; pos+1<replaceble.size() && replaceble.size() > 2; ++pos) {
+            candidates.push_back(program);
+            candidates.back().instructions[i].replaceble.erase(replaceble[pos], replaceble[pos + 1] - replaceble[pos]);
+        }
+
+        if (instruction.replacer != "!") {
+            const std::vector<std::size_t> replacer = symbolOffsets(instruction.replacer);
+            for (std::size_t pos=0; pos+1<replacer.size() && replacer.size() > 2; ++pos) {
+                candidates.push_back(program);
+                candidates.back().instructions[i].replacer.erase(replacer[pos], replacer[pos + 1] - replacer[pos]);
+            }
+            candidates.push_back(program);
+            candidates.back().instructions[i].replacer = "!";
+        }
+
+        if (instruction.isFinal) {
+            candidates.push_back(program);
+            candidates.back().instructions[i].isFinal = false;
+        }
+    }
+}
+
+
+uint64_t DifferentialFuzzer::checkedCount() const {
+    return mCheckedCount;
+}
+
+
+uint64_t DifferentialFuzzer::rejectedCount() const {
+    return mRejectedCount;
+}
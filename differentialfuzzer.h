@@ -0,0 +1,90 @@
+#ifndef DIFFERENTIALFUZZER_H
+#define DIFFERENTIALFUZZER_H
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "execution.h"
+#include "threadpool.h"
+
+
+class Alphabet;
+
+
+/* Differential testing of the execution engines: random algorithms are executed step by step
+ * by the reference machine and by every combination of matching mode and word representation
+ * (and the parallel search and cycle detection), which must agree on every step.
+ *
+ * The reference machine is the definition of the algorithm, as the first interpreter executed it:
+ * the word is std::string of UTF-8 symbols (positions and lengths are counted in symbols), instructions are searched in order by std::string::find(),
+ * replacer "!" erases the occurrence, and after every step "!" is inserted at the beginning
+ * and "@" at the end of the word, if they are not there (std::string::at() throws on the empty word).
+ * It knows nothing about the loader, the analysis, the automaton and the storages, which are checked.
+ *
+ * Programs come from the generator (seed) or from the bytes of libFuzzer (decode());
+ * the program, that diverges, is minimized while it still diverges. */
+class DifferentialFuzzer {
+public:
+    struct Instruction {
+        std::string replaceble;
+        std::string replacer;           /* "!" - erasing */
+        bool isFinal;
+    };
+
+    struct Program {
+        std::vector<std::string> symbols;       /* of the alphabet, UTF-8 */
+        std::string word;                       /* UTF-8, as the parts of the instructions */
+        std::vector<Instruction> instructions;
+
+        std::string text() const;
+    };
+
+    struct Divergence {
+        Divergence() : step(0) {}
+
+        std::string engine;             /* empty - engines agree */
+        std::size_t step;
+        std::string description;
+    };
+
+    DifferentialFuzzer(std::size_t maxSteps = 200, std::size_t maxWordLength = 1 << 16);
+
+    static Program generate(std::mt19937 &random);
+    static Program decode(const uint8_t *data, std::size_t size);
+
+    bool check(const Program &program, Divergence &divergence);
+    void minimize(Program &program, Divergence &divergence);
+
+    uint64_t checkedCount() const;
+    uint64_t rejectedCount() const;
+
+private:
+    DifferentialFuzzer(const DifferentialFuzzer &);
+    DifferentialFuzzer& operator=(const DifferentialFuzzer &);
+
+    struct Engine {
+        const char *name;
+        Execution::Options options;
+    };
+
+    class Reference;
+
+    static void reduce(const Program &program, std::vector<Program> &candidates);
+    bool checkEngine(const Program &program, const RuleSet &rules, const Alphabet &alphabet,
+                     const Engine &engine, Divergence &divergence) const;
+
+private:
+    const std::size_t mMaxSteps;
+    const std::size_t mMaxWordLength;
+    std::vector<Engine> mEngines;
+    std::unique_ptr<ThreadPool> mSearchPool;
+
+    uint64_t mCheckedCount;
+    uint64_t mRejectedCount;            /* programs, that the loader does not accept */
+};
+
+
+#endif // DIFFERENTIALFUZZER_H
@@ -0,0 +1,455 @@
+#include "execution.h"
+#include "ruleset.h"
+#include "watchdog.h"
+
+#include <algorithm>
+
+#include <assert.h>
+
+
+/* See Execution::chooseMatchingMode(). */
+#define AUTOMATON_SYMBOLS_PER_INSTRUCTION 8
+
+
+static WordStorage* createWordStorage(Execution::WordRepresentation representation) {
+    if (representation == Execution::RunLengthWord)
+        return new RunLengthStorage();
+    return new GapBufferStorage();
+}
+
+
+Execution::Execution(const RuleSet &rules, const Options &options) :
+    mRules(rules), mOptions(options), mMatchingMode(SequentialMatching), mWord(createWordStorage(options.wordRepresentation)), mProfiler(0),
+    mStepsCount(0), mLastInstruction(0), mLastPosition(0), mStopReason(NotStopped) {}
+
+
+void Execution::setOptions(const Options &options) {
+
+    /* Matching mode and word representation change only the cost of execution, not its result.
+     * Takes effect on the next start(). */
+
+    if (options.wordRepresentation != mOptions.wordRepresentation)
+        mWord.setStorage(createWordStorage(options.wordRepresentation));
+    mOptions = options;
+}
+
+
+void Execution::setProfiler(InstructionsProfiler *profiler) {
+
+    /* Sets @profiler, that records the next executions (0 - no profiling).
+     * Steps are compiled with and without profiling, so unprofiled execution pays nothing for it. */
+
+    mProfiler = profiler;
+}
+
+
+void Execution::start(const char *word, std::size_t size) {
+
+    /* Begins new execution with source word @word.
+     * Buffers of the previous execution are reused. */
+
+    mMatchingMode = mOptions.matchingMode == AutoMatching ? chooseMatchingMode(size) : mOptions.matchingMode;
+    mWord.setHashing(mOptions.isDetectingCycles);
+    mWord.assign(word, size);
+    mStepsCount = 0;
+    mLastInstruction = 0;
+    mLastPosition = 0;
+    mStopReason = NotStopped;
+    mCycleInstructions.clear();
+
+    if (mProfiler)
+        mProfiler->reset(mRules.instructionsCount());
+
+    if (mOptions.isDetectingCycles)
+        mCycleDetector.reset(mWord);
+
+    if (mMatchingMode == IncrementalMatching) {
+        mMatchIndex.build(mRules);
+        mMatchIndex.reset(mWord);
+    }
+}
+
+
+void Execution::resume(const char *word, std::size_t size, std::size_t stepsCount, std::size_t lastInstruction) {
+
+    /* Continues execution, that was interrupted after @stepsCount steps with word @word
+     * (see Checkpoint). Limit of steps counts the steps before interruption too.
+     * Cycles are detected from this word only. */
+
+    start(word, size);
+    mStepsCount = stepsCount;
+    mLastInstruction = lastInstruction;
+}
+
+
+bool Execution::step() {
+
+    /* Executes the lowest-numbered instruction at its leftmost occurrence.
+     * Returns false if execution is over (see stopReason()): no one instruction occurs in the word,
+     * final instruction was executed at the previous step, the word repeated or a limit is reached. */
+
+    if (mProfiler)
+        return executeStep(*mProfiler);
+
+    NoProfiling noProfiling;
+    return executeStep(noProfiling);
+}
+
+
+void Execution::run() {
+
+    /* Executes all steps without any output. */
+
+    if (mProfiler) {
+        while (executeStep(*mProfiler))
+            ;
+        return;
+    }
+
+    NoProfiling noProfiling;
+    while (executeStep(noProfiling))
+        ;
+}
+
+
+bool Execution::run(std::size_t maxStepsCount) {
+
+    /* Executes up to @maxStepsCount steps without any output.
+     * Returns false if execution is over. */
+
+    std::size_t count = 0;
+
+    if (mProfiler) {
+        while (count < maxStepsCount && executeStep(*mProfiler))
+            ++count;
+    }
+    else {
+        NoProfiling noProfiling;
+        while (count < maxStepsCount && executeStep(noProfiling))
+            ++count;
+    }
+
+    return mStopReason == NotStopped;
+}
+
+
+template <class Profiler>
+bool Execution::executeStep(Profiler &profiler) {
+
+    /* See step(). Every step is recorded by @profiler.
+     * Limits of time and memory are checked by the watchdog, here only its alarm is read. */
+
+    if (mStopReason != NotStopped)
+        return false;
+
+    if (mOptions.watchdog) {
+        switch (mOptions.watchdog->alarm()) {
+        case Watchdog::TimeAlarm:
+            mStopReason = TimeLimitReached;
+            return false;
+        case Watchdog::MemoryAlarm:
+            mStopReason = MemoryLimitReached;
+            return false;
+        default:
+            break;
+        }
+    }
+
+    profiler.beginStep();
+
+    std::size_t index = 0, pos = 0;
+    if (! findInstruction(index, pos, profiler)) {
+        profiler.selected(std::string::npos);
+        mStopReason = NoInstructionFound;
+        return false;
+    }
+
+    profiler.selected(index);
+
+    if (mOptions.maxSteps && mStepsCount >= mOptions.maxSteps) {
+        mStopReason = StepsLimitReached;
+        return false;
+    }
+
+    executeInstruction(index, pos, profiler);
+    profiler.endStep(index);
+
+    ++mStepsCount;
+    mLastInstruction = index;
+    mLastPosition = pos;
+
+    if (mRules.isFinal(index))
+        mStopReason = FinalInstructionExecuted;
+    else if (mOptions.maxWordLength && mWord.size() > mOptions.maxWordLength)
+        mStopReason = WordLengthLimitReached;
+    else if (mOptions.isDetectingCycles && mCycleDetector.check(mWord, mStepsCount)) {
+        mStopReason = CycleDetected;
+        collectCycleInstructions();
+    }
+
+    return true;
+}
+
+
+Execution::MatchingMode Execution::matchingMode() const {
+
+    /* Returns matching mode of the current execution (the chosen one for AutoMatching). */
+
+    return mMatchingMode;
+}
+
+
+const Word& Execution::word() const {
+    return mWord;
+}
+
+
+std::size_t Execution::stepsCount() const {
+    return mStepsCount;
+}
+
+
+std::size_t Execution::lastInstruction() const {
+
+    /* Returns index of the instruction, executed at the last step. */
+
+    return mLastInstruction;
+}
+
+
+std::size_t Execution::lastPosition() const {
+
+    /* Returns position of the occurrence, that was replaced at the last step. */
+
+    return mLastPosition;
+}
+
+
+bool Execution::isFinished() const {
+
+    /* Returns true if execution was stopped by final instruction. */
+
+    return mStopReason == FinalInstructionExecuted;
+}
+
+
+Execution::StopReason Execution::stopReason() const {
+    return mStopReason;
+}
+
+
+bool Execution::isAbnormalStop(StopReason reason) {
+
+    /* Returns true if execution was stopped by a limit or a cycle, not finished by itself. */
+
+    return reason != NoInstructionFound && reason != FinalInstructionExecuted;
+}
+
+
+const char* Execution::stopReasonText(StopReason reason) {
+
+    /* Returns the end of the message "Execution stopped: ..." (without limit values). */
+
+    switch (reason) {
+    case NotStopped:
+        return "execution is not finished.";
+    case NoInstructionFound:
+        return "no one instruction can be executed.";
+    case FinalInstructionExecuted:
+        return "final instruction is executed.";
+    case CycleDetected:
+        return "the word repeats, execution never stops.";
+    case StepsLimitReached:
+        return "limit of steps is reached.";
+    case WordLengthLimitReached:
+        return "limit of the word length is reached.";
+    case MemoryLimitReached:
+        return "limit of memory is reached.";
+    case TimeLimitReached:
+        return "time limit is exceeded.";
+    default:
+        return "unknown reason.";
+    }
+}
+
+
+bool Execution::isCycleDetected() const {
+
+    /* Returns true if execution was stopped because the word repeated:
+     * the algorithm never stops. */
+
+    return mStopReason == CycleDetected;
+}
+
+
+std::size_t Execution::cycleLength() const {
+    return mCycleDetector.cycleLength();
+}
+
+
+std::size_t Execution::cycleStep() const {
+
+    /* Returns the step, which word is repeated by the last step. */
+
+    return mCycleDetector.cycleStep();
+}
+
+
+const std::vector<std::size_t>& Execution::cycleInstructions() const {
+
+    /* Returns indexes of the instructions, that are executed in the cycle, in ascending order. */
+
+    return mCycleInstructions;
+}
+
+
+Execution::MatchingMode Execution::chooseMatchingMode(std::size_t wordSize) const {
+
+    /* Chooses matching mode for AutoMatching by the number of matched instructions
+     * and the length of the source word (see README for the measurements).
+     * The automaton costs the length of the word per step, whatever the number of instructions,
+     * so it is chosen for a word, that is short for the number of instructions, and for
+     * the parallel search, that only it has. Otherwise occurrences are kept between steps:
+     * the cost of a step depends on the instructions around the edit, not on the word length,
+     * and the sequential search is not faster even for a few instructions. */
+
+    if (mOptions.searchPool)
+        return AutomatonMatching;
+
+    std::size_t count = 0;
+    for (std::size_t i=0; i<mRules.instructionsCount(); ++i) {
+        if (! mRules.isPruned(i))
+            ++count;
+    }
+
+    if (wordSize < count * AUTOMATON_SYMBOLS_PER_INSTRUCTION)
+        return AutomatonMatching;
+    return IncrementalMatching;
+}
+
+
+void Execution::collectCycleInstructions() {
+
+    /* Execution is deterministic, so passing the cycle once more returns the same word.
+     * Steps of this pass are not counted and not profiled. */
+
+    NoProfiling noProfiling;
+    for (std::size_t i=0; i<mCycleDetector.cycleLength(); ++i) {
+        std::size_t index = 0, pos = 0;
+        if (! findInstruction(index, pos, noProfiling))
+            break;
+
+        executeInstruction(index, pos, noProfiling);
+        mCycleInstructions.push_back(index);
+    }
+
+    std::sort(mCycleInstructions.begin(), mCycleInstructions.end());
+    mCycleInstructions.erase(std::unique(mCycleInstructions.begin(), mCycleInstructions.end()),
+                             mCycleInstructions.end());
+}
+
+
+template <class Profiler>
+bool Execution::findInstruction(std::size_t &index, std::size_t &pos, Profiler &profiler) {
+
+    /* Looks for the lowest-numbered instruction, that occurs in the word, and its leftmost position.
+     * Returns false if no one instruction can be executed.
+     * Incremental index is searched by its updates (see executeInstruction()).
+     * Large words are scanned by the automaton in parallel, if the search pool is given (see Options). */
+
+    switch (mMatchingMode) {
+    case SequentialMatching:
+        for (index=0; index<mRules.instructionsCount(); ++index) {
+            if (mRules.isPruned(index))
+                continue;
+
+            const std::size_t length = mRules.replacebleLength(index);
+            pos = mWord.find(mRules.replaceble(index), length);
+            profiler.scanned(index, mWord, 0, pos != std::string::npos ? pos + length : std::string::npos);
+            if (pos != std::string::npos)
+                return true;
+        }
+        return false;
+
+    case IncrementalMatching:
+        return mMatchIndex.findFirst(index, pos);
+
+    default:
+        if (mOptions.searchPool && mOptions.wordRepresentation == GapBufferWord
+                && mWord.size() >= mOptions.parallelSearchSize) {
+            if (! mRules.matcher().findFirst(mWord, *mOptions.searchPool, mParallelSearch, index, pos))
+                return false;
+        } else if (! mRules.matcher().findFirst(mWord, index, pos))
+            return false;
+
+        profiler.scanned(index, mWord, 0, std::string::npos);
+        return true;
+    }
+}
+
+
+template <class Profiler>
+void Execution::executeInstruction(std::size_t index, std::size_t pos, Profiler &profiler) {
+
+    /* Executes instruction @index, which replaceble part occurs in the word at @pos.
+     * Edits of the word and of the matches index are recorded by @profiler. */
+
+
+    const std::size_t removed = mRules.replacebleLength(index);
+
+#ifndef NDEBUG
+    assert(index < mRules.instructionsCount());
+    assert(mWord.compare(pos, mRules.replaceble(index), removed));
+#endif
+
+    profiler.beginEdit(mWord);
+
+    std::size_t inserted = 0;
+    if (mRules.isErasing(index))
+        mWord.erase(pos, removed);
+    else {
+        inserted = mRules.replacerLength(index);
+        mWord.replace(pos, removed, mRules.replacer(index), inserted);
+    }
+
+    /* System symbols insertions are edits too - matches index must know about them. */
+    const bool incremental = (mMatchingMode == IncrementalMatching);
+    if (incremental)
+        mMatchIndex.update(mWord, pos, removed, inserted, profiler);
+
+    if (checkSystemFirstSymbol() && incremental)
+        mMatchIndex.update(mWord, 0, 0, 1, profiler);
+    if (checkSystemLastSymbol() && incremental)
+        mMatchIndex.update(mWord, mWord.size() - 1, 0, 1, profiler);
+
+    profiler.edited(index, mWord);
+}
+
+
+bool Execution::checkSystemFirstSymbol() {
+
+    /* Checks if first symbol of the word is "!".
+     * If not - inserts first symbol "!" and returns true.
+     * System symbols are virtual, so insertion does not move the word. */
+
+    if (mWord.at(0) != '!') {
+        mWord.addFirstSymbol();
+        return true;
+    }
+
+    return false;
+}
+
+
+bool Execution::checkSystemLastSymbol() {
+
+    /* Checks if last symbol of the word is "@".
+     * If not - inserts last symbol "@" and returns true.  */
+
+    if (mWord.at(mWord.size() - 1) != '@') {
+        mWord.addLastSymbol();
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,124 @@
+#ifndef EXECUTION_H
+#define EXECUTION_H
+
+#include <string>
+#include <vector>
+
+#include "word.h"
+#include "matcher.h"
+#include "matchindex.h"
+#include "cycledetector.h"
+#include "profiler.h"
+
+
+class RuleSet;
+class ThreadPool;
+class Watchdog;
+
+
+/* State of one execution of the rule set: the word, that is rewritten, and matching state.
+ * The rule set is only read, so one rule set can be shared by several executions
+ * (one per thread). */
+class Execution {
+public:
+    enum MatchingMode {
+        SequentialMatching,      /* every instruction is searched separately, in order */
+        AutomatonMatching,       /* one pass of multi-pattern automaton per step */
+        IncrementalMatching,     /* occurrences are kept and updated around every edit */
+        AutoMatching             /* one of the above, chosen at start by the rules and the word */
+    };
+
+    enum WordRepresentation {
+        GapBufferWord,           /* symbols in one buffer (see GapBufferStorage) */
+        RunLengthWord            /* runs of equal symbols (see RunLengthStorage) */
+    };
+
+    struct Options {
+        Options() :
+            matchingMode(AutoMatching), wordRepresentation(GapBufferWord), isDetectingCycles(false),
+            maxSteps(0), maxWordLength(0), watchdog(0), searchPool(0), parallelSearchSize(0) {}
+
+        MatchingMode matchingMode;
+        WordRepresentation wordRepresentation;
+        bool isDetectingCycles;     /* stop when the word repeats */
+        std::size_t maxSteps;       /* 0 - unlimited */
+        std::size_t maxWordLength;  /* 0 - unlimited */
+        const Watchdog *watchdog;   /* time and memory limits, may be shared by executions */
+
+        /* Words from @parallelSearchSize symbols are searched by chunks on @searchPool
+         * (automaton matching of gap buffer only). The pool can't be shared by executions. */
+        ThreadPool *searchPool;     /* 0 - serial search */
+        std::size_t parallelSearchSize;
+    };
+
+    enum StopReason {
+        NotStopped,
+        NoInstructionFound,
+        FinalInstructionExecuted,
+        CycleDetected,
+        StepsLimitReached,
+        WordLengthLimitReached,
+        MemoryLimitReached,
+        TimeLimitReached
+    };
+
+    static bool isAbnormalStop(StopReason reason);
+    static const char* stopReasonText(StopReason reason);
+
+    Execution(const RuleSet &rules, const Options &options = Options());
+
+    void setOptions(const Options &options);
+    void setProfiler(InstructionsProfiler *profiler);
+    void start(const char *word, std::size_t size);
+    void resume(const char *word, std::size_t size, std::size_t stepsCount, std::size_t lastInstruction);
+    bool step();
+    void run();
+    bool run(std::size_t maxStepsCount);
+
+    MatchingMode matchingMode() const;
+    const Word& word() const;
+    std::size_t stepsCount() const;
+    std::size_t lastInstruction() const;
+    std::size_t lastPosition() const;
+    bool isFinished() const;
+    StopReason stopReason() const;
+
+    bool isCycleDetected() const;
+    std::size_t cycleLength() const;
+    std::size_t cycleStep() const;
+    const std::vector<std::size_t>& cycleInstructions() const;
+
+private:
+    Execution(const Execution &);
+    Execution& operator=(const Execution &);
+
+    template <class Profiler>
+    bool executeStep(Profiler &profiler);
+    template <class Profiler>
+    bool findInstruction(std::size_t &index, std::size_t &pos, Profiler &profiler);
+    template <class Profiler>
+    void executeInstruction(std::size_t index, std::size_t pos, Profiler &profiler);
+    MatchingMode chooseMatchingMode(std::size_t wordSize) const;
+    void collectCycleInstructions();
+    inline bool checkSystemFirstSymbol();
+    inline bool checkSystemLastSymbol();
+
+private:
+    const RuleSet &mRules;
+    Options mOptions;
+    MatchingMode mMatchingMode;         /* of the current execution, never AutoMatching */
+    Word mWord;
+    IncrementalMatchIndex mMatchIndex;
+    CycleDetector mCycleDetector;
+    InstructionsMatcher::ParallelSearch mParallelSearch;
+    InstructionsProfiler *mProfiler;    /* 0 - execution is not profiled */
+
+    std::size_t mStepsCount;
+    std::size_t mLastInstruction;
+    std::size_t mLastPosition;
+    StopReason mStopReason;
+    std::vector<std::size_t> mCycleInstructions;
+};
+
+
+#endif // EXECUTION_H
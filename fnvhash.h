@@ -0,0 +1,40 @@
+#ifndef FNVHASH_H
+#define FNVHASH_H
+
+#include <cstring>
+#include <stdint.h>
+
+
+/* FNV-1a hash of bytes: checksums of the files and keys of the caches.
+ * Hash is continued by add() from FIRST, so several values can be hashed one after another. */
+struct FnvHash {
+    static const uint64_t FIRST = 14695981039346656037ull;
+    static const uint64_t PRIME = 1099511628211ull;
+
+    static uint64_t add(uint64_t hash, const char *data, std::size_t size) {
+        for (std::size_t i=0; i<size; ++i)
+            hash = (hash ^ (unsigned char)data[i]) * PRIME;
+        return hash;
+    }
+
+    static uint64_t add(uint64_t hash, uint64_t value) {
+        return add(hash, (const char *)&value, sizeof(value));
+    }
+
+    /* The same by 64-bit words (and single bytes of the tail): faster for big data,
+     * but the value differs from add(). */
+    static uint64_t addWords(uint64_t hash, const char *data, std::size_t size) {
+        std::size_t pos = 0;
+        for (; pos + 8 <= size; pos += 8) {
+            uint64_t word;
+            std::memcpy(&word, data + pos, 8);
+            hash = (hash ^ word) * PRIME;
+        }
+        for (; pos < size; ++pos)
+            hash = (hash ^ (unsigned char)data[pos]) * PRIME;
+        return hash;
+    }
+};
+
+
+#endif // FNVHASH_H
@@ -1,825 +1,764 @@
 #include "interpreter.h"
+#include "cppemitter.h"
+#include "batchrunner.h"
+#include "server.h"
+#include "resultcache.h"
+#include "deltatrace.h"
+#include "allocationcounter.h"
+#include "regressionrunner.h"
 
+#include <chrono>
 
-FileLinesInputStream::FileLinesInputStream(std::string &filename):
-    mInputStream(filename.c_str()), mCurrentLineNumber(0) {
-}
+#include <sstream>
 
 
-bool FileLinesInputStream::nextLine(std::string &str) {
+/* Interpeter */
+Interpreter::Interpreter() :
+    mTraceWriter(std::cout), mOutput(mTraceWriter.stream()),
+    mTraceLevel(StepsTrace), mTracePeriod(1),
+    mThreadsCount(0), mParallelSearchSize(0), mResultCacheSize(0), mIsTiming(false), mIsReportingAnalysis(false), mIsProfiling(false),
+    mCheckpointSteps(0), mCheckpointTime(0), mIsResuming(false), mLoadTime(0),
+    mTimeLimit(0), mMemoryLimit(0),
+    mContext(mAlgorithm), mDeltaTrace(0), mAllocationsCount(0), mIsLastPrinted(false) {}
 
-    /* Writes next line from file to @str.
-     * Returns true if no errors occured, otherwise - returns false. */
 
+void Interpreter::setMatchingMode(Execution::MatchingMode mode) {
 
-#ifndef NDEBUG
-    assert(! mInputStream.fail());
-#endif
-
-    if (std::getline(mInputStream, str)) {
-        ++mCurrentLineNumber;
-        return true;
-    }
+    /* Sets the way the next executable instruction is searched.
+     * Does not change the result of execution, only its cost. */
 
-    return false;
+    mExecutionOptions.matchingMode = mode;
+    mContext.setOptions(mExecutionOptions);
 }
 
 
-bool FileLinesInputStream::isOk() const {
-    return !mInputStream.fail();
-}
+void Interpreter::setWordRepresentation(Execution::WordRepresentation representation) {
 
+    /* Sets the way the word is stored while instructions are executed.
+     * Does not change the result of execution, only its cost. */
 
-std::size_t FileLinesInputStream::currentLineNumber() const {
-    return mCurrentLineNumber;
+    mExecutionOptions.wordRepresentation = representation;
+    mContext.setOptions(mExecutionOptions);
 }
 
 
-/* Alphabet */
-bool Alphabet::addSymbol(AlphabetSymbol symbol) {
-
-    /* Tries to add new symbol to the alphabet.
-     * If the symbol is already exists - returns False,
-     * otherwise - returns True.
-
-     * TODO: Improve correct Unicode support. */
+void Interpreter::setCycleDetection(bool isEnabled) {
 
-    if (! isSymbolPresent(symbol)){
-        mAlphabet.push_back(symbol);
-        return true;
-    }
+    /* If @isEnabled - execution is stopped when the word repeats,
+     * and the cycle is reported. */
 
-    return false;
+    mExecutionOptions.isDetectingCycles = isEnabled;
+    mContext.setOptions(mExecutionOptions);
 }
 
 
-bool Alphabet::isSymbolPresent(AlphabetSymbol symbol) const {
+void Interpreter::setLimits(std::size_t maxSteps, std::size_t maxWordLength, std::size_t maxMemory, double timeLimit) {
 
-    /* Returns True if symbol "symbol" is in the alphabet.
-     * Otherwise -returns False. */
+    /* Limits execution by the number of steps, length of the word, memory of the process (bytes)
+     * and wall-clock time (seconds). 0 means no limit.
+     * Memory and time are watched by separate thread (see Watchdog). */
 
-    std::list<AlphabetSymbol>::const_iterator it = mAlphabet.begin();
-    for (; it != mAlphabet.end(); ++it){
-        if ((*it) == symbol)
-            return true;
-    }
+    mExecutionOptions.maxSteps = maxSteps;
+    mExecutionOptions.maxWordLength = maxWordLength;
+    mExecutionOptions.watchdog = (maxMemory || timeLimit > 0) ? &mWatchdog : 0;
+    mContext.setOptions(mExecutionOptions);
 
-    return false;
+    mMemoryLimit = maxMemory;
+    mTimeLimit = timeLimit;
 }
 
 
-std::size_t Alphabet::symbolsCount() const {
-    return mAlphabet.size();
+void Interpreter::setTraceLevel(TraceLevel level, std::size_t period) {
+
+    /* Sets what is printed while instructions are executed.
+     * @period is used by EveryNthStepTrace only. */
+
+#ifndef NDEBUG
+    assert(period > 0);
+#endif
+
+    mTraceLevel = level;
+    mTracePeriod = period ? period : 1;
 }
 
 
+void Interpreter::setThreadsCount(std::size_t threadsCount) {
 
-/* Instruction */
-Instruction::Instruction() :
-    mIsFinal(false) {}
+    /* Sets the number of threads, that parse instructions and execute words of the batch.
+     * 0 - by the number of processors. */
 
-void Instruction::setReplaceble(std::string &replaceble) {
+    mThreadsCount = threadsCount;
+}
 
-    /* Sets replaceble part of instruction.
-     * Not checks if @replaceble is correct. */
 
+void Interpreter::setResultCache(const std::string &fileName, std::size_t maxSize) {
 
-#ifndef NDEBUG
-    assert(! replaceble.empty());
-#endif
+    /* If "fileName" is given - results of the batch are kept in it between runs (see ResultCache),
+     * words with known results are not executed. The file is limited by @maxSize bytes (0 - unlimited). */
 
-    mReplaceble = replaceble;
+    mResultCacheFileName = fileName;
+    mResultCacheSize = maxSize;
 }
 
 
-void Instruction::setReplacer(std::string &replacer) {
+void Interpreter::setDeltaTrace(const std::string &fileName) {
+
+    /* If "fileName" is given - every step of the file execution is written to it
+     * in the compact binary format (see DeltaTraceWriter), whatever the trace level is. */
 
-    /* Sets replacer part of instruction.
-     * Not checks if @replacer is correct. */
+    mDeltaTraceFileName = fileName;
+}
 
 
-#ifndef NDEBUG
-    assert(! replacer.empty());
-#endif
+void Interpreter::setParallelSearch(std::size_t minWordSize) {
 
-    mReplacer = replacer;
+    /* Words of the file from @minWordSize symbols are searched for instructions by all threads
+     * (see setThreadsCount()), every thread scans its part of the word. 0 - serial search. */
+
+    mParallelSearchSize = minWordSize;
 }
 
 
-void Instruction::setFinal(bool isFinal) {
+void Interpreter::setTiming(bool isEnabled) {
 
-    /* If @isFinal == true - instruction will be final.
-     * (No one instruction will be executed after current instuirction).
-     * Otherwise - instruction is not final.
-     *
-     * Not checks if @replacer is correct. */
+    /* If @isEnabled - time of loading and time of execution are shown separately at the end. */
 
-    mIsFinal = isFinal;
+    mIsTiming = isEnabled;
 }
 
 
-std::string& Instruction::replaceble() {
-
-    /* Returns replaceble part of instruction. */
+void Interpreter::setAnalysisReport(bool isEnabled) {
 
-#ifndef NDEBUG
-    assert (! mReplaceble.empty());
-#endif
+    /* If @isEnabled - instructions, that were removed by the analysis of the loaded file,
+     * are listed with the reason. */
 
-    return mReplaceble;
+    mIsReportingAnalysis = isEnabled;
 }
 
 
-std::string& Instruction::replacer() {
+void Interpreter::setProfiling(bool isEnabled, const std::string &reportFileName) {
 
-    /* Returns replacer part of instruction. */
-
-#ifndef NDEBUG
-    assert (! mReplacer.empty());
-#endif
+    /* If @isEnabled - execution of the file is profiled by instructions (see InstructionsProfiler):
+     * the report is printed at the end and written as JSON to file "reportFileName".
+     * Batch is not profiled. */
 
-    return mReplacer;
+    mIsProfiling = isEnabled;
+    mProfileFileName = reportFileName;
+    mContext.setProfiler(isEnabled ? &mProfiler : 0);
 }
 
 
-bool Instruction::isFinal() const {
+void Interpreter::setCheckpoints(const std::string &fileName, std::size_t stepsInterval, double timeInterval,
+                                 bool isResuming) {
 
-    return mIsFinal;
-}
+    /* If "fileName" is given - state of execution of the file is saved to it every @stepsInterval steps
+     * or every @timeInterval seconds (see Checkpoint). If @isResuming - execution is continued
+     * from the saved state instead of the source word. Batch is not checkpointed. */
 
+    mCheckpointFileName = fileName;
+    mCheckpointSteps = stepsInterval;
+    mCheckpointTime = timeInterval;
+    mIsResuming = isResuming;
+}
 
-bool Instruction::isOk() const {
 
-    /* Returns true if instruction is correct and can be executed,
-     * otherwise returns fasle. */
+int Interpreter::processFile(std::string &fileName) {
 
-    if (mReplaceble.empty())
-        return false;
+    /* Opens if possible file "filename", analise it's content,
+     * loads alphabet and instructions, and try to execute them.
+     * Returns exit code of the process. */
+
+    /* Only the source word is executed, so instructions, that are unreachable from it, are removed. */
+    mAlgorithm.setSourceWordOnly(true);
+    if (! loadFile(fileName))
+        return ErrorExit;
+
+    /* Only one word is executed, so the threads search in it (batch and server execute words in parallel). */
+    if (mParallelSearchSize) {
+        mSearchPool.reset(new ThreadPool(mThreadsCount));
+        Execution::Options options = mExecutionOptions;
+        options.searchPool = mSearchPool.get();
+        options.parallelSearchSize = mParallelSearchSize;
+        mContext.setOptions(options);
+    }
 
-    return true;
-}
+    /* Print all loaded instructions */
+    if (mTraceLevel != NoTrace && mTraceLevel != FinalTrace) {
+        mOutput << std::endl << "Loaded instructions: " << std::endl;
+        printAllInstructions(mOutput);
+    }
 
+    int result = executeInstructions();
+    if (! printProfile(fileName))
+        return ErrorExit;
 
+    printTiming();
+    return result;
+}
 
-/* Interpeter */
-bool Interpreter::processFile(std::string &fileName) {
 
-    /* Opens if possible file "filename", analise it's content,
-     * loads alphabet and instructions, and try to execute them. */
+int Interpreter::processBatch(std::string &fileName, std::string &inputFileName) {
 
+    /* Loads file "filename" once and executes its instructions for every word
+     * of file "inputFileName" (one word per line, "-" - standard input).
+     * Only result words are printed, one per line, in the order of the input.
+     * Returns ErrorExit if some word was not processed, otherwise exit code of the first word,
+     * that was stopped abnormally. */
 
-#ifndef NDEBUG
-    assert(! fileName.empty());
-#endif
+    if (! loadFile(fileName))
+        return ErrorExit;
 
-    /* Check for non-empty filename and try to open file. */
-    if (fileName.empty()) {
-        std::cout << "ERROR: No file specified. Process stopped.";
-        return false;
+    std::ifstream inputFile;
+    if (inputFileName != "-") {
+        inputFile.open(inputFileName.c_str());
+        if (! inputFile) {
+            mOutput << "Can't open file \"" << inputFileName << "\". Process stopped." << std::endl;
+            return ErrorExit;
+        }
     }
 
-    FileLinesInputStream inputFile(fileName);
-    if (! inputFile.isOk()) {
-        std::cout << "Can't open file \"" << fileName << "\". Process stopped." << std::endl;
-        return false;
+    BatchRunner runner(mAlgorithm.rules(), mAlgorithm.alphabet(), mExecutionOptions, mThreadsCount);
+
+    ResultCache cache(mResultCacheFileName, mResultCacheSize);
+    if (! mResultCacheFileName.empty()) {
+        if (! cache.open(ResultCache::key(mAlgorithm.rules(), mAlgorithm.alphabet(), mExecutionOptions))) {
+            mOutput << "ERROR: " << cache.error() << " Process stopped." << std::endl;
+            return ErrorExit;
+        }
+        runner.setResultCache(&cache);
     }
 
+    mWatchdog.start(mTimeLimit, mMemoryLimit);
+    bool isOk = runner.run(inputFileName == "-" ? std::cin : inputFile, mOutput);
+    mWatchdog.stop();
 
-    if (! loadAlphabet(inputFile))
-        return false;
+    if (! isOk)
+        return ErrorExit;
 
-    if (! loadSourceWord(inputFile))
-        return false;
+    if (! cache.error().empty())
+        mOutput << "WARNING: Results were not saved. " << cache.error() << std::endl;
 
-    if (! loadInstructions(inputFile))
-        return false;
+    printTiming();
+    if (mIsTiming && ! mResultCacheFileName.empty())
+        mOutput << "Result cache: " << cache.hits() << " hits, " << cache.misses() << " misses." << std::endl;
 
-    /* Print all loaded instructions */
-    std::cout << std::endl << "Loaded instructions: " << std::endl;
-    printAllInstructions();
+    /* Other limits are reported in the lines of the words. */
+    const Execution::StopReason reason = runner.firstStopReason();
+    if (reason == Execution::TimeLimitReached || reason == Execution::MemoryLimitReached)
+        printStop(reason);
 
-    return executeInstructions();
+    return runner.hasErrors() ? ErrorExit : exitCode(reason);
 }
 
 
-bool Interpreter::loadAlphabet(FileLinesInputStream &file) {
+int Interpreter::processServer(const std::string &socketPath, std::size_t cacheSize) {
 
-    /* Reads file line-by-line.
-     * Checks every non-empty and non-commented line for alphabet definition.
-     * Forms the list of all finded alphabetical symbols.
-     *
-     * TODO: Currently alphabet definition must be located in one line.
-     *       Improve posibility to write the definition in several lines. */
+    /* Serves requests of other programs (see Server) from standard input to standard output,
+     * or from connections of Unix domain socket "socketPath", if it is given.
+     * Up to @cacheSize loaded rule sets are kept between requests. Returns exit code of the process. */
 
+    Server server(mExecutionOptions, mThreadsCount, cacheSize);
 
-#ifndef NDEBUG
-    assert(file.isOk());
-#endif
+    if (socketPath.empty())
+        return server.serve(0, 1) ? SuccessExit : ErrorExit;
 
-    bool fileContainsErrors = false;
-    std::string line;
+    return server.listen(socketPath, mOutput) ? SuccessExit : ErrorExit;
+}
 
-    while (file.nextLine(line)) {
-        if (line.empty())
-            continue;
 
-        /* Ignore commented string. */
-        if (line.size() >= 2 && line.at(0) == '/' && line.at(1) == '/')
-            continue;
+int Interpreter::processReplay(std::string &fileName, std::size_t firstStep, std::size_t lastStep) {
 
-        std::size_t pos = 0;
+    /* Prints steps from @firstStep to @lastStep of the trace "fileName" (see DeltaTraceReader),
+     * or its last step if @firstStep is npos. Returns exit code of the process. */
 
-        /* Ignore space and tab symbols from beginning of line. */
-        for (; pos<line.size(); ++pos) {
-            if (line.at(pos) == ' ' || line.at(pos) == '\t')
-                continue;
-            else
-                break;
-        }
+    DeltaTraceReader reader;
+    if (! reader.open(fileName)) {
+        mOutput << "ERROR: " << reader.error() << " Process stopped." << std::endl;
+        return ErrorExit;
+    }
 
-        /* Check if end of the line is not reached.
-         * If so - ignore this line (it contains only uninformative symbols). */
-        if (pos >= line.size())
-            continue;
-
-
-        /* Infromative symbol detected.
-         * Check if it is "T" or "t", that defines start of alphabet's enum. */
-        if (line.at(pos) != 't' && line.at(pos) != 'T') {
-            std::cout << "[" << file.currentLineNumber() << "; " << pos << "] "
-                      << "Syntax error: invalid symbol detected. "
-                      << "\"T\" or \"t\" is expected as an symbol, that defines alphabet's enum."
-                      << std::endl;
-            fileContainsErrors = true;
-            break;
-        }
-        else
-            ++pos;
-
-        /* Ignore space and tab symbols between "T" and "=". */
-        for (; pos<line.size(); ++pos) {
-            if (line.at(pos) == ' ' || line.at(pos) == '\t')
-                continue;
-            else
-                break;
-        }
+    mOutput << "Trace of " << reader.instructionsCount() << " instructions: steps " << reader.firstStep()
+            << ".." << reader.lastStep() << ", " << reader.keyframesCount() << " keyframes." << std::endl;
+    if (! reader.isFinished())
+        mOutput << "WARNING: The trace was not finished, steps after " << reader.lastStep() << " are lost." << std::endl;
 
-        /* Check if end of the line is not reached. */
-        if (pos >= line.size()) {
-            std::cout << "[" << file.currentLineNumber() << "; " << pos << "] "
-                      << "Syntax error: unexpected end of line. \"=\" is expected."
-                      << std::endl;
-            fileContainsErrors = true;
-            break;
-        }
+    if (firstStep == std::string::npos)
+        firstStep = lastStep = reader.lastStep();
 
+    if (! reader.seek(firstStep)) {
+        mOutput << "ERROR: " << reader.error() << " Process stopped." << std::endl;
+        return ErrorExit;
+    }
 
-        /* Check for "=". */
-        if (line.at(pos) != '=') {
-            std::cout << "[" << file.currentLineNumber() << "; " << pos << "] "
-                      << "Syntax error: invalid symbol detected. \"=\" is expected."
-                      << std::endl;
-            fileContainsErrors = true;
-            break;
-        }
-        else
-            ++pos;
-
-        /* Ignore space and tab symbols between "=" and "{". */
-        for (; pos<line.size(); ++pos) {
-            if (line.at(pos) == ' ' || line.at(pos) == '\t')
-                continue;
-            else
-                break;
-        }
+    mOutput << std::endl;
+    printStepsCaption();
+    printReplayedStep(reader);
+    while (reader.stepsCount() < lastStep && reader.next())
+        printReplayedStep(reader);
 
-        /* Check if end of the line is not reached. */
-        if (pos >= line.size()) {
-            std::cout << "[" << file.currentLineNumber() << "; " << pos << "] "
-                      << "Syntax error: unexpected end of line, that defines alphabet. "
-                      << "\"{\" is expected."
-                      << std::endl;
-            fileContainsErrors = true;
-            break;
-        }
+    if (! reader.error().empty()) {
+        mOutput << "ERROR: " << reader.error() << " Process stopped." << std::endl;
+        return ErrorExit;
+    }
+    return SuccessExit;
+}
 
 
-        /* Check for "{". */
-        if (line.at(pos) != '{') {
-            std::cout << "[" << file.currentLineNumber() << "; " << pos << "] "
-                      << "Syntax error: invalid symbol detected. \"{\" is expected. "
-                      << std::endl;
-            fileContainsErrors = true;
-            return false;
-        }
-        else
-            ++pos;
-
-        /* Check if end of the line is not reached. */
-        if (pos+1 >= line.size()) {
-            std::cout << "[" << file.currentLineNumber() << "; " << pos << "] "
-                      << "Syntax error: unexpected end of line. Symbol of the alphabet is expected. "
-                      << std::endl;
-            fileContainsErrors = true;
-            break;
-        }
+int Interpreter::processRegression(const std::string &directory, const std::string &baselineFileName,
+                                   double tolerance, bool isUpdatingBaseline) {
 
+    /* Executes every algorithm file of "directory" and checks its result (see RegressionRunner).
+     * If "baselineFileName" is given, steps and speed are compared with it, or it is rewritten
+     * if @isUpdatingBaseline. Returns RegressionExit if some file failed or regressed. */
 
-        /* Load all defined letters into alphabet. */
-        for (; pos<line.size(); ++pos) {
-            if (line.at(pos) == '}')
-                break;
-
-
-            /* If comma is overrided by "\" - add it to the alphabet.
-             * Othrevise - ignore it as a separator. */
-            else if (line.at(pos) == '\\') {
-                if (line.size() >= pos+1 && line.at(pos+1) == ',') {
-                    if (! mAlphabet.addSymbol(',')) {
-                        std::cout << "[" << file.currentLineNumber() << "; " << pos << "] "
-                                  << "Warning: symbol \",\" is duplicated. "
-                                  << std::endl;
-
-                        /* At this instruction was checked 2 symbols of a line,
-                         * so we need to increment "pos" for correct analising of all next symbols. */
-                        ++pos;
-                        continue;
-                    }
-                }
-                else if (line.size() >= pos+1 && line.at(pos+1) == '\\') {
-                    if (! mAlphabet.addSymbol('\\')) {
-                        std::cout << "[" << file.currentLineNumber() << "; " << pos << "] "
-                                  << "Warning: symbol \"\\\" is duplicated. "
-                                  << std::endl;
-
-                        /* At this instruction was checked 2 symbols of a line,
-                         * so we need to increment "pos" for correct analising of all next symbols. */
-                        ++pos;
-                        continue;
-                    }
-                }
-                else
-                    continue;
-            }
-            else if (line.at(pos) == ','){
-                /* Ignore comma as a separator. */
-                continue;
-            }
-            else if (line.at(pos) == '\t'){
-                /* Ignore tab symbol. */
-                continue;
-            }
-            else if (! mAlphabet.addSymbol(line.at(pos))) {
-
-                /* Add all other symbols to alphabet */
-                std::cout << "[" << file.currentLineNumber() << "; " << pos << "] "
-                          << "Warning: symbol \"" << line.at(pos) << "\" is duplicated. "
-                          << std::endl;
-                continue;
-            }
-        }
+    RegressionRunner runner(mExecutionOptions, mTimeLimit, mThreadsCount);
+    if (! baselineFileName.empty())
+        runner.setBaseline(baselineFileName, tolerance, isUpdatingBaseline);
 
-        /* After loading all symbols from the alphabet
-         * we do not need to read next line from file. */
-        break;
-    }
+    if (! runner.run(directory, mOutput))
+        return ErrorExit;
+    return runner.isPassed() ? SuccessExit : RegressionExit;
+}
 
 
-    /* If errors occurred while file parsing - return negative result. */
-    if (fileContainsErrors) {
-        std::cout << "Alphabet was not loaded since errors occured. "
-                  << std::endl;
+bool Interpreter::emitCpp(std::string &fileName, std::string &outputFileName) {
+
+    /* Loads file "filename" and writes C++ program, that executes its instructions,
+     * to file "outputFileName" instead of executing them. */
+
+    if (! loadFile(fileName))
+        return false;
+
+    std::ofstream output(outputFileName.c_str());
+    if (! output) {
+        mOutput << "Can't create file \"" << outputFileName << "\". Process stopped." << std::endl;
         return false;
     }
 
-    /* Check if alphabet contains symbols.
-     * If not - return negative result, since algorithm can't work without alphabet. */
-    if (mAlphabet.symbolsCount() == 0) {
-        std::cout << "Alphabet was not loaded. "
-                  << "It is possible that current file does not contains alphabet definition at all. "
-                  << std::endl;
+    /* Generated program prints the same table of instructions as processFile() does. */
+    std::ostringstream table;
+    table << std::endl << "Loaded instructions: " << std::endl;
+    printAllInstructions(table);
+
+    CppEmitter emitter(mAlgorithm.rules(), mAlgorithm.alphabet());
+    emitter.emit(output, fileName, table.str());
+
+    output.close();
+    if (output.fail()) {
+        mOutput << "ERROR: Can't write file \"" << outputFileName << "\". Process stopped." << std::endl;
         return false;
     }
 
+    mOutput << "C++ program was written to \"" << outputFileName << "\"." << std::endl;
     return true;
 }
 
 
-bool Interpreter::loadSourceWord(FileLinesInputStream &file) {
+bool Interpreter::compileFile(std::string &fileName, std::string &outputFileName) {
 
-    /* Reads file line-by-line.
-     * Checks every non-empty and not-commented line for source word definition.
-     *
-     * TODO: Currently source word must be situated in one line.
-     *       Source word that situated in several lines will be parsed incorrect. */
+    /* Loads file "filename" and saves loaded rule set (with matching tables)
+     * to binary file "outputFileName", that can be executed without parsing. */
+
+    if (! loadFile(fileName))
+        return false;
+
+    if (! mAlgorithm.rules().save(outputFileName, mOutput))
+        return false;
+
+    mOutput << "Compiled rule set was written to \"" << outputFileName << "\"." << std::endl;
+    return true;
+}
+
+
+bool Interpreter::loadFile(std::string &fileName) {
+
+    /* Opens if possible file "filename" and loads alphabet, source word and instructions.
+     * Compiled rule set is mapped into memory as is, text file is parsed and compiled. */
 
 
 #ifndef NDEBUG
-    assert(file.isOk());
+    assert(! fileName.empty());
 #endif
 
-    /* Add system symbols to the alphabet. */
-    mAlphabet.addSymbol('!');
-    mAlphabet.addSymbol('@');
+    /* Check for non-empty filename and try to open file. */
+    if (fileName.empty()) {
+        mOutput << "ERROR: No file specified. Process stopped.";
+        return false;
+    }
+
+    const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    const bool isLoaded = mAlgorithm.load(fileName, mThreadsCount);
+    mLoadTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
 
+    mOutput << mAlgorithm.messages();
+    if (isLoaded && mIsReportingAnalysis && ! RuleSet::isCompiledFile(fileName))
+        printAnalysis();
 
-    bool fileContainsErrors = false;
-    std::string line;
+    return isLoaded;
+}
 
-    while (file.nextLine(line)) {
-        if (line.empty())
-            continue;
 
-        /* Ignore commented string. */
-        if (line.size() >= 2 && line.at(0) == '/' && line.at(1) == '/')
-            continue;
+void Interpreter::printAnalysis() {
 
-        std::size_t pos = 0;
+    /* Lists instructions, that were removed from matching after loading (see RulesAnalyzer).
+     * Compiled rule set keeps the result, so it is done only for text files. */
 
-        /* Ignore space and tab symbols from beginning of line. */
-        for (; pos<line.size(); ++pos) {
-            if (line.at(pos) == ' ' || line.at(pos) == '\t')
-                continue;
-            else
-                break;
-        }
+    const Alphabet &alphabet = mAlgorithm.alphabet();
+    const std::vector<RulesAnalyzer::Finding> &findings = mAlgorithm.removedInstructions();
+    for (std::size_t i=0; i<findings.size(); ++i) {
+        const RulesAnalyzer::Finding &finding = findings[i];
+        mOutput << "Instruction " << finding.instruction + 1 << " is removed: ";
 
-        /* Check if end of the line is not reached.
-         * If so - ignore this line (it contains only uninformative symbols). */
-        if (pos >= line.size())
-            continue;
-
-
-        /* Infromative symbol detected.
-         * Check if it is "V" or "v", that defines start of source word. */
-        if (line.at(pos) != 'v' && line.at(pos) != 'V') {
-            std::cout << "[" << file.currentLineNumber() << "; " << pos << "] "
-                      << "Syntax error: invalid symbol detected. "
-                      << "\"V\" or \"v\" is expected as an symbol, that defines beginnning of the source word."
-                      << std::endl;
-            fileContainsErrors = true;
-            break;
+        if (finding.verdict == RulesAnalyzer::UnreachableRule) {
+            std::string symbol;
+            alphabet.decode(&finding.symbol, 1, symbol);
+            mOutput << "symbol \"" << symbol << "\" never appears in the word." << std::endl;
         }
         else
-            ++pos;
-
-        /* Ignore space and tab symbols between "V" and "=". */
-        for (; pos<line.size(); ++pos) {
-            if (line.at(pos) == ' ' || line.at(pos) == '\t')
-                continue;
-            else
-                break;
-        }
+            mOutput << "it is shadowed by instruction " << finding.shadowedBy + 1 << "." << std::endl;
+    }
 
-        /* Check if end of the line is not reached. */
-        if (pos >= line.size()) {
-            std::cout << "[" << file.currentLineNumber() << "; " << pos << "] "
-                      << "Syntax error: unexpected end of line. \"=\" is expected."
-                      << std::endl;
-            fileContainsErrors = true;
-            break;
-        }
+    mOutput << "Removed instructions: " << findings.size() << " of " << mAlgorithm.rules().instructionsCount()
+            << "." << std::endl;
+}
 
 
+void Interpreter::printAllInstructions(std::ostream &stream) const {
 
-        /* Check for "=". */
-        if (line.at(pos) != '=') {
-            std::cout << "[" << file.currentLineNumber() << "; " << pos << "] "
-                      << "Syntax error: invalid symbol detected. \"=\" is expected."
-                      << std::endl;
-            fileContainsErrors = true;
-            break;
-        }
-        else
-            ++pos;
-
-        /* Ignore space and tab symbols between "=" and first symbol of source word. */
-        for (; pos<line.size(); ++pos) {
-            if (line.at(pos) == ' ' || line.at(pos) == '\t')
-                continue;
-            else
-                break;
-        }
-
-        /* Check if end of the line is not reached. */
-        if (pos >= line.size()) {
-            std::cout << "[" << file.currentLineNumber() << "; " << pos << "] "
-                      << "Syntax error: unexpected end of line, that defines source word. "
-                      << std::endl;
-            fileContainsErrors = true;
-            break;
-        }
+    /* Prints all loaded instructions to @stream. */
 
+    const RuleSet &rules = mAlgorithm.rules();
+    const Alphabet &alphabet = mAlgorithm.alphabet();
 
-        /* Read symbol per symbol.
-         * If detected symbol is in the loaded alphabet - add it to the source word,
-         * otherwise - show warning. */
-        for (; pos<line.size(); ++pos) {
+#ifndef NDEBUG
+    assert(rules.instructionsCount() > 0);
+#endif
 
-            /* Ignore commented end of line */
-            if (line.at(pos) == '/' && line.size() >= pos+1 && line.at(pos+1) == '/')
-                break;
+#define NUMBER_COLUMN_WIDTH      4
+#define REPLACEBLE_COLUMN_WIDTH  17
+#define REPLACER_COLUMN_WIDTH    17
+#define FINAL_COLUMN_WIDTH       5
 
-            /* Ignore tab symbol. */
-            if (line.at(pos) == '\t')
-                continue;
+    /* Caption */
+    stream << std::setw(NUMBER_COLUMN_WIDTH)     << std::left << "N "
+           << std::setw(REPLACEBLE_COLUMN_WIDTH) << std::left << "Replaceble "
+           << std::setw(FINAL_COLUMN_WIDTH)      << std::left << "Type "
+           << std::setw(REPLACER_COLUMN_WIDTH)   << std::left << "Replacer "
+           << std::endl;
 
-            if (! mAlphabet.isSymbolPresent(line.at(pos))) {
-                std::cout << "[" << file.currentLineNumber() << "; " << pos << "] "
-                          << "WARNING: detected symbol \"" << line.at(pos) << "\" is absent in the loaded alphabet. "
-                          << std::endl;
-            }
+    /* Table */
+    for (std::size_t i=0; i < rules.instructionsCount(); ++i) {
+        stream << std::setw(NUMBER_COLUMN_WIDTH) << std::left << i+1;
+        alphabet.printColumn(stream, rules.replaceble(i), rules.replacebleLength(i), REPLACEBLE_COLUMN_WIDTH);
 
-            mSourceWord.push_back(line.at(pos));
-        }
+        if (rules.isFinal(i))
+            stream << std::setw(FINAL_COLUMN_WIDTH) << std::left << " ->.";
+        else
+            stream << std::setw(FINAL_COLUMN_WIDTH) << std::left << " -> ";
 
-        break;
+        alphabet.printColumn(stream, rules.replacer(i), rules.replacerLength(i), REPLACER_COLUMN_WIDTH);
+        stream << std::endl;
     }
+}
 
 
-    /* If errors occurred while file parsing - return negative result. */
-    if (fileContainsErrors) {
-        std::cout << "Source word was not loaded since errors occured. "
-                  << std::endl;
-        return false;
-    }
+int Interpreter::executeInstructions() {
+
+    /* Executs all loaded instructions and display steps, selected by trace level, in mOutput.
+     * Output is written by separate thread, so execution does not wait for it.
+     * Returns exit code of the process. */
+
+    const Execution &execution = mContext.execution();
+    MarkovResult result;
+
+    Checkpoint checkpoint(mCheckpointFileName, mCheckpointSteps, mCheckpointTime);
+    mContext.setCheckpoint(mCheckpointFileName.empty() ? 0 : &checkpoint);
 
-    /* Check if source word contains symbols.
-     * If not - show warning. */
-    if (mSourceWord.size() == 0) {
-        std::cout << "Warning: source word is empty. "
-                  << std::endl;
+    DeltaTraceWriter deltaTrace(mDeltaTraceFileName, mAlgorithm.rules(), mAlgorithm.alphabet());
+    mDeltaTrace = mDeltaTraceFileName.empty() ? 0 : &deltaTrace;
+
+    if (mTraceLevel == NoTrace) {
+        mWatchdog.start(mTimeLimit, mMemoryLimit);
+        const bool isExecuted = execute(result, mDeltaTrace ? this : 0);
+        mWatchdog.stop();
+        if (! isExecuted)
+            return ErrorExit;
+
+        printStop(result.stopReason);
+        if (exitCode(result.stopReason) > CycleExit)
+            printStatistics();
+        return exitCode(result.stopReason);
     }
 
-    return true;
+#define NUMBER_COLUMN_WIDTH        4
+#define INSTR_NUMBER_COLUMN_WIDTH  8
+
+    mOutput << std::endl << "Executing process: "   << std::endl;
+    printStepsCaption();
+
+    /* Executing instructions and print results.
+     * Every step executes the lowest-numbered instruction at its leftmost occurrence,
+     * so after each step the search starts from the first instruction again. */
+    mIsLastPrinted = false;
+    mWatchdog.start(mTimeLimit, mMemoryLimit);
+    const bool isExecuted = execute(result, this);
+    mWatchdog.stop();
+    if (! isExecuted)
+        return ErrorExit;
+
+    /* No one instruction can be executed, final instruction was executed, or execution was stopped.
+     * The result is always shown. */
+    if (! mIsLastPrinted && (execution.stepsCount() > 0 || mTraceLevel == FinalTrace))
+        printStep();
+
+    printStop(result.stopReason);
+    if (exitCode(result.stopReason) > CycleExit)
+        printStatistics();
+    return exitCode(result.stopReason);
 }
 
 
-bool Interpreter::loadInstructions(FileLinesInputStream &file) {
+bool Interpreter::execute(MarkovResult &result, MarkovTrace *trace) {
 
-    /* Reads file line-by-line.
-     * Checks every non-empty and not-commented line for instruction definition. */
+    /* Executes the source word, or resumes its execution from the checkpoint.
+     * Returns false if the checkpoint can't be read. Failed saving of the checkpoint
+     * does not stop execution, it is reported after it. */
 
+    const Checkpoint *checkpoint = mContext.checkpoint();
+    const uint64_t allocationsCount = AllocationCounter::count();
 
-#ifndef NDEBUG
-    assert(file.isOk());
-#endif
+    if (mIsResuming) {
+        if (! mContext.resume(result, trace)) {
+            mContext.setCheckpoint(0);
+            mOutput << "ERROR: " << checkpoint->error() << " Process stopped." << std::endl;
+            return false;
+        }
+    }
+    else
+        mContext.runSourceWord(result, trace);
 
-    bool fileContainsErrors = false;
-    std::string line;
+    mAllocationsCount = AllocationCounter::count() - allocationsCount;
+    mContext.setCheckpoint(0);
+    if (checkpoint && ! checkpoint->error().empty())
+        mOutput << "WARNING: Checkpoint is not saved. " << checkpoint->error() << std::endl;
+    if (mDeltaTrace && ! mDeltaTrace->error().empty())
+        mOutput << "WARNING: Trace is not written. " << mDeltaTrace->error() << std::endl;
+    mDeltaTrace = 0;
 
-    Instruction instruction;
+    return true;
+}
 
-    while (file.nextLine(line)) {
-        if (line.empty())
-            continue;
 
-        /* Ignore commented string. */
-        if (line.size() >= 2 && line.at(0) == '/' && line.at(1) == '/')
-            continue;
+void Interpreter::start(const MarkovContext &context) {
+    if (mDeltaTrace)
+        mDeltaTrace->start(context);
+}
 
-        std::size_t pos = 0;
 
-        /* Ignore space and tab symbols from beginning of line. */
-        for (; pos<line.size(); ++pos) {
-            if (line.at(pos) == ' ' || line.at(pos) == '\t')
-                continue;
-            else
-                break;
-        }
+void Interpreter::step(const MarkovContext &context) {
 
-        /* Check if end of the line is not reached.
-         * If so - ignore this line (it contains only uninformative symbols). */
-        if (pos >= line.size())
-            continue;
-
-
-        /* Infromative symbol detected.
-         * Load symbols to the instruction replaceble part. */
-        std::string replaceble;
-        for (; pos<line.size(); ++pos) {
-
-            /* Stop loading replaceble part of instruction and mark it as final on "->.". */
-            if (line.at(pos) == '-' && line.size() >= pos+2 && line.at(pos+1) == '>' && line.at(pos+2) == '.') {
-                pos += 3;
-                instruction.setFinal();
-                break;
-            }
-
-            /* Stop loading replaceble part of instruction on "->". */
-            if (line.at(pos) == '-' && line.size() >= pos+1 && line.at(pos+1) == '>') {
-                pos += 2;
-                break;
-            }
-
-            /* Ignore tab symbol. */
-            if (line.at(pos) == '\t')
-                continue;
-
-            /* If current symbol not exists in loaded alphabet - show warning */
-            if (! mAlphabet.isSymbolPresent(line.at(pos))) {
-                std::cout << "[" << file.currentLineNumber() << "; " << pos << "] "
-                          << "WARNING: detected symbol \""
-                          << line.at(pos) << "\" is absent in the loaded alphabet. "
-                          << std::endl;
-            }
-
-            replaceble.push_back(line.at(pos));
-        }
-        instruction.setReplaceble(replaceble);
-
-        /* Check if end of the line is not reached. */
-        if (pos >= line.size()) {
-            std::cout << "[" << file.currentLineNumber() << "; " << pos << "] "
-                      << "Syntax error: unexpected end of line, that defines instruction. "
-                      << std::endl;
-            fileContainsErrors = true;
-            break;
-        }
+    /* Prints executed step, if it is selected by trace level, and writes it to the delta trace. */
 
-        /* Load symbols to the instruction replacer part. */
-        std::string replacer;
-        for (; pos<line.size(); ++pos) {
+    if (mDeltaTrace)
+        mDeltaTrace->step(context);
 
-            /* Stop loading on ";" */
-            if (line.at(pos) == ';')
-                break;
+    mIsLastPrinted = isTracedStep(context.execution().stepsCount());
+    if (mIsLastPrinted)
+        printStep();
+}
 
-            /* Stop loading on "//" */
-            if (line.at(pos) == '/' && line.size() >= pos+1 && line.at(pos+1) == '/')
-                break;
 
-            /* Ignore tab symbol. */
-            if (line.at(pos) == '\t')
-                continue;
+void Interpreter::finish(const MarkovContext &context) {
+    if (mDeltaTrace)
+        mDeltaTrace->finish(context);
+}
 
-            replacer.push_back(line.at(pos));
-        }
-        instruction.setReplacer(replacer);
-
-        /* If instruction is not correct - display the error message. */
-        if (! instruction.isOk()) {
-            fileContainsErrors = true;
-            std::cout << "ERROR: Instruction at line " << file.currentLineNumber() << " is invalid. "
-                      << std::endl;
-            continue;
-        }
 
-        mInstructions.push_back(instruction);
-    }
+bool Interpreter::isTracedStep(std::size_t number) const {
 
+    /* Returns true if step @number must be printed with current trace level. */
 
-    /* If errors occurred while file parsing - return negative result. */
-    if (fileContainsErrors) {
-        std::cout << "Errors occured while instructions loading. "
-                  << std::endl;
+    switch (mTraceLevel) {
+    case StepsTrace:
+        return true;
+    case EveryNthStepTrace:
+        return number % mTracePeriod == 0;
+    case ExponentialStepsTrace:
+        return (number & (number - 1)) == 0;
+    default:
         return false;
     }
+}
 
-    /* If no one instruction was loaded - show message and return negative result. */
-    if (mInstructions.size() == 0) {
-        std::cout << "No one instruction was loaded. Nothing to execute."
-                  << std::endl;
-        return false;
-    }
 
-    return true;
+void Interpreter::printStepsCaption() {
+
+    /* Prints the caption of the table of steps. */
+
+    mOutput << std::setw(NUMBER_COLUMN_WIDTH)       << std::left << "N "
+            << std::setw(INSTR_NUMBER_COLUMN_WIDTH) << std::left << "Instr. "
+            << std::left << "Source word "
+            << std::endl;
 }
 
 
-void Interpreter::printAllInstructions() const {
+void Interpreter::printStep() {
 
-    /* Prints all loaded instructions to standard output. */
+    /* Prints the last executed step: its number, index of the instruction and the word.
+     * If no one step was executed - prints the source word with number 0. */
 
+    const Execution &execution = mContext.execution();
 
-#ifndef NDEBUG
-    assert(mInstructions.size() > 0);
-#endif
+    mOutput << std::setw(NUMBER_COLUMN_WIDTH) << execution.stepsCount();
+    if (execution.stepsCount() > 0)
+        mOutput << std::setw(INSTR_NUMBER_COLUMN_WIDTH) << execution.lastInstruction();
+    else
+        mOutput << std::setw(INSTR_NUMBER_COLUMN_WIDTH) << "-";
 
-#define NUMBER_COLUMN_WIDTH      4
-#define REPLACEBLE_COLUMN_WIDTH  17
-#define REPLACER_COLUMN_WIDTH    17
-#define FINAL_COLUMN_WIDTH       5
+    /* Units of non-ASCII symbols are written as their UTF-8 text. */
+    if (mAlgorithm.alphabet().hasWideSymbols()) {
+        mWordText.clear();
+        mContext.appendWord(mWordText);
+        mOutput << mWordText;
+    }
+    else
+        mOutput << execution.word();
 
-    /* Caption */
-    std::cout << std::setw(NUMBER_COLUMN_WIDTH)     << std::left << "N "
-              << std::setw(REPLACEBLE_COLUMN_WIDTH) << std::left << "Replaceble "
-              << std::setw(FINAL_COLUMN_WIDTH)      << std::left << "Type "
-              << std::setw(REPLACER_COLUMN_WIDTH)   << std::left << "Replacer "
-              << std::endl;
+    mOutput << std::endl;
+}
 
-    /* Table */
-    for (std::size_t i=0; i < mInstructions.size(); ++i) {
-        Instruction instr = mInstructions.at(i);
 
-        std::cout << std::setw(NUMBER_COLUMN_WIDTH)     << std::left << i+1
-                  << std::setw(REPLACEBLE_COLUMN_WIDTH) << std::left << instr.replaceble();
+void Interpreter::printReplayedStep(const DeltaTraceReader &reader) {
 
-        if (instr.isFinal())
-            std::cout << std::setw(FINAL_COLUMN_WIDTH) << std::left << " ->.";
-        else
-            std::cout << std::setw(FINAL_COLUMN_WIDTH) << std::left << " -> ";
+    /* Prints the step of the trace as printStep() does. */
 
-        std::cout << std::setw(REPLACER_COLUMN_WIDTH) << std::left << instr.replacer()
-                  << std::endl;
+    mOutput << std::setw(NUMBER_COLUMN_WIDTH) << reader.stepsCount();
+    if (reader.stepsCount() > 0)
+        mOutput << std::setw(INSTR_NUMBER_COLUMN_WIDTH) << reader.lastInstruction();
+    else
+        mOutput << std::setw(INSTR_NUMBER_COLUMN_WIDTH) << "-";
 
+    if (reader.alphabet().hasWideSymbols()) {
+        mWordText.clear();
+        mUnits.clear();
+        reader.word().appendTo(mUnits);
+        reader.alphabet().decode(mUnits.data(), mUnits.size(), mWordText);
+        mOutput << mWordText;
     }
+    else
+        mOutput << reader.word();
+
+    mOutput << std::endl;
 }
 
 
-bool Interpreter::executeInstructions() {
+void Interpreter::printStop(Execution::StopReason reason) {
 
-    /* Executs all loaded instructions and display every step in std::cout */
+    /* Reports why execution was stopped, if it was not finished by itself. */
 
+    const Execution &execution = mContext.execution();
 
-#define NUMBER_COLUMN_WIDTH        4
-#define INSTR_NUMBER_COLUMN_WIDTH  8
+    switch (reason) {
+    case Execution::CycleDetected: {
+        mOutput << "Execution stopped: the word after step " << execution.stepsCount()
+                << " is equal to the word after step " << execution.cycleStep()
+                << " (cycle of " << execution.cycleLength() << " steps). "
+                << "Instructions of the cycle:";
 
-    /* Caption */
-    std::cout << std::endl << "Executing process: "   << std::endl;
-    std::cout << std::setw(NUMBER_COLUMN_WIDTH)       << std::left << "N "
-              << std::setw(INSTR_NUMBER_COLUMN_WIDTH) << std::left << "Instr. "
-              << std::left << "Source word "
-              << std::endl;
-
-    /* Executing instructions and print results. */
-    for (std::size_t i=0, number=0; i<mInstructions.size(); ++i) {
-        Instruction instr = mInstructions.at(i);
-
-        if (! executeInstruction(instr)) {
-            if (i+1 == mInstructions.size()) {
-                /* The last instruction in a list does not execute. Exit. */
-                return true;
-            }
-        } else {
-            ++number;
-            std::cout << std::setw(NUMBER_COLUMN_WIDTH) << number
-                      << std::setw(INSTR_NUMBER_COLUMN_WIDTH) << i
-                      << mSourceWord
-                      << std::endl;
-
-            if (instr.isFinal())
-                return true;
-            else {
-
-                /* Start from first instruction. */
-                i= -1;
-                continue;
-            }
-        }
+        const std::vector<std::size_t> &instructions = execution.cycleInstructions();
+        for (std::size_t i=0; i<instructions.size(); ++i)
+            mOutput << (i ? ", " : " ") << instructions[i];
+
+        mOutput << "." << std::endl;
+        return;
     }
 
-    /* No one instruction was executed. */
-    return false;
+    case Execution::StepsLimitReached:
+        mOutput << "Execution stopped: limit of " << mExecutionOptions.maxSteps << " steps is reached." << std::endl;
+        break;
+    case Execution::WordLengthLimitReached:
+        mOutput << "Execution stopped: the word is longer than " << mExecutionOptions.maxWordLength
+                << " symbols." << std::endl;
+        break;
+    case Execution::MemoryLimitReached:
+        mOutput << "Execution stopped: the process uses more than " << mMemoryLimit
+                << " bytes of memory." << std::endl;
+        break;
+    case Execution::TimeLimitReached:
+        mOutput << "Execution stopped: time limit of " << mTimeLimit << " s is exceeded." << std::endl;
+        break;
+    default:
+        break;
+    }
 }
 
 
-bool Interpreter::executeInstruction(Instruction &instr) {
+void Interpreter::printStatistics() {
 
-    /* Tries to execute instruction @instr.
-     * If @instr is incorrect or it can't be executed - returns false,
-     * otherwise - returns true. */
+    /* Shows, how far the stopped execution went. */
 
+    const Execution &execution = mContext.execution();
 
-#ifndef NDEBUG
-    assert(instr.isOk());
-#endif
+    mOutput << "Executed steps: " << execution.stepsCount()
+            << ", word length: " << execution.word().size()
+            << ", time: " << mWatchdog.elapsedTime() << " s"
+            << ", peak memory: " << mWatchdog.peakMemory() / 1024 << " KB." << std::endl;
+}
 
-    if (instr.isOk()) {
-        /* Find position of first replaceble part in source word. */
-        std::size_t pos = mSourceWord.find(instr.replaceble());
-        if (pos == std::string::npos)
-            return false;
 
-        if (instr.replacer() == "!")
-            mSourceWord = mSourceWord.erase(pos, instr.replaceble().size());
-        else
-            mSourceWord = mSourceWord.replace(pos, instr.replaceble().size(), instr.replacer());
+void Interpreter::printTiming() {
 
-        checkSystemFirstSymbol();
-        checkSystemLastSymbol();
-        return true;
-    }
+    /* Shows time of loading and time of execution, if timing is enabled. */
 
-    return false;
+    if (mIsTiming)
+        mOutput << "Load time: " << mLoadTime << " s"
+                << ", execution time: " << mWatchdog.elapsedTime() << " s." << std::endl;
+    if (mIsTiming && AllocationCounter::isEnabled())
+        mOutput << "Heap allocations during execution: " << mAllocationsCount << "." << std::endl;
 }
 
 
-void Interpreter::checkSystemFirstSymbol() {
+bool Interpreter::printProfile(const std::string &fileName) {
+
+    /* Prints the report of the profiler for execution of file "fileName" and writes it to the JSON file,
+     * if profiling is enabled. Returns false if the file can't be written. */
+
+    if (! mIsProfiling)
+        return true;
+
+    mProfiler.printReport(mOutput, mAlgorithm.rules(), mAlgorithm.alphabet());
+
+    std::ofstream output(mProfileFileName.c_str());
+    if (output)
+        mProfiler.writeJson(output, mAlgorithm.rules(), mAlgorithm.alphabet(), fileName);
 
-    /* Checks if first symbol of source word is "!".
-     * If not - inserts first symbol "!".  */
+    output.close();
+    if (output.fail()) {
+        mOutput << "ERROR: Can't write file \"" << mProfileFileName << "\". Process stopped." << std::endl;
+        return false;
+    }
 
-    if (mSourceWord.at(0) != '!')
-        mSourceWord.insert(0, "!");
+    mOutput << "Profile was written to \"" << mProfileFileName << "\"." << std::endl;
+    return true;
 }
 
 
-void Interpreter::checkSystemLastSymbol() {
+int Interpreter::exitCode(Execution::StopReason reason) {
 
-    /* Checks if last symbol of source word is "@".
-     * If not - inserts last symbol "@".  */
+    /* Returns exit code of the process, that corresponds to the stop @reason. */
 
-    if (mSourceWord.at(mSourceWord.size() - 1) != '@')
-        mSourceWord.push_back('@');
+    switch (reason) {
+    case Execution::CycleDetected:
+        return CycleExit;
+    case Execution::StepsLimitReached:
+        return StepsLimitExit;
+    case Execution::WordLengthLimitReached:
+        return WordLengthLimitExit;
+    case Execution::MemoryLimitReached:
+        return MemoryLimitExit;
+    case Execution::TimeLimitReached:
+        return TimeLimitExit;
+    default:
+        return SuccessExit;
+    }
 }
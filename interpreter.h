@@ -4,82 +4,127 @@
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <memory>
 #include <stdlib.h>
 #include <vector>
-#include <list>
 
 #include <assert.h>
 
+#include "libmna.h"
+#include "tracewriter.h"
+#include "watchdog.h"
+#include "profiler.h"
+#include "threadpool.h"
 
-class FileLinesInputStream {
-public:
-    FileLinesInputStream(std::string &filename);
-
-    bool nextLine(std::string &str);
-    inline std::size_t currentLineNumber() const;
-    inline bool isOk() const;
-
-private:
-    std::ifstream mInputStream;
-    std::size_t   mCurrentLineNumber;
-};
-
-
-typedef char AlphabetSymbol;
-class Alphabet {
-public:
-    bool addSymbol(AlphabetSymbol symbol);
-    bool isSymbolPresent(AlphabetSymbol symbol) const;
-    std::size_t symbolsCount() const;
-
-private:
-    std::list<AlphabetSymbol> mAlphabet;
-};
 
-
-class Instruction
-{
-public:
-    Instruction();
-
-    void setReplaceble(std::string &replaceble);
-    void setReplacer(std::string &replacer);
-    void setFinal(bool isFinal = true);
-
-    std::string& replaceble();
-    std::string& replacer();
-    bool isFinal() const;
-    bool isOk() const;
-
-private:
-    bool mIsFinal;
-    std::string mReplacer, mReplaceble;
-};
+class DeltaTraceReader;
+class DeltaTraceWriter;
 
 
 //-- interpreter
-class Interpreter
+class Interpreter : private MarkovTrace
 {
 public:
-   bool processFile(std::string &fileName);
+   enum TraceLevel {
+       NoTrace,                 /* nothing is printed except errors */
+       FinalTrace,              /* only the last step */
+       StepsTrace,              /* the table of instructions and every step */
+       EveryNthStepTrace,       /* the table and every N-th step (and the last one) */
+       ExponentialStepsTrace    /* the table and steps 1, 2, 4, 8... (and the last one) */
+   };
+
+   /* Exit codes of the process. */
+   enum ExitCode {
+       SuccessExit          = 0,
+       ErrorExit            = 1,
+       CycleExit            = 2,
+       StepsLimitExit       = 3,
+       WordLengthLimitExit  = 4,
+       MemoryLimitExit      = 5,
+       TimeLimitExit        = 6,
+       RegressionExit       = 7
+   };
+
+   Interpreter();
+
+   void setMatchingMode(Execution::MatchingMode mode);
+   void setWordRepresentation(Execution::WordRepresentation representation);
+   void setCycleDetection(bool isEnabled);
+   void setLimits(std::size_t maxSteps, std::size_t maxWordLength, std::size_t maxMemory, double timeLimit);
+   void setTraceLevel(TraceLevel level, std::size_t period = 1);
+   void setThreadsCount(std::size_t threadsCount);
+   void setParallelSearch(std::size_t minWordSize);
+   void setResultCache(const std::string &fileName, std::size_t maxSize);
+   void setDeltaTrace(const std::string &fileName);
+   void setTiming(bool isEnabled);
+   void setAnalysisReport(bool isEnabled);
+   void setProfiling(bool isEnabled, const std::string &reportFileName);
+   void setCheckpoints(const std::string &fileName, std::size_t stepsInterval, double timeInterval, bool isResuming);
+   int processFile(std::string &fileName);
+   int processBatch(std::string &fileName, std::string &inputFileName);
+   int processServer(const std::string &socketPath, std::size_t cacheSize);
+   int processReplay(std::string &fileName, std::size_t firstStep, std::size_t lastStep);
+   int processRegression(const std::string &directory, const std::string &baselineFileName,
+                         double tolerance, bool isUpdatingBaseline);
+   bool emitCpp(std::string &fileName, std::string &outputFileName);
+   bool compileFile(std::string &fileName, std::string &outputFileName);
 
 private:
-   bool loadAlphabet(FileLinesInputStream &file);
-   bool loadSourceWord(FileLinesInputStream &file);
-   bool loadInstructions(FileLinesInputStream &file);
-
-   bool executeInstructions();
-   bool executeInstruction(Instruction &instr);
-   inline void checkSystemFirstSymbol();
-   inline void checkSystemLastSymbol();
-
-   void printAllInstructions() const;
+   bool loadFile(std::string &fileName);
+   void printAnalysis();
+
+   int executeInstructions();
+   bool execute(MarkovResult &result, MarkovTrace *trace);
+   void start(const MarkovContext &context);
+   void step(const MarkovContext &context);
+   void finish(const MarkovContext &context);
+   inline bool isTracedStep(std::size_t number) const;
+   void printStepsCaption();
+   void printStep();
+   void printReplayedStep(const DeltaTraceReader &reader);
+   void printStop(Execution::StopReason reason);
+   void printStatistics();
+   void printTiming();
+   bool printProfile(const std::string &fileName);
+   static int exitCode(Execution::StopReason reason);
+
+   void printAllInstructions(std::ostream &stream) const;
 
 private:
+    TraceWriter mTraceWriter;
+    std::ostream &mOutput;              /* all messages and the trace */
+    TraceLevel mTraceLevel;
+    std::size_t mTracePeriod;
+
     std::string mFileName;
-    std::string mSourceWord;
-    Alphabet mAlphabet;
-    std::vector<Instruction> mInstructions;
+    std::size_t mThreadsCount;          /* 0 - by the number of processors */
+    std::size_t mParallelSearchSize;    /* 0 - serial search */
+    std::unique_ptr<ThreadPool> mSearchPool;
+    std::string mResultCacheFileName;   /* empty - results of the batch are not kept */
+    std::size_t mResultCacheSize;
+    bool mIsTiming;
+    bool mIsReportingAnalysis;
+    bool mIsProfiling;
+    std::string mProfileFileName;       /* JSON report of the profiler */
+    std::string mCheckpointFileName;    /* empty - no checkpoints */
+    std::size_t mCheckpointSteps;
+    double mCheckpointTime;
+    bool mIsResuming;
+    double mLoadTime;                   /* seconds */
+    Execution::Options mExecutionOptions;
+    Watchdog mWatchdog;
+    double mTimeLimit;
+    std::size_t mMemoryLimit;
+    MarkovAlgorithm mAlgorithm;
+    MarkovContext mContext;
+    std::string mDeltaTraceFileName;    /* empty - no binary trace */
+    DeltaTraceWriter *mDeltaTrace;      /* trace of the current execution */
+    InstructionsProfiler mProfiler;
+    uint64_t mAllocationsCount;         /* by the last execution (see AllocationCounter) */
+    bool mIsLastPrinted;                /* the last executed step is printed */
+
+    std::string mWordText;              /* buffer of printStep() */
+    std::string mUnits;                 /* buffer of printReplayedStep() */
 };
 
 
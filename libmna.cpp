@@ -0,0 +1,321 @@
+#include "libmna.h"
+#include "rulesloader.h"
+
+#include <sstream>
+
+#include <assert.h>
+
+
+/* MarkovAlgorithm */
+MarkovAlgorithm::MarkovAlgorithm() :
+    mIsSourceWordOnly(false) {}
+
+
+void MarkovAlgorithm::setSourceWordOnly(bool isSourceWordOnly) {
+
+    /* If @isSourceWordOnly - the next loaded algorithm will be executed for its source word alone,
+     * so instructions, that are unreachable from it, are removed too. */
+
+    mIsSourceWordOnly = isSourceWordOnly;
+}
+
+
+bool MarkovAlgorithm::parse(const char *text, std::size_t size, std::size_t threadsCount) {
+
+    /* Loads algorithm from @size bytes of @text in the format of the file.
+     * Instructions are parsed by @threadsCount threads (0 - by the number of processors).
+     * Returns false if the text contains errors (see messages()). */
+
+    clear();
+
+    std::ostringstream log;
+    RulesLoader loader(mAlphabet, log);
+    const bool isLoaded = loader.parse(text, size, mRules, threadsCount);
+    mMessages = log.str();
+
+    if (isLoaded)
+        pruneInstructions();
+    return isLoaded;
+}
+
+
+bool MarkovAlgorithm::parse(const std::string &text, std::size_t threadsCount) {
+    return parse(text.data(), text.size(), threadsCount);
+}
+
+
+bool MarkovAlgorithm::load(const std::string &fileName, std::size_t threadsCount) {
+
+    /* Loads text file "fileName" or compiled rule set, which is mapped into memory as is
+     * (see RuleSet::save()). Returns false if the file can't be loaded (see messages()). */
+
+    clear();
+
+    std::ostringstream log;
+    bool isLoaded = false;
+
+    if (RuleSet::isCompiledFile(fileName)) {
+        isLoaded = mRules.load(fileName, log);
+        if (isLoaded)
+            mAlphabet.assign(mRules.alphabet(), mRules.alphabetSize());
+    }
+    else {
+        RulesLoader loader(mAlphabet, log);
+        isLoaded = loader.load(fileName, mRules, threadsCount);
+        if (isLoaded)
+            pruneInstructions();
+    }
+
+    mMessages = log.str();
+    return isLoaded;
+}
+
+
+const std::string& MarkovAlgorithm::messages() const {
+
+    /* Returns errors and warnings of the last loading, one per line, as the interpreter prints them. */
+
+    return mMessages;
+}
+
+
+const std::vector<RulesAnalyzer::Finding>& MarkovAlgorithm::removedInstructions() const {
+
+    /* Returns instructions, that were removed from matching after loading of text, with the reasons.
+     * Compiled rule set keeps the result of its analysis, so it has no findings. */
+
+    return mFindings;
+}
+
+
+const Alphabet& MarkovAlgorithm::alphabet() const {
+    return mAlphabet;
+}
+
+
+const RuleSet& MarkovAlgorithm::rules() const {
+    return mRules;
+}
+
+
+std::string MarkovAlgorithm::sourceWord() const {
+
+    /* Returns source word, defined by "V=", as UTF-8 text. */
+
+    std::string text;
+    mAlphabet.decode(mRules.sourceWord(), mRules.sourceWordSize(), text);
+    return text;
+}
+
+
+void MarkovAlgorithm::clear() {
+
+    /* Forgets the previous algorithm. Contexts of it must not be used any more. */
+
+    mAlphabet = Alphabet();
+    mMessages.clear();
+    mFindings.clear();
+}
+
+
+void MarkovAlgorithm::pruneInstructions() {
+
+    /* Removes from matching instructions, that can never be executed (see RulesAnalyzer). */
+
+    RulesAnalyzer analyzer(mRules, mIsSourceWordOnly ? RulesAnalyzer::SourceWordOnly : RulesAnalyzer::AnyWords);
+    analyzer.analyze();
+    mRules.prune(analyzer.removedInstructions());
+    mFindings = analyzer.findings();
+}
+
+
+
+/* MarkovContext */
+MarkovContext::MarkovContext(const MarkovAlgorithm &algorithm, const Execution::Options &options) :
+    mAlgorithm(algorithm), mExecution(algorithm.rules(), options), mCheckpoint(0) {}
+
+
+void MarkovContext::setOptions(const Execution::Options &options) {
+
+    /* Sets matching mode, word representation, cycles detection and limits of the next runs. */
+
+    mExecution.setOptions(options);
+}
+
+
+void MarkovContext::setProfiler(InstructionsProfiler *profiler) {
+
+    /* Sets @profiler, that records the next runs (0 - no profiling). */
+
+    mExecution.setProfiler(profiler);
+}
+
+
+void MarkovContext::setCheckpoint(Checkpoint *checkpoint) {
+
+    /* Sets @checkpoint, that saves the state of the next runs, so they can be resumed (0 - no checkpoints).
+     * Checkpoint of the finished run is removed; run, that was stopped by a limit, saves it at the end. */
+
+    mCheckpoint = checkpoint;
+}
+
+
+bool MarkovContext::run(const char *word, std::size_t size, MarkovResult &result, MarkovTrace *trace) {
+
+    /* Executes the algorithm for @size bytes of UTF-8 text @word and writes the result to @result.
+     * Every step is passed to @trace, if it is given.
+     * Returns false if the word contains non-ASCII symbol, that is absent in the alphabet
+     * (absent ASCII symbols are not checked, instructions just do not match them). */
+
+    const Alphabet &alphabet = mAlgorithm.alphabet();
+
+    /* Without non-ASCII symbols in the alphabet units are the bytes of the text. */
+    if (! alphabet.hasWideSymbols()) {
+        if (! Alphabet::isAscii(word, size))
+            return false;
+        mExecution.start(word, size);
+        execute(result, trace);
+        return true;
+    }
+
+    if (! alphabet.encode(word, size, mWordUnits))
+        return false;
+
+    mExecution.start(mWordUnits.data(), mWordUnits.size());
+    execute(result, trace);
+    return true;
+}
+
+
+bool MarkovContext::run(const std::string &word, MarkovResult &result, MarkovTrace *trace) {
+    return run(word.data(), word.size(), result, trace);
+}
+
+
+void MarkovContext::runSourceWord(MarkovResult &result, MarkovTrace *trace) {
+
+    /* Executes the algorithm for its source word. */
+
+    const RuleSet &rules = mAlgorithm.rules();
+    mExecution.start(rules.sourceWord(), rules.sourceWordSize());
+    execute(result, trace);
+}
+
+
+bool MarkovContext::resume(MarkovResult &result, MarkovTrace *trace) {
+
+    /* Continues the run of the source word from the checkpoint (see setCheckpoint()).
+     * Returns false if there is no checkpoint of this algorithm (see Checkpoint::error()). */
+
+#ifndef NDEBUG
+    assert(mCheckpoint);
+#endif
+
+    Checkpoint::State state;
+    if (! mCheckpoint->load(Checkpoint::fingerprint(mAlgorithm.rules(), mAlgorithm.alphabet()), state))
+        return false;
+
+    mExecution.resume(state.word.data(), state.word.size(), state.stepsCount, state.lastInstruction);
+    execute(result, trace);
+    return true;
+}
+
+
+const Execution& MarkovContext::execution() const {
+
+    /* Returns the state of the last run: steps count, the last instruction, stop reason, cycle. */
+
+    return mExecution;
+}
+
+
+void MarkovContext::appendWord(std::string &text) const {
+
+    /* Appends the current word to @text as UTF-8 text. */
+
+    const Alphabet &alphabet = mAlgorithm.alphabet();
+    if (! alphabet.hasWideSymbols()) {
+        mExecution.word().appendTo(text);
+        return;
+    }
+
+    mUnits.clear();
+    mExecution.word().appendTo(mUnits);
+    alphabet.decode(mUnits.data(), mUnits.size(), text);
+}
+
+
+const Checkpoint* MarkovContext::checkpoint() const {
+    return mCheckpoint;
+}
+
+
+std::string MarkovContext::word() const {
+    std::string text;
+    appendWord(text);
+    return text;
+}
+
+
+void MarkovContext::execute(MarkovResult &result, MarkovTrace *trace) {
+
+    /* Executes all steps of the started execution. */
+
+    if (trace)
+        trace->start(*this);
+
+    if (mCheckpoint)
+        executeByCheckpoints(trace);
+    else if (trace) {
+        while (mExecution.step())
+            trace->step(*this);
+    }
+    else
+        mExecution.run();
+
+    if (trace)
+        trace->finish(*this);
+
+    result.word.clear();
+    appendWord(result.word);
+    result.stepsCount = mExecution.stepsCount();
+    result.stopReason = mExecution.stopReason();
+}
+
+
+void MarkovContext::executeByCheckpoints(MarkovTrace *trace) {
+
+    /* Executes steps by slices, saving the checkpoint between them, when it is due. */
+
+    const uint64_t fingerprint = Checkpoint::fingerprint(mAlgorithm.rules(), mAlgorithm.alphabet());
+    mCheckpoint->begin(mExecution.stepsCount());
+
+    for (bool isRunning = true; isRunning; ) {
+        const std::size_t steps = mCheckpoint->stepsBeforeCheck(mExecution.stepsCount());
+        if (trace) {
+            for (std::size_t i=0; i<steps && isRunning; ++i) {
+                isRunning = mExecution.step();
+                if (isRunning)
+                    trace->step(*this);
+            }
+            isRunning = isRunning && mExecution.stopReason() == Execution::NotStopped;
+        }
+        else
+            isRunning = mExecution.run(steps);
+
+        if (isRunning && mCheckpoint->isDue(mExecution.stepsCount()))
+            mCheckpoint->save(mExecution, fingerprint);
+    }
+
+    /* Run, stopped by a limit, can be resumed with other limits. */
+    switch (mExecution.stopReason()) {
+    case Execution::NoInstructionFound:
+    case Execution::FinalInstructionExecuted:
+    case Execution::CycleDetected:
+        mCheckpoint->remove();
+        break;
+    default:
+        mCheckpoint->save(mExecution, fingerprint);
+        break;
+    }
+}
@@ -0,0 +1,124 @@
+#ifndef LIBMNA_H
+#define LIBMNA_H
+
+#include <string>
+#include <vector>
+
+#include "alphabet.h"
+#include "ruleset.h"
+#include "rulesanalyzer.h"
+#include "execution.h"
+#include "checkpoint.h"
+
+
+class MarkovContext;
+
+
+/* Embeddable interface of the interpreter: algorithms are built from text in memory (or from files)
+ * and executed on words, given as UTF-8 text, without any console input or output.
+ * MarkovAlgorithm is read-only after loading and may be shared by any number of contexts
+ * in different threads; every thread executes words by its own MarkovContext. */
+
+
+/* Loaded algorithm: alphabet, source word and instructions.
+ * Instructions, that can never be executed, are removed from matching after loading of text
+ * (see RulesAnalyzer). Unreachable ones are removed only if the algorithm is loaded to be executed
+ * for its source word alone. Errors and warnings of loading are kept as text. */
+class MarkovAlgorithm {
+public:
+    MarkovAlgorithm();
+
+    void setSourceWordOnly(bool isSourceWordOnly);
+
+    bool parse(const char *text, std::size_t size, std::size_t threadsCount = 1);
+    bool parse(const std::string &text, std::size_t threadsCount = 1);
+    bool load(const std::string &fileName, std::size_t threadsCount = 0);
+
+    const std::string& messages() const;
+    const std::vector<RulesAnalyzer::Finding>& removedInstructions() const;
+
+    const Alphabet& alphabet() const;
+    const RuleSet& rules() const;
+    std::string sourceWord() const;
+
+private:
+    MarkovAlgorithm(const MarkovAlgorithm &);
+    MarkovAlgorithm& operator=(const MarkovAlgorithm &);
+
+    void clear();
+    void pruneInstructions();
+
+private:
+    Alphabet mAlphabet;
+    RuleSet mRules;
+    std::string mMessages;
+    bool mIsSourceWordOnly;
+    std::vector<RulesAnalyzer::Finding> mFindings;
+};
+
+
+/* Receives the steps of execution (see MarkovContext::run()). */
+class MarkovTrace {
+public:
+    virtual ~MarkovTrace() {}
+
+    /* Called before the first step of the run (the source word or the resumed one). */
+    virtual void start(const MarkovContext &) {}
+
+    /* Called after every executed step. The word is decoded only if it is requested from @context. */
+    virtual void step(const MarkovContext &context) = 0;
+
+    /* Called after the last step, when the stop reason is known. */
+    virtual void finish(const MarkovContext &) {}
+};
+
+
+/* Result of execution of one word. */
+struct MarkovResult {
+    MarkovResult() :
+        stepsCount(0), stopReason(Execution::NotStopped) {}
+
+    std::string word;                   /* UTF-8 text, with system symbols */
+    std::size_t stepsCount;
+    Execution::StopReason stopReason;
+};
+
+
+/* Execution context of one thread: the word and matching state.
+ * Buffers are reused by the next runs, so repeated runs do not allocate in the steady state. */
+class MarkovContext {
+public:
+    MarkovContext(const MarkovAlgorithm &algorithm, const Execution::Options &options = Execution::Options());
+
+    void setOptions(const Execution::Options &options);
+    void setProfiler(InstructionsProfiler *profiler);
+    void setCheckpoint(Checkpoint *checkpoint);
+
+    bool run(const char *word, std::size_t size, MarkovResult &result, MarkovTrace *trace = 0);
+    bool run(const std::string &word, MarkovResult &result, MarkovTrace *trace = 0);
+    void runSourceWord(MarkovResult &result, MarkovTrace *trace = 0);
+    bool resume(MarkovResult &result, MarkovTrace *trace = 0);
+
+    const Execution& execution() const;
+    const Checkpoint* checkpoint() const;
+    void appendWord(std::string &text) const;
+    std::string word() const;
+
+private:
+    MarkovContext(const MarkovContext &);
+    MarkovContext& operator=(const MarkovContext &);
+
+    void execute(MarkovResult &result, MarkovTrace *trace);
+    void executeByCheckpoints(MarkovTrace *trace);
+
+private:
+    const MarkovAlgorithm &mAlgorithm;
+    Execution mExecution;
+    Checkpoint *mCheckpoint;            /* 0 - no checkpoints */
+
+    std::string mWordUnits;             /* buffer of encoding */
+    mutable std::string mUnits;         /* buffer of decoding */
+};
+
+
+#endif // LIBMNA_H
@@ -0,0 +1,48 @@
+TEMPLATE = lib
+CONFIG += staticlib
+CONFIG -= qt
+CONFIG += c++11 thread
+
+TARGET = mna
+
+SOURCES += libmna.cpp \
+    alphabet.cpp \
+    matcher.cpp \
+    matchindex.cpp \
+    word.cpp \
+    ruleset.cpp \
+    mappedfile.cpp \
+    patternsearch.cpp \
+    execution.cpp \
+    threadpool.cpp \
+    cycledetector.cpp \
+    watchdog.cpp \
+    rulesloader.cpp \
+    rulesanalyzer.cpp \
+    profiler.cpp \
+    checkpoint.cpp \
+    deltatrace.cpp
+
+HEADERS += \
+    libmna.h \
+    alphabet.h \
+    matcher.h \
+    matchindex.h \
+    word.h \
+    ruleset.h \
+    mappedfile.h \
+    patternsearch.h \
+    execution.h \
+    threadpool.h \
+    cycledetector.h \
+    rollinghash.h \
+    fnvhash.h \
+    watchdog.h \
+    rulesloader.h \
+    rulesanalyzer.h \
+    profiler.h \
+    checkpoint.h \
+    deltatrace.h
+
+DEFINES += LINUX
+DEFINES += NDEBUG
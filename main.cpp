@@ -1,18 +1,78 @@
 #include "interpreter.h"
 #include <iostream>
 #include <cstring>
+#include <cstdlib>
+#include <cctype>
 
 
 struct Settings {
     Settings():
-        lambdaAtBegin(false), comatAtEnd(false) {}
+        lambdaAtBegin(false), comatAtEnd(false), emitCpp(false),
+        matchingMode(Execution::AutoMatching), wordRepresentation(Execution::GapBufferWord), threadsCount(0),
+        parallelSearchSize(0), resultCacheSize(256 << 20), traceLevel(Interpreter::StepsTrace), tracePeriod(1), detectCycles(false), timing(false), analyze(false),
+        profile(false), server(false), cacheSize(64), replay(false), replayFirstStep(std::string::npos), replayLastStep(0),
+        regress(false), updateBaseline(false), baselineTolerance(25),
+        checkpoint(false), checkpointSteps(0), checkpointTime(0), resume(false),
+        maxSteps(0), maxWordLength(0), maxMemory(0), timeLimit(0) {}
 
     std::string filename;
+    std::string emitCppFilename;
+    std::string compiledFilename;
+    std::string batchFilename;
+    std::string profileFilename;
     bool lambdaAtBegin;
     bool comatAtEnd;
+    bool emitCpp;
+    Execution::MatchingMode matchingMode;
+    Execution::WordRepresentation wordRepresentation;
+    std::size_t threadsCount;
+    std::size_t parallelSearchSize;
+    std::string resultCacheFilename;
+    std::size_t resultCacheSize;
+    Interpreter::TraceLevel traceLevel;
+    std::size_t tracePeriod;
+    bool detectCycles;
+    bool timing;
+    bool analyze;
+    bool profile;
+    bool server;
+    std::string serverSocket;
+    std::size_t cacheSize;
+    std::string traceFilename;
+    bool replay;
+    std::size_t replayFirstStep;
+    std::size_t replayLastStep;
+    bool regress;
+    std::string baselineFilename;
+    bool updateBaseline;
+    double baselineTolerance;           /* percents */
+    bool checkpoint;
+    std::string checkpointFilename;
+    std::size_t checkpointSteps;
+    double checkpointTime;
+    bool resume;
+    std::size_t maxSteps;
+    std::size_t maxWordLength;
+    std::size_t maxMemory;
+    double timeLimit;
 };
 
 
+std::size_t parseSize(const char *str) {
+
+    /* Parses number of bytes with optional suffix K, M or G. */
+
+    char *end = 0;
+    std::size_t size = std::strtoul(str, &end, 10);
+    const char *suffixes = "KMG";
+    const char *suffix = *end ? std::strchr(suffixes, std::toupper((unsigned char)*end)) : 0;
+    if (suffix)
+        for (const char *s=suffixes; s<=suffix; ++s)
+            size *= 1024;
+    return size;
+}
+
+
 bool processArguments(int argc, char* argv[], Settings &arguments) {
     if (argc <= 1) {
         std::cout << "No input file specified. Process stopped." << std::endl;
@@ -27,7 +87,127 @@ bool processArguments(int argc, char* argv[], Settings &arguments) {
 
 #ifdef LINUX
         // todo: keys parsing here
-        if (argv[i] == "-l") {}
+        if (std::strcmp(argv[i], "-l") == 0) {}
+
+        else if (std::strcmp(argv[i], "--matching=sequential") == 0)
+            arguments.matchingMode = Execution::SequentialMatching;
+        else if (std::strcmp(argv[i], "--matching=automaton") == 0)
+            arguments.matchingMode = Execution::AutomatonMatching;
+        else if (std::strcmp(argv[i], "--matching=incremental") == 0)
+            arguments.matchingMode = Execution::IncrementalMatching;
+        else if (std::strcmp(argv[i], "--matching=auto") == 0)
+            arguments.matchingMode = Execution::AutoMatching;
+
+        else if (std::strcmp(argv[i], "--word=gap") == 0)
+            arguments.wordRepresentation = Execution::GapBufferWord;
+        else if (std::strcmp(argv[i], "--word=rle") == 0)
+            arguments.wordRepresentation = Execution::RunLengthWord;
+
+        else if (std::strcmp(argv[i], "--emit-cpp") == 0)
+            arguments.emitCpp = true;
+        else if (std::strncmp(argv[i], "--emit-cpp=", 11) == 0) {
+            arguments.emitCpp = true;
+            arguments.emitCppFilename = argv[i] + 11;
+        }
+
+        else if (std::strncmp(argv[i], "--compile=", 10) == 0)
+            arguments.compiledFilename = argv[i] + 10;
+
+        else if (std::strcmp(argv[i], "--detect-cycles") == 0)
+            arguments.detectCycles = true;
+
+        else if (std::strcmp(argv[i], "--timing") == 0)
+            arguments.timing = true;
+        else if (std::strcmp(argv[i], "--analyze") == 0)
+            arguments.analyze = true;
+        else if (std::strcmp(argv[i], "--profile") == 0)
+            arguments.profile = true;
+        else if (std::strncmp(argv[i], "--profile=", 10) == 0) {
+            arguments.profile = true;
+            arguments.profileFilename = argv[i] + 10;
+        }
+
+        else if (std::strcmp(argv[i], "--checkpoint") == 0)
+            arguments.checkpoint = true;
+        else if (std::strncmp(argv[i], "--checkpoint=", 13) == 0) {
+            arguments.checkpoint = true;
+            arguments.checkpointFilename = argv[i] + 13;
+        }
+        else if (std::strncmp(argv[i], "--checkpoint-steps=", 19) == 0) {
+            arguments.checkpoint = true;
+            arguments.checkpointSteps = std::strtoul(argv[i] + 19, 0, 10);
+        }
+        else if (std::strncmp(argv[i], "--checkpoint-time=", 18) == 0) {
+            arguments.checkpoint = true;
+            arguments.checkpointTime = std::strtod(argv[i] + 18, 0);
+        }
+        else if (std::strcmp(argv[i], "--resume") == 0) {
+            arguments.checkpoint = true;
+            arguments.resume = true;
+        }
+
+        else if (std::strcmp(argv[i], "--server") == 0)
+            arguments.server = true;
+        else if (std::strncmp(argv[i], "--server=", 9) == 0) {
+            arguments.server = true;
+            arguments.serverSocket = argv[i] + 9;
+        }
+        else if (std::strncmp(argv[i], "--cache-size=", 13) == 0)
+            arguments.cacheSize = std::strtoul(argv[i] + 13, 0, 10);
+
+        else if (std::strncmp(argv[i], "--batch=", 8) == 0)
+            arguments.batchFilename = argv[i] + 8;
+        else if (std::strncmp(argv[i], "--threads=", 10) == 0)
+            arguments.threadsCount = std::strtoul(argv[i] + 10, 0, 10);
+        else if (std::strncmp(argv[i], "--result-cache=", 15) == 0)
+            arguments.resultCacheFilename = argv[i] + 15;
+        else if (std::strncmp(argv[i], "--result-cache-size=", 20) == 0)
+            arguments.resultCacheSize = parseSize(argv[i] + 20);
+        else if (std::strncmp(argv[i], "--parallel-search=", 18) == 0)
+            arguments.parallelSearchSize = parseSize(argv[i] + 18);
+
+        else if (std::strncmp(argv[i], "--trace-file=", 13) == 0)
+            arguments.traceFilename = argv[i] + 13;
+        else if (std::strcmp(argv[i], "--replay") == 0)
+            arguments.replay = true;
+        else if (std::strncmp(argv[i], "--replay=", 9) == 0) {
+            char *end = 0;
+            arguments.replay = true;
+            arguments.replayFirstStep = arguments.replayLastStep = std::strtoul(argv[i] + 9, &end, 10);
+            if (*end == '-')
+                arguments.replayLastStep = std::strtoul(end + 1, 0, 10);
+        }
+
+        else if (std::strcmp(argv[i], "--regress") == 0)
+            arguments.regress = true;
+        else if (std::strncmp(argv[i], "--baseline=", 11) == 0)
+            arguments.baselineFilename = argv[i] + 11;
+        else if (std::strcmp(argv[i], "--update-baseline") == 0)
+            arguments.updateBaseline = true;
+        else if (std::strncmp(argv[i], "--tolerance=", 12) == 0)
+            arguments.baselineTolerance = std::strtod(argv[i] + 12, 0);
+
+        else if (std::strcmp(argv[i], "--trace=none") == 0)
+            arguments.traceLevel = Interpreter::NoTrace;
+        else if (std::strcmp(argv[i], "--trace=final") == 0)
+            arguments.traceLevel = Interpreter::FinalTrace;
+        else if (std::strcmp(argv[i], "--trace=steps") == 0)
+            arguments.traceLevel = Interpreter::StepsTrace;
+        else if (std::strcmp(argv[i], "--trace=exponential") == 0)
+            arguments.traceLevel = Interpreter::ExponentialStepsTrace;
+        else if (std::strncmp(argv[i], "--trace=every=", 14) == 0 && std::strtoul(argv[i] + 14, 0, 10) > 0) {
+            arguments.traceLevel = Interpreter::EveryNthStepTrace;
+            arguments.tracePeriod = std::strtoul(argv[i] + 14, 0, 10);
+        }
+
+        else if (std::strncmp(argv[i], "--max-steps=", 12) == 0)
+            arguments.maxSteps = std::strtoul(argv[i] + 12, 0, 10);
+        else if (std::strncmp(argv[i], "--max-length=", 13) == 0)
+            arguments.maxWordLength = std::strtoul(argv[i] + 13, 0, 10);
+        else if (std::strncmp(argv[i], "--max-memory=", 13) == 0)
+            arguments.maxMemory = parseSize(argv[i] + 13);
+        else if (std::strncmp(argv[i], "--time-limit=", 13) == 0)
+            arguments.timeLimit = std::strtod(argv[i] + 13, 0);
 #endif
 
         else
@@ -38,17 +218,64 @@ bool processArguments(int argc, char* argv[], Settings &arguments) {
                           << arguments.filename << "\" is used." << std::endl;
         }
 
+    /* Generated program and profile are written next to the source file by default. */
+    if (arguments.emitCpp && arguments.emitCppFilename.empty())
+        arguments.emitCppFilename = arguments.filename + ".cpp";
+    if (arguments.profile && arguments.profileFilename.empty())
+        arguments.profileFilename = arguments.filename + ".profile.json";
+    if (arguments.checkpoint && arguments.checkpointFilename.empty())
+        arguments.checkpointFilename = arguments.filename + ".checkpoint";
+
+    /* Checkpoint is saved every minute, if no interval is given. */
+    if (arguments.checkpoint && arguments.checkpointSteps == 0 && arguments.checkpointTime <= 0)
+        arguments.checkpointTime = 60;
+
     return true;
 }
 
 
 int main(int argc, char* argv[]) {
+    /* Only C++ streams are used; unsynchronized std::cin reads batch input much faster.
+     * std::cout is written by the trace writer thread, so std::cin must not flush it. */
+    std::ios::sync_with_stdio(false);
+    std::cin.tie(0);
+
     Settings settings;
     if (! processArguments(argc, argv, settings))
         return 1;
 
     try {
         Interpreter interpreter;
+        interpreter.setMatchingMode(settings.matchingMode);
+        interpreter.setWordRepresentation(settings.wordRepresentation);
+        interpreter.setTraceLevel(settings.traceLevel, settings.tracePeriod);
+        interpreter.setCycleDetection(settings.detectCycles);
+        interpreter.setThreadsCount(settings.threadsCount);
+        interpreter.setParallelSearch(settings.parallelSearchSize);
+        interpreter.setResultCache(settings.resultCacheFilename, settings.resultCacheSize);
+        interpreter.setDeltaTrace(settings.traceFilename);
+        interpreter.setTiming(settings.timing);
+        interpreter.setAnalysisReport(settings.analyze);
+        interpreter.setProfiling(settings.profile, settings.profileFilename);
+        interpreter.setCheckpoints(settings.checkpoint ? settings.checkpointFilename : std::string(),
+                                   settings.checkpointSteps, settings.checkpointTime, settings.resume);
+        interpreter.setLimits(settings.maxSteps, settings.maxWordLength, settings.maxMemory, settings.timeLimit);
+
+        if (settings.server)
+            return interpreter.processServer(settings.serverSocket, settings.cacheSize);
+        if (settings.regress)
+            return interpreter.processRegression(settings.filename, settings.baselineFilename,
+                                                 settings.baselineTolerance / 100, settings.updateBaseline);
+        if (settings.replay)
+            return interpreter.processReplay(settings.filename, settings.replayFirstStep, settings.replayLastStep);
+        if (settings.emitCpp)
+            return interpreter.emitCpp(settings.filename, settings.emitCppFilename) ? Interpreter::SuccessExit
+                                                                                    : Interpreter::ErrorExit;
+        if (! settings.compiledFilename.empty())
+            return interpreter.compileFile(settings.filename, settings.compiledFilename) ? Interpreter::SuccessExit
+                                                                                         : Interpreter::ErrorExit;
+        if (! settings.batchFilename.empty())
+            return interpreter.processBatch(settings.filename, settings.batchFilename);
         return interpreter.processFile(settings.filename);
 
     } catch (std::bad_alloc &) {
@@ -0,0 +1,100 @@
+#include "mappedfile.h"
+
+#include <fstream>
+#include <iterator>
+
+#ifdef LINUX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+MappedFile::MappedFile() :
+    mData(0), mSize(0), mIsOpen(false) {}
+
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+
+bool MappedFile::open(const std::string &fileName) {
+
+    /* Maps file "fileName" into memory.
+     * Returns false if the file can't be opened or mapped. */
+
+    close();
+
+#ifdef LINUX
+    int descriptor = ::open(fileName.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(descriptor, &info) != 0) {
+        ::close(descriptor);
+        return false;
+    }
+
+    mSize = (std::size_t)info.st_size;
+    if (mSize > 0) {
+        void *address = mmap(0, mSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (address == MAP_FAILED) {
+            ::close(descriptor);
+            mSize = 0;
+            return false;
+        }
+
+        /* The file is read from the beginning to the end. */
+        madvise(address, mSize, MADV_SEQUENTIAL);
+        mData = (const char *)address;
+    }
+
+    /* Mapping stays valid after the descriptor is closed. */
+    ::close(descriptor);
+
+#else
+    std::ifstream stream(fileName.c_str(), std::ios::in | std::ios::binary);
+    if (! stream)
+        return false;
+
+    mBuffer.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    mData = mBuffer.empty() ? 0 : &mBuffer[0];
+    mSize = mBuffer.size();
+#endif
+
+    mIsOpen = true;
+    return true;
+}
+
+
+void MappedFile::close() {
+
+#ifdef LINUX
+    if (mData)
+        munmap((void *)mData, mSize);
+#else
+    mBuffer.clear();
+#endif
+
+    mData = 0;
+    mSize = 0;
+    mIsOpen = false;
+}
+
+
+const char* MappedFile::data() const {
+    return mData;
+}
+
+
+std::size_t MappedFile::size() const {
+    return mSize;
+}
+
+
+bool MappedFile::isOpen() const {
+    return mIsOpen;
+}
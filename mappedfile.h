@@ -0,0 +1,37 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <vector>
+
+
+/* Read-only view of the whole file.
+ * On Linux the file is memory-mapped, on other systems it is read into memory. */
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const std::string &fileName);
+    void close();
+
+    const char* data() const;
+    std::size_t size() const;
+    bool isOpen() const;
+
+private:
+    MappedFile(const MappedFile &);
+    MappedFile& operator=(const MappedFile &);
+
+private:
+    const char *mData;
+    std::size_t mSize;
+    bool mIsOpen;
+
+#ifndef LINUX
+    std::vector<char> mBuffer;
+#endif
+};
+
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,411 @@
+#include "matcher.h"
+#include "ruleset.h"
+#include "threadpool.h"
+#include "word.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+
+#include <assert.h>
+
+
+static const uint32_t NO_STATE = 0xFFFFFFFFu;
+
+/* Parallel search (see findFirst() with the thread pool). */
+static const std::size_t CHUNKS_PER_THREAD = 4;          /* so the threads are busy, while left chunks stop */
+static const std::size_t MIN_CHUNK_SIZE = 1 << 12;
+static const std::size_t SEARCH_BLOCK_SIZE = 1 << 16;    /* symbols between checks of the left bounds */
+
+const uint32_t InstructionsMatcher::NO_OUTPUT;
+
+
+InstructionsMatcher::ParallelSearch::ParallelSearch() :
+    mChunksCapacity(0), mMatcher(0), mWord(0), mSize(0), mChunkSize(0), mOverlap(0) {}
+
+
+InstructionsMatcher::InstructionsMatcher() {
+    mTables.classesCount = 0;
+    mTables.statesCount = 0;
+    mTables.instructionsCount = 0;
+    mTables.symbolClasses = 0;
+    mTables.transitions = 0;
+    mTables.outputs = 0;
+    mTables.lengths = 0;
+}
+
+
+uint32_t InstructionsMatcher::addState() {
+
+    /* Appends new state without transitions and outputs.
+     * Returns index of the new state. */
+
+    mTransitions.resize(mTransitions.size() + mTables.classesCount, NO_STATE);
+    mOutputs.push_back(NO_OUTPUT);
+    return (uint32_t)(mOutputs.size() - 1);
+}
+
+
+void InstructionsMatcher::build(const RuleSet &rules) {
+
+    /* Compiles replaceble parts of all instructions of @rules into one automaton.
+     * Symbols, that are not used by any replaceble part, share one class,
+     * so the transitions table depends only on the rules, not on the alphabet.
+     * Pruned instructions (see RulesAnalyzer) are not compiled, they never occur. */
+
+
+    mSymbolClasses.assign(256, 0);
+    mTransitions.clear();
+    mOutputs.clear();
+    mLengths.clear();
+
+    mTables.classesCount = 1;
+    for (std::size_t i=0; i<rules.instructionsCount(); ++i) {
+        if (rules.isPruned(i))
+            continue;
+
+        const char *replaceble = rules.replaceble(i);
+        for (std::size_t pos=0; pos<rules.replacebleLength(i); ++pos) {
+            unsigned char symbol = (unsigned char)replaceble[pos];
+            if (mSymbolClasses[symbol] == 0)
+                mSymbolClasses[symbol] = (uint16_t)(mTables.classesCount++);
+        }
+    }
+
+
+    /* Trie of all replaceble parts.
+     * If several instructions have the same replaceble part - the first of them wins. */
+    addState();
+    for (std::size_t i=0; i<rules.instructionsCount(); ++i) {
+        mLengths.push_back((uint32_t)rules.replacebleLength(i));
+        if (rules.isPruned(i))
+            continue;
+
+        const char *replaceble = rules.replaceble(i);
+        uint32_t state = 0;
+
+        for (std::size_t pos=0; pos<rules.replacebleLength(i); ++pos) {
+            std::size_t cell = state * mTables.classesCount + mSymbolClasses[(unsigned char)replaceble[pos]];
+            if (mTransitions[cell] == NO_STATE) {
+                uint32_t next = addState();
+                mTransitions[cell] = next;
+            }
+            state = mTransitions[cell];
+        }
+
+        if (i < mOutputs[state])
+            mOutputs[state] = (uint32_t)i;
+    }
+
+
+    /* Failure links (breadth-first), that turns the trie into complete automaton.
+     * Every state inherits the lowest output of its longest proper suffix. */
+    const std::size_t classes = mTables.classesCount;
+    std::vector<uint32_t> failures(mOutputs.size(), 0);
+    std::deque<uint32_t> queue;
+
+    for (std::size_t c=0; c<classes; ++c) {
+        uint32_t &next = mTransitions[c];
+        if (next == NO_STATE)
+            next = 0;
+        else
+            queue.push_back(next);
+    }
+
+    while (! queue.empty()) {
+        uint32_t state = queue.front();
+        queue.pop_front();
+
+        for (std::size_t c=0; c<classes; ++c) {
+            uint32_t fallback = mTransitions[failures[state] * classes + c];
+            uint32_t &next = mTransitions[state * classes + c];
+
+            if (next == NO_STATE) {
+                next = fallback;
+                continue;
+            }
+
+            failures[next] = fallback;
+            if (mOutputs[fallback] < mOutputs[next])
+                mOutputs[next] = mOutputs[fallback];
+            queue.push_back(next);
+        }
+    }
+
+    mTables.statesCount = (uint32_t)mOutputs.size();
+    mTables.instructionsCount = (uint32_t)mLengths.size();
+    mTables.symbolClasses = mSymbolClasses.data();
+    mTables.transitions = mTransitions.data();
+    mTables.outputs = mOutputs.data();
+    mTables.lengths = mLengths.data();
+}
+
+
+bool InstructionsMatcher::attach(const Tables &tables) {
+
+    /* Uses @tables, that are stored outside (in mapped file), without copying.
+     * Checks that every transition and output stays inside of the tables.
+     * Returns false if the tables are inconsistent. */
+
+
+    if (tables.statesCount == 0 || tables.classesCount == 0 || tables.classesCount > 256)
+        return false;
+
+    for (std::size_t symbol=0; symbol<256; ++symbol) {
+        if (tables.symbolClasses[symbol] >= tables.classesCount)
+            return false;
+    }
+
+    const std::size_t cells = (std::size_t)tables.statesCount * tables.classesCount;
+    for (std::size_t cell=0; cell<cells; ++cell) {
+        if (tables.transitions[cell] >= tables.statesCount)
+            return false;
+    }
+
+    for (std::size_t state=0; state<tables.statesCount; ++state) {
+        uint32_t output = tables.outputs[state];
+        if (output != NO_OUTPUT && output >= tables.instructionsCount)
+            return false;
+    }
+
+    mSymbolClasses.clear();
+    mTransitions.clear();
+    mOutputs.clear();
+    mLengths.clear();
+
+    mTables = tables;
+    return true;
+}
+
+
+const InstructionsMatcher::Tables& InstructionsMatcher::tables() const {
+    return mTables;
+}
+
+
+/* Feeds the automaton by chunks of the word.
+ * Only instructions below the bound are taken, so the bound is lowered by every found instruction
+ * and may be lowered from outside (see restrict()). */
+class InstructionsMatcher::Scanner : public WordChunkVisitor {
+public:
+    Scanner(const Tables &tables, std::size_t offset = 0) :
+        mTables(tables), mState(0), mOffset(offset),
+        mBest(NO_OUTPUT), mBestEnd(0), mBound(NO_OUTPUT) {}
+
+    bool visit(const char *chunk, std::size_t size) {
+        const std::size_t classes = mTables.classesCount;
+        const uint16_t *symbolClasses = mTables.symbolClasses;
+        const uint32_t *transitions = mTables.transitions;
+        const uint32_t *outputs = mTables.outputs;
+
+        uint32_t state = mState;
+        for (std::size_t i=0; i<size; ++i) {
+            state = transitions[state * classes + symbolClasses[(unsigned char)chunk[i]]];
+
+            if (outputs[state] < mBound) {
+                mBest = mBound = outputs[state];
+                mBestEnd = mOffset + i;
+
+                /* Nothing can beat the first instruction. */
+                if (mBound == 0)
+                    return false;
+            }
+        }
+
+        mState = state;
+        mOffset += size;
+        return true;
+    }
+
+    bool visitRun(char symbol, std::size_t count) {
+
+        /* Repetitions of one symbol lead the automaton to a state, that does not change any more
+         * (not later than after the longest replaceble part), the rest of the run is skipped. */
+
+        const std::size_t cell = mTables.symbolClasses[(unsigned char)symbol];
+        const uint32_t *transitions = mTables.transitions;
+        const uint32_t *outputs = mTables.outputs;
+
+        uint32_t state = mState;
+        for (std::size_t i=0; i<count; ++i) {
+            const uint32_t next = transitions[state * mTables.classesCount + cell];
+            if (next == state)
+                break;
+
+            state = next;
+            if (outputs[state] < mBound) {
+                mBest = mBound = outputs[state];
+                mBestEnd = mOffset + i;
+
+                if (mBound == 0)
+                    return false;
+            }
+        }
+
+        mState = state;
+        mOffset += count;
+        return true;
+    }
+
+    /* Instructions from @bound are not needed any more (they are found elsewhere). */
+    void restrict(uint32_t bound) { if (bound < mBound) mBound = bound; }
+
+    uint32_t best() const { return mBest; }
+    std::size_t bestEnd() const { return mBestEnd; }
+    uint32_t bound() const { return mBound; }
+
+private:
+    const Tables &mTables;
+    uint32_t     mState;
+    std::size_t  mOffset;
+    uint32_t     mBest;
+    std::size_t  mBestEnd;
+    uint32_t     mBound;
+};
+
+
+bool InstructionsMatcher::findFirst(const Word &word, std::size_t &instructionIndex, std::size_t &pos) const {
+
+    /* Scans @word once and looks for the lowest-numbered instruction, that may be executed.
+     * Occurrences of one instruction are met in the order of their positions,
+     * so the first met occurrence of the best instruction is its leftmost one.
+     *
+     * Returns false if no one instruction occurs in the word. */
+
+
+#ifndef NDEBUG
+    assert(mTables.statesCount > 0);
+#endif
+
+    Scanner scanner(mTables);
+    word.scan(scanner);
+
+    if (scanner.best() == NO_OUTPUT)
+        return false;
+
+    instructionIndex = scanner.best();
+    pos = scanner.bestEnd() + 1 - mTables.lengths[instructionIndex];
+    return true;
+}
+
+
+bool InstructionsMatcher::findFirst(const char *text, std::size_t size,
+                                    std::size_t &instructionIndex, std::size_t &pos) const {
+
+    /* The same as findFirst() for the word, but scans @size symbols of @text. */
+
+
+#ifndef NDEBUG
+    assert(mTables.statesCount > 0);
+#endif
+
+    Scanner scanner(mTables);
+    scanner.visit(text, size);
+
+    if (scanner.best() == NO_OUTPUT)
+        return false;
+
+    instructionIndex = scanner.best();
+    pos = scanner.bestEnd() + 1 - mTables.lengths[instructionIndex];
+    return true;
+}
+
+
+bool InstructionsMatcher::findFirst(const Word &word, ThreadPool &pool, ParallelSearch &search,
+                                    std::size_t &instructionIndex, std::size_t &pos) const {
+
+    /* The same as findFirst() for the word, but the word is split into chunks, that are scanned
+     * by the threads of @pool. Chunk is scanned on by the longest replaceble part - 1 symbols,
+     * so every occurrence, that starts in the chunk, is met by its scanner.
+     *
+     * Result of every chunk is the lowest instruction of the chunk and its leftmost occurrence;
+     * the result of the word is the lowest of them, the leftmost one of equal instructions.
+     * Chunk needs only instructions below the ones, that are found by the chunks to the left of it:
+     * occurrence of the same instruction to the right can't be leftmost. So the scanners publish
+     * their bounds after every block and take the bounds of the left chunks before the next one;
+     * chunk stops when nothing below its bound remains.
+     * State of the chunks is kept in @search, which grows only with the number of threads. */
+
+
+#ifndef NDEBUG
+    assert(mTables.statesCount > 0);
+#endif
+
+    const std::size_t size = word.size();
+    const std::size_t chunksCount = std::max<std::size_t>(1, std::min(pool.threadsCount() * CHUNKS_PER_THREAD,
+                                                                      size / MIN_CHUNK_SIZE));
+
+    std::size_t overlap = 0;
+    for (std::size_t i=0; i<mTables.instructionsCount; ++i)
+        overlap = std::max<std::size_t>(overlap, mTables.lengths[i]);
+
+    if (search.mChunksCapacity < chunksCount) {
+        search.mChunks.reset(new ParallelSearch::Chunk[chunksCount]);
+        search.mChunksCapacity = chunksCount;
+    }
+    search.mMatcher = this;
+    search.mWord = &word;
+    search.mSize = size;
+    search.mChunkSize = (size + chunksCount - 1) / chunksCount;
+    search.mOverlap = overlap ? overlap - 1 : 0;
+
+    for (std::size_t chunk=0; chunk<chunksCount; ++chunk) {
+        ParallelSearch::Chunk &state = search.mChunks[chunk];
+        state.bound.store(NO_OUTPUT, std::memory_order_relaxed);
+        state.best = NO_OUTPUT;
+        state.bestEnd = 0;
+    }
+
+    /* The task captures two words, so std::function keeps it without allocation. */
+    ParallelSearch *state = &search;
+    for (std::size_t chunk=0; chunk<chunksCount; ++chunk) {
+        pool.submit([state, chunk](std::size_t) {
+            state->mMatcher->scanChunk(*state, chunk);
+        });
+    }
+    pool.wait();
+
+    uint32_t best = NO_OUTPUT;
+    std::size_t bestEnd = 0;
+    for (std::size_t chunk=0; chunk<chunksCount; ++chunk) {
+        const ParallelSearch::Chunk &state = search.mChunks[chunk];
+        if (state.best < best || (state.best == best && best != NO_OUTPUT && state.bestEnd < bestEnd)) {
+            best = state.best;
+            bestEnd = state.bestEnd;
+        }
+    }
+
+    if (best == NO_OUTPUT)
+        return false;
+
+    instructionIndex = best;
+    pos = bestEnd + 1 - mTables.lengths[instructionIndex];
+    return true;
+}
+
+
+void InstructionsMatcher::scanChunk(ParallelSearch &search, std::size_t chunk) const {
+
+    /* Scans the chunk of the parallel search (see findFirst()) by blocks,
+     * restricted by the bounds of the chunks to the left of it. */
+
+    ParallelSearch::Chunk *chunks = search.mChunks.get();
+    const std::size_t from = std::min(search.mSize, chunk * search.mChunkSize);
+    const std::size_t to = std::min(search.mSize, from + search.mChunkSize + search.mOverlap);
+
+    Scanner scanner(mTables, from);
+    for (std::size_t block=from; block<to; block+=SEARCH_BLOCK_SIZE) {
+        for (std::size_t left=0; left<chunk; ++left)
+            scanner.restrict(chunks[left].bound.load(std::memory_order_relaxed));
+        if (scanner.bound() == 0)
+            break;
+
+        const bool isScanned = search.mWord->scan(block, std::min(to, block + SEARCH_BLOCK_SIZE), scanner);
+        chunks[chunk].bound.store(scanner.bound(), std::memory_order_relaxed);
+        if (! isScanned)
+            break;
+    }
+
+    chunks[chunk].best = scanner.best();
+    chunks[chunk].bestEnd = scanner.bestEnd();
+}
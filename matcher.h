@@ -0,0 +1,93 @@
+#ifndef MATCHER_H
+#define MATCHER_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+
+class RuleSet;
+class ThreadPool;
+class Word;
+
+
+/* Multi-pattern (Aho-Corasick) automaton over replaceble parts of all instructions.
+ * Finds the lowest-numbered instruction and its leftmost occurrence in one pass over the word.
+ *
+ * Tables are flat arrays, so they can be built in memory or attached to a mapped file as is. */
+class InstructionsMatcher {
+public:
+    static const uint32_t NO_OUTPUT = 0xFFFFFFFFu;
+
+    struct Tables {
+        uint32_t classesCount;
+        uint32_t statesCount;
+        uint32_t instructionsCount;
+        const uint16_t *symbolClasses;     /* 256 entries: byte -> symbol class (0 - absent in patterns) */
+        const uint32_t *transitions;       /* state * classesCount + class -> state */
+        const uint32_t *outputs;           /* state -> lowest instruction index, that ends here */
+        const uint32_t *lengths;           /* instruction index -> replaceble part length */
+    };
+
+    /* Buffers of the parallel search (see findFirst() with the thread pool). They are kept by the caller
+     * between the searches, so the steps of execution do not allocate. */
+    class ParallelSearch {
+    public:
+        ParallelSearch();
+
+    private:
+        ParallelSearch(const ParallelSearch &);
+        ParallelSearch& operator=(const ParallelSearch &);
+
+        friend class InstructionsMatcher;
+
+        struct Chunk {
+            std::atomic<uint32_t> bound;        /* published by the scanner of the chunk */
+            uint32_t best;
+            std::size_t bestEnd;
+        };
+
+        std::unique_ptr<Chunk[]> mChunks;
+        std::size_t mChunksCapacity;
+
+        /* The current search, that is read by the tasks. */
+        const InstructionsMatcher *mMatcher;
+        const Word *mWord;
+        std::size_t mSize;
+        std::size_t mChunkSize;
+        std::size_t mOverlap;
+    };
+
+    InstructionsMatcher();
+
+    void build(const RuleSet &rules);
+    bool attach(const Tables &tables);
+    const Tables& tables() const;
+
+    bool findFirst(const Word &word, std::size_t &instructionIndex, std::size_t &pos) const;
+    bool findFirst(const char *text, std::size_t size, std::size_t &instructionIndex, std::size_t &pos) const;
+    bool findFirst(const Word &word, ThreadPool &pool, ParallelSearch &search,
+                   std::size_t &instructionIndex, std::size_t &pos) const;
+
+private:
+    InstructionsMatcher(const InstructionsMatcher &);
+    InstructionsMatcher& operator=(const InstructionsMatcher &);
+
+    class Scanner;
+    uint32_t addState();
+    void scanChunk(ParallelSearch &search, std::size_t chunk) const;
+
+private:
+    Tables mTables;
+
+    /* Storage of the tables, if they were built in memory. */
+    std::vector<uint16_t> mSymbolClasses;
+    std::vector<uint32_t> mTransitions;
+    std::vector<uint32_t> mOutputs;
+    std::vector<uint32_t> mLengths;
+};
+
+
+#endif // MATCHER_H
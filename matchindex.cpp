@@ -0,0 +1,116 @@
+#include "matchindex.h"
+#include "ruleset.h"
+#include "word.h"
+#include "profiler.h"
+
+#include <assert.h>
+
+
+IncrementalMatchIndex::IncrementalMatchIndex() :
+    mRules(0) {}
+
+
+void IncrementalMatchIndex::build(const RuleSet &rules) {
+
+    /* Remembers instructions of @rules.
+     * Positions are unknown until reset() is called. */
+
+    mRules = &rules;
+    mPositions.assign(rules.instructionsCount(), std::string::npos);
+}
+
+
+void IncrementalMatchIndex::reset(const Word &word) {
+
+    /* Full search of every instruction in @word.
+     * Should be called once before the first step. Pruned instructions are never searched. */
+
+    for (std::size_t i=0; i<mPositions.size(); ++i) {
+        if (! mRules->isPruned(i))
+            mPositions[i] = word.find(mRules->replaceble(i), mRules->replacebleLength(i));
+    }
+}
+
+
+template <class Profiler>
+void IncrementalMatchIndex::update(const Word &word, std::size_t pos, std::size_t removed, std::size_t inserted,
+                                   Profiler &profiler) {
+
+    /* Must be called after @removed symbols at @pos of the word were replaced by @inserted symbols.
+     * @word is the word after the edit.
+     *
+     * For every instruction only occurrences, that touch the edited span, may appear or disappear:
+     * they start in the window [pos - length + 1, pos + inserted).
+     * Occurrences, that end before the edit, stay as is,
+     * occurrences, that start after the edit, are shifted by (inserted - removed).
+     * Searched symbols are counted by @profiler for every instruction (see InstructionsProfiler). */
+
+
+#ifndef NDEBUG
+    assert(pos + inserted <= word.size());
+#endif
+
+    for (std::size_t i=0; i<mPositions.size(); ++i) {
+        if (mRules->isPruned(i))
+            continue;
+
+        const char *pattern = mRules->replaceble(i);
+        const std::size_t length = mRules->replacebleLength(i);
+        std::size_t &position = mPositions[i];
+
+        /* Leftmost occurrence ends before the edit - nothing may appear before it. */
+        if (position != std::string::npos && position + length <= pos)
+            continue;
+
+        const std::size_t windowBegin = pos + 1 > length ? pos + 1 - length : 0;
+        const std::size_t windowEnd = pos + inserted;
+
+
+        std::size_t found = std::string::npos;
+        if (windowBegin < windowEnd) {
+            found = word.find(pattern, length, windowBegin, windowEnd - 1);
+            profiler.scanned(i, word, windowBegin, (found != std::string::npos ? found : windowEnd - 1) + length);
+        }
+
+        if (found != std::string::npos) {
+            /* Occurrence in the window is on the left of everything behind the edit. */
+            position = found;
+        }
+        else if (position == std::string::npos) {
+            /* Instruction was absent and did not appear. */
+        }
+        else if (position >= pos + removed) {
+            /* Leftmost occurrence is behind the edit. */
+            position = position + inserted - removed;
+        }
+        else {
+            /* Leftmost occurrence was destroyed by the edit.
+             * The next one (if any) can be only behind the edit, in unchanged part of the word. */
+            position = word.find(pattern, length, windowEnd);
+            profiler.scanned(i, word, windowEnd, position != std::string::npos ? position + length : std::string::npos);
+        }
+    }
+}
+
+
+template void IncrementalMatchIndex::update(const Word &, std::size_t, std::size_t, std::size_t, NoProfiling &);
+template void IncrementalMatchIndex::update(const Word &, std::size_t, std::size_t, std::size_t,
+                                            InstructionsProfiler &);
+
+
+bool IncrementalMatchIndex::findFirst(std::size_t &instructionIndex, std::size_t &pos) const {
+
+    /* Returns the lowest-numbered instruction, that occurs in the word, and its leftmost position.
+     * Returns false if no one instruction occurs in the word. */
+
+    for (std::size_t i=0; i<mPositions.size(); ++i) {
+        if (mPositions[i] != std::string::npos) {
+            instructionIndex = i;
+            pos = mPositions[i];
+            return true;
+        }
+    }
+
+    return false;
+}
+
@@ -0,0 +1,33 @@
+#ifndef MATCHINDEX_H
+#define MATCHINDEX_H
+
+#include <string>
+#include <vector>
+
+
+class RuleSet;
+class Word;
+
+
+/* Keeps leftmost occurrence of every instruction in the source word between steps.
+ * After the word is edited only the window around the edit is searched again,
+ * occurrences behind the edit are shifted, so step cost depends on the rules size,
+ * not on the word length. */
+class IncrementalMatchIndex {
+public:
+    IncrementalMatchIndex();
+
+    void build(const RuleSet &rules);
+    void reset(const Word &word);
+    template <class Profiler>
+    void update(const Word &word, std::size_t pos, std::size_t removed, std::size_t inserted, Profiler &profiler);
+
+    bool findFirst(std::size_t &instructionIndex, std::size_t &pos) const;
+
+private:
+    const RuleSet *mRules;
+    std::vector<std::size_t> mPositions;   /* instruction index -> leftmost occurrence (npos - absent) */
+};
+
+
+#endif // MATCHINDEX_H
@@ -1,13 +1,70 @@
 TEMPLATE = app
 CONFIG += console
 CONFIG -= qt
+CONFIG += c++11 thread
 
 SOURCES += main.cpp \
-    interpreter.cpp
+    interpreter.cpp \
+    alphabet.cpp \
+    matcher.cpp \
+    matchindex.cpp \
+    word.cpp \
+    cppemitter.cpp \
+    ruleset.cpp \
+    mappedfile.cpp \
+    patternsearch.cpp \
+    execution.cpp \
+    threadpool.cpp \
+    batchrunner.cpp \
+    tracewriter.cpp \
+    cycledetector.cpp \
+    watchdog.cpp \
+    rulesloader.cpp \
+    rulesanalyzer.cpp \
+    profiler.cpp \
+    libmna.cpp \
+    rulesetcache.cpp \
+    server.cpp \
+    checkpoint.cpp \
+    resultcache.cpp \
+    deltatrace.cpp \
+    allocationcounter.cpp \
+    regressionrunner.cpp
 
 HEADERS += \
-    interpreter.h
+    interpreter.h \
+    alphabet.h \
+    matcher.h \
+    matchindex.h \
+    word.h \
+    cppemitter.h \
+    ruleset.h \
+    mappedfile.h \
+    patternsearch.h \
+    execution.h \
+    threadpool.h \
+    batchrunner.h \
+    tracewriter.h \
+    cycledetector.h \
+    rollinghash.h \
+    fnvhash.h \
+    watchdog.h \
+    rulesloader.h \
+    rulesanalyzer.h \
+    profiler.h \
+    libmna.h \
+    rulesetcache.h \
+    server.h \
+    checkpoint.h \
+    resultcache.h \
+    deltatrace.h \
+    allocationcounter.h \
+    regressionrunner.h
 
 DEFINES += LINUX
 DEFINES += NDEBUG
 
+# Counting of heap allocations, reported by --timing (see allocationcounter.h).
+count_allocations {
+    DEFINES += COUNT_ALLOCATIONS
+}
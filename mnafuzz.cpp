@@ -0,0 +1,80 @@
+#include "differentialfuzzer.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+
+/* Differential fuzzer of the execution engines (see DifferentialFuzzer).
+ *
+ * Standalone:  mnafuzz [--iterations=N] [--seed=N] [--max-steps=N]
+ *              checks N generated programs (0 - until a divergence), prints the minimized program
+ *              of the first divergence and exits with 1.
+ * libFuzzer:   built with MNA_LIBFUZZER (qmake CONFIG+=libfuzzer), every input is decoded to a program;
+ *              the minimized program of the divergence is printed and the process aborts. */
+
+
+static void printDivergence(const DifferentialFuzzer::Program &program,
+                            const DifferentialFuzzer::Divergence &divergence) {
+    std::cout << "Engine \"" << divergence.engine << "\" diverges at step " << divergence.step << ": "
+              << divergence.description << std::endl
+              << "Minimized program:" << std::endl
+              << program.text() << std::flush;
+}
+
+
+#ifdef MNA_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, std::size_t size) {
+    static DifferentialFuzzer fuzzer;
+
+    DifferentialFuzzer::Program program = DifferentialFuzzer::decode(data, size);
+    DifferentialFuzzer::Divergence divergence;
+    if (! fuzzer.check(program, divergence)) {
+        fuzzer.minimize(program, divergence);
+        printDivergence(program, divergence);
+        std::abort();
+    }
+    return 0;
+}
+
+#else
+
+int main(int argc, char* argv[]) {
+    uint64_t iterations = 100000;
+    unsigned seed = 1;
+    std::size_t maxSteps = 200;
+
+    for (int i=1; i<argc; ++i) {
+        if (std::strncmp(argv[i], "--iterations=", 13) == 0)
+            iterations = std::strtoull(argv[i] + 13, 0, 10);
+        else if (std::strncmp(argv[i], "--seed=", 7) == 0)
+            seed = (unsigned)std::strtoul(argv[i] + 7, 0, 10);
+        else if (std::strncmp(argv[i], "--max-steps=", 12) == 0)
+            maxSteps = std::strtoul(argv[i] + 12, 0, 10);
+        else {
+            std::cout << "Unknown argument \"" << argv[i] << "\". Process stopped." << std::endl;
+            return 1;
+        }
+    }
+
+    DifferentialFuzzer fuzzer(maxSteps);
+    std::mt19937 random(seed);
+
+    for (uint64_t i=0; iterations == 0 || i < iterations; ++i) {
+        DifferentialFuzzer::Program program = DifferentialFuzzer::generate(random);
+        DifferentialFuzzer::Divergence divergence;
+        if (! fuzzer.check(program, divergence)) {
+            std::cout << "Program " << i + 1 << " (seed " << seed << "):" << std::endl;
+            fuzzer.minimize(program, divergence);
+            printDivergence(program, divergence);
+            return 1;
+        }
+    }
+
+    std::cout << "Checked programs: " << fuzzer.checkedCount()
+              << ", rejected by the loader: " << fuzzer.rejectedCount() << ". No divergences." << std::endl;
+    return 0;
+}
+
+#endif
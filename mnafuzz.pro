@@ -0,0 +1,57 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt
+CONFIG += c++11 thread
+
+TARGET = mnafuzz
+
+SOURCES += mnafuzz.cpp \
+    differentialfuzzer.cpp \
+    libmna.cpp \
+    alphabet.cpp \
+    matcher.cpp \
+    matchindex.cpp \
+    word.cpp \
+    ruleset.cpp \
+    mappedfile.cpp \
+    patternsearch.cpp \
+    execution.cpp \
+    threadpool.cpp \
+    cycledetector.cpp \
+    watchdog.cpp \
+    rulesloader.cpp \
+    rulesanalyzer.cpp \
+    profiler.cpp \
+    checkpoint.cpp \
+    deltatrace.cpp
+
+HEADERS += \
+    differentialfuzzer.h \
+    libmna.h \
+    alphabet.h \
+    matcher.h \
+    matchindex.h \
+    word.h \
+    ruleset.h \
+    mappedfile.h \
+    patternsearch.h \
+    execution.h \
+    threadpool.h \
+    cycledetector.h \
+    rollinghash.h \
+    fnvhash.h \
+    watchdog.h \
+    rulesloader.h \
+    rulesanalyzer.h \
+    profiler.h \
+    checkpoint.h \
+    deltatrace.h
+
+DEFINES += LINUX
+
+# Target of libFuzzer instead of the standalone generator (clang).
+libfuzzer {
+    DEFINES += MNA_LIBFUZZER
+    QMAKE_CXXFLAGS += -fsanitize=fuzzer,address
+    QMAKE_LFLAGS += -fsanitize=fuzzer,address
+}
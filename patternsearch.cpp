@@ -0,0 +1,208 @@
+#include "patternsearch.h"
+
+#include <cstring>
+
+#include <assert.h>
+
+#if defined(LINUX) && defined(__x86_64__) && defined(__GNUC__)
+#define VECTOR_KERNELS
+#include <immintrin.h>
+#endif
+
+
+typedef std::size_t (*FindFunction)(const char *, std::size_t, const char *, std::size_t);
+
+
+static std::size_t findScalar(const char *haystack, std::size_t size,
+                              const char *needle, std::size_t length) {
+
+    /* Returns offset of the first occurrence of @needle in @haystack, or npos.
+     * Candidates are found by memchr() on the first symbol. */
+
+    if (length == 0 || size < length)
+        return std::string::npos;
+
+    const char *begin = haystack;
+    const char *last = haystack + (size - length);
+    while (begin <= last) {
+        const char *candidate = (const char *)std::memchr(begin, needle[0], last - begin + 1);
+        if (candidate == 0)
+            break;
+
+        if (std::memcmp(candidate + 1, needle + 1, length - 1) == 0)
+            return candidate - haystack;
+
+        begin = candidate + 1;
+    }
+
+    return std::string::npos;
+}
+
+
+#ifdef VECTOR_KERNELS
+
+static std::size_t findTail(const char *haystack, std::size_t size, std::size_t pos,
+                            const char *needle, std::size_t length) {
+
+    /* Finishes the search from @pos, where less than one block of candidates is left. */
+
+    std::size_t found = findScalar(haystack + pos, size - pos, needle, length);
+    return found == std::string::npos ? found : pos + found;
+}
+
+
+static std::size_t findSse2(const char *haystack, std::size_t size,
+                            const char *needle, std::size_t length) {
+
+    /* Compares 16 candidate positions at once with the first and the last symbol of @needle.
+     * The middle of the pattern is compared only where both of them match. */
+
+    if (length == 0 || size < length)
+        return std::string::npos;
+    if (length == 1) {
+        const char *found = (const char *)std::memchr(haystack, needle[0], size);
+        return found ? found - haystack : std::string::npos;
+    }
+
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[length - 1]);
+    const std::size_t candidates = size - length + 1;
+
+    std::size_t pos = 0;
+    for (; pos + 16 <= candidates; pos += 16) {
+        __m128i blockFirst = _mm_loadu_si128((const __m128i *)(haystack + pos));
+        __m128i blockLast = _mm_loadu_si128((const __m128i *)(haystack + pos + length - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst),
+                                                                  _mm_cmpeq_epi8(last, blockLast)));
+        while (mask) {
+            std::size_t candidate = pos + __builtin_ctz(mask);
+            if (std::memcmp(haystack + candidate + 1, needle + 1, length - 2) == 0)
+                return candidate;
+            mask &= mask - 1;
+        }
+    }
+
+    return findTail(haystack, size, pos, needle, length);
+}
+
+
+__attribute__((target("avx2")))
+static std::size_t findAvx2(const char *haystack, std::size_t size,
+                            const char *needle, std::size_t length) {
+
+    /* The same as findSse2(), but with 32 candidate positions at once. */
+
+    if (length == 0 || size < length)
+        return std::string::npos;
+    if (length == 1) {
+        const char *found = (const char *)std::memchr(haystack, needle[0], size);
+        return found ? found - haystack : std::string::npos;
+    }
+
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[length - 1]);
+    const std::size_t candidates = size - length + 1;
+
+    std::size_t pos = 0;
+    for (; pos + 32 <= candidates; pos += 32) {
+        __m256i blockFirst = _mm256_loadu_si256((const __m256i *)(haystack + pos));
+        __m256i blockLast = _mm256_loadu_si256((const __m256i *)(haystack + pos + length - 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, blockFirst),
+                                                                        _mm256_cmpeq_epi8(last, blockLast)));
+        while (mask) {
+            std::size_t candidate = pos + __builtin_ctz(mask);
+            if (std::memcmp(haystack + candidate + 1, needle + 1, length - 2) == 0)
+                return candidate;
+            mask &= mask - 1;
+        }
+    }
+
+    return findTail(haystack, size, pos, needle, length);
+}
+
+#endif // VECTOR_KERNELS
+
+
+static FindFunction kernelFunction(PatternSearch::Kernel kernel) {
+
+#ifdef VECTOR_KERNELS
+    switch (kernel) {
+    case PatternSearch::Sse2Kernel:
+        return findSse2;
+    case PatternSearch::Avx2Kernel:
+        return findAvx2;
+    default:
+        break;
+    }
+#else
+    (void)kernel;
+#endif
+
+    return findScalar;
+}
+
+
+
+std::size_t PatternSearch::find(const char *haystack, std::size_t size,
+                                const char *needle, std::size_t length) {
+
+    /* Returns offset of the first occurrence of @needle in @haystack, or npos.
+     * Uses the best kernel, which is chosen once. */
+
+    static const FindFunction function = kernelFunction(bestKernel());
+    return function(haystack, size, needle, length);
+}
+
+
+std::size_t PatternSearch::find(Kernel kernel, const char *haystack, std::size_t size,
+                                const char *needle, std::size_t length) {
+
+    /* The same as find(), but with the given @kernel, that must be supported. */
+
+#ifndef NDEBUG
+    assert(isSupported(kernel));
+#endif
+
+    return kernelFunction(kernel)(haystack, size, needle, length);
+}
+
+
+bool PatternSearch::isSupported(Kernel kernel) {
+
+    switch (kernel) {
+    case ScalarKernel:
+        return true;
+#ifdef VECTOR_KERNELS
+    case Sse2Kernel:
+        return true;        /* part of x86-64 */
+    case Avx2Kernel:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+
+PatternSearch::Kernel PatternSearch::bestKernel() {
+
+    if (isSupported(Avx2Kernel))
+        return Avx2Kernel;
+    if (isSupported(Sse2Kernel))
+        return Sse2Kernel;
+    return ScalarKernel;
+}
+
+
+const char* PatternSearch::kernelName(Kernel kernel) {
+
+    switch (kernel) {
+    case Sse2Kernel:
+        return "SSE2";
+    case Avx2Kernel:
+        return "AVX2";
+    default:
+        return "scalar";
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef PATTERNSEARCH_H
+#define PATTERNSEARCH_H
+
+#include <string>
+
+
+/* Search of a short pattern in contiguous symbols.
+ * Candidate positions are filtered by the first and the last symbol of the pattern
+ * 16 (SSE2) or 32 (AVX2) positions at a time, and only then compared completely.
+ * The fastest kernel, supported by the processor, is chosen at the first search;
+ * on other systems the scalar kernel is used. */
+class PatternSearch {
+public:
+    enum Kernel {
+        ScalarKernel,
+        Sse2Kernel,
+        Avx2Kernel
+    };
+
+    static std::size_t find(const char *haystack, std::size_t size,
+                            const char *needle, std::size_t length);
+    static std::size_t find(Kernel kernel, const char *haystack, std::size_t size,
+                            const char *needle, std::size_t length);
+
+    static bool isSupported(Kernel kernel);
+    static Kernel bestKernel();
+    static const char* kernelName(Kernel kernel);
+};
+
+
+#endif // PATTERNSEARCH_H
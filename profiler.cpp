@@ -0,0 +1,182 @@
+#include "profiler.h"
+#include "alphabet.h"
+#include "ruleset.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <cstdio>
+
+
+static bool isCostlier(const InstructionsProfiler::Profile &left, const InstructionsProfiler::Profile &right) {
+
+    /* Order of the report: by estimated time, then by scanned and moved bytes, then by number. */
+
+    if (left.estimatedTime() != right.estimatedTime())
+        return left.estimatedTime() > right.estimatedTime();
+    if (left.scannedBytes + left.movedBytes != right.scannedBytes + right.movedBytes)
+        return left.scannedBytes + left.movedBytes > right.scannedBytes + right.movedBytes;
+    return left.instruction < right.instruction;
+}
+
+
+
+/* InstructionsProfiler */
+double InstructionsProfiler::Profile::estimatedTime() const {
+    return sampledTime * SAMPLE_PERIOD;
+}
+
+
+InstructionsProfiler::InstructionsProfiler() :
+    mNotFoundSearches(0), mStepsCount(0), mMovedBefore(0), mIsSampling(false) {}
+
+
+void InstructionsProfiler::reset(std::size_t instructionsCount) {
+
+    /* Clears all counters before the execution of @instructionsCount instructions. */
+
+    Profile empty = {0, 0, 0, 0, 0, 0, 0.0};
+    mProfiles.assign(instructionsCount, empty);
+    for (std::size_t i=0; i<instructionsCount; ++i)
+        mProfiles[i].instruction = i;
+
+    mSelections.assign(instructionsCount, 0);
+    mNotFoundSearches = 0;
+    mStepsCount = 0;
+    mIsSampling = false;
+}
+
+
+std::vector<InstructionsProfiler::Profile> InstructionsProfiler::profiles(const RuleSet &rules) const {
+
+    /* Returns counters of all instructions, the costliest first.
+     * Instruction was searched and not found by every search, that selected a later instruction
+     * or no one; pruned instructions are never searched. */
+
+    std::vector<Profile> profiles(mProfiles);
+
+    uint64_t laterSelections = mNotFoundSearches;
+    for (std::size_t i=profiles.size(); i>0; --i) {
+        profiles[i - 1].failedAttempts = rules.isPruned(i - 1) ? 0 : laterSelections;
+        laterSelections += mSelections[i - 1];
+    }
+
+    std::stable_sort(profiles.begin(), profiles.end(), isCostlier);
+    return profiles;
+}
+
+
+void InstructionsProfiler::printReport(std::ostream &stream, const RuleSet &rules, const Alphabet &alphabet) const {
+
+    /* Prints the table of counters, the costliest instruction first.
+     * Numbers of instructions are the same as in the table of loaded instructions. */
+
+#define NUMBER_COLUMN_WIDTH      4
+#define REPLACEBLE_COLUMN_WIDTH  17
+#define REPLACER_COLUMN_WIDTH    17
+#define FINAL_COLUMN_WIDTH       5
+#define COUNTER_COLUMN_WIDTH     12
+
+    const std::vector<Profile> profiles = this->profiles(rules);
+
+    stream << std::endl << "Profile of instructions (time is estimated by every " << SAMPLE_PERIOD
+           << "-th step): " << std::endl;
+    stream << std::setw(NUMBER_COLUMN_WIDTH)     << std::left << "N "
+           << std::setw(REPLACEBLE_COLUMN_WIDTH) << std::left << "Replaceble "
+           << std::setw(FINAL_COLUMN_WIDTH)      << std::left << "Type "
+           << std::setw(REPLACER_COLUMN_WIDTH)   << std::left << "Replacer "
+           << std::setw(COUNTER_COLUMN_WIDTH)    << std::left << "Fired "
+           << std::setw(COUNTER_COLUMN_WIDTH)    << std::left << "Failed "
+           << std::setw(COUNTER_COLUMN_WIDTH)    << std::left << "Scanned "
+           << std::setw(COUNTER_COLUMN_WIDTH)    << std::left << "Moved "
+           << std::left << "Time, s"
+           << std::endl;
+
+    for (std::size_t k=0; k<profiles.size(); ++k) {
+        const Profile &profile = profiles[k];
+        const std::size_t i = profile.instruction;
+
+        stream << std::setw(NUMBER_COLUMN_WIDTH) << std::left << i+1;
+        alphabet.printColumn(stream, rules.replaceble(i), rules.replacebleLength(i), REPLACEBLE_COLUMN_WIDTH);
+        stream << std::setw(FINAL_COLUMN_WIDTH) << std::left << (rules.isFinal(i) ? " ->." : " -> ");
+        alphabet.printColumn(stream, rules.replacer(i), rules.replacerLength(i), REPLACER_COLUMN_WIDTH);
+
+        stream << std::setw(COUNTER_COLUMN_WIDTH) << std::left << profile.firings
+               << std::setw(COUNTER_COLUMN_WIDTH) << std::left << profile.failedAttempts
+               << std::setw(COUNTER_COLUMN_WIDTH) << std::left << profile.scannedBytes
+               << std::setw(COUNTER_COLUMN_WIDTH) << std::left << profile.movedBytes
+               << profile.estimatedTime();
+        if (rules.isPruned(i))
+            stream << " (removed)";
+        stream << std::endl;
+    }
+}
+
+
+void InstructionsProfiler::writeJson(std::ostream &stream, const RuleSet &rules, const Alphabet &alphabet,
+                                     const std::string &sourceName) const {
+
+    /* Writes the same report as printReport() as JSON object. Symbols are written as UTF-8 text. */
+
+    const std::vector<Profile> profiles = this->profiles(rules);
+
+    uint64_t steps = 0;
+    for (std::size_t k=0; k<profiles.size(); ++k)
+        steps += profiles[k].firings;
+
+    stream << "{" << std::endl
+           << "  \"file\": " << jsonString(sourceName) << "," << std::endl
+           << "  \"steps\": " << steps << "," << std::endl
+           << "  \"samplePeriod\": " << SAMPLE_PERIOD << "," << std::endl
+           << "  \"instructions\": [";
+
+    std::string replaceble, replacer;
+    for (std::size_t k=0; k<profiles.size(); ++k) {
+        const Profile &profile = profiles[k];
+        const std::size_t i = profile.instruction;
+
+        replaceble.clear();
+        replacer.clear();
+        alphabet.decode(rules.replaceble(i), rules.replacebleLength(i), replaceble);
+        alphabet.decode(rules.replacer(i), rules.replacerLength(i), replacer);
+
+        stream << (k ? "," : "") << std::endl
+               << "    {\"number\": " << i+1
+               << ", \"replaceble\": " << jsonString(replaceble)
+               << ", \"replacer\": " << jsonString(replacer)
+               << ", \"final\": " << (rules.isFinal(i) ? "true" : "false")
+               << ", \"removed\": " << (rules.isPruned(i) ? "true" : "false")
+               << ", \"firings\": " << profile.firings
+               << ", \"failedAttempts\": " << profile.failedAttempts
+               << ", \"scannedBytes\": " << profile.scannedBytes
+               << ", \"movedBytes\": " << profile.movedBytes
+               << ", \"sampledSteps\": " << profile.sampledSteps
+               << ", \"sampledTime\": " << profile.sampledTime
+               << ", \"estimatedTime\": " << profile.estimatedTime() << "}";
+    }
+
+    stream << std::endl << "  ]" << std::endl << "}" << std::endl;
+}
+
+
+std::string InstructionsProfiler::jsonString(const std::string &str) {
+
+    /* Returns @str as JSON string literal. UTF-8 sequences are kept as is. */
+
+    std::string literal = "\"";
+    for (std::size_t i=0; i<str.size(); ++i) {
+        const unsigned char symbol = (unsigned char)str[i];
+        if (symbol == '"' || symbol == '\\') {
+            literal += '\\';
+            literal += str[i];
+        }
+        else if (symbol < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", symbol);
+            literal += escaped;
+        }
+        else
+            literal += str[i];
+    }
+
+    return literal + "\"";
+}
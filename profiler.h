@@ -0,0 +1,153 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <chrono>
+#include <stdint.h>
+
+#include "word.h"
+
+
+class Alphabet;
+class RuleSet;
+
+
+/* Profiling policy of Execution, that records nothing.
+ * All its methods are empty and inline, so execution, instantiated with it, has no profiling code at all. */
+class NoProfiling {
+public:
+    void beginStep() {}
+    void scanned(std::size_t, const Word &, std::size_t, std::size_t) {}
+    void selected(std::size_t) {}
+    void beginEdit(const Word &) {}
+    void edited(std::size_t, const Word &) {}
+    void endStep(std::size_t) {}
+};
+
+
+/* Profiling policy of Execution, that records for every instruction:
+ * - firings - steps, that executed it;
+ * - failed attempts - searches, that looked for it and did not find it, so a later instruction
+ *   (or no one) was selected. Every matching mode selects the lowest-numbered instruction,
+ *   so they are counted from the selections at the end, without any cost per instruction;
+ * - scanned bytes - symbols of the word, read while searching it. Automaton looks for all instructions
+ *   by one pass, so the pass is counted for the selected instruction;
+ * - moved bytes - bytes, copied by the word storage while executing it (see WordStorage::movedBytes());
+ * - time - every SAMPLE_PERIOD-th step is timed, so the time of the instruction is estimated
+ *   as sampled time multiplied by the period. */
+class InstructionsProfiler {
+public:
+    static const std::size_t SAMPLE_PERIOD = 64;
+
+    /* Counters of one instruction. */
+    struct Profile {
+        std::size_t instruction;
+        uint64_t firings;
+        uint64_t failedAttempts;
+        uint64_t scannedBytes;
+        uint64_t movedBytes;
+        uint64_t sampledSteps;
+        double sampledTime;         /* seconds */
+
+        double estimatedTime() const;
+    };
+
+    InstructionsProfiler();
+
+    void reset(std::size_t instructionsCount);
+
+    inline void beginStep();
+    inline void scanned(std::size_t instruction, const Word &word, std::size_t from, std::size_t end);
+    inline void selected(std::size_t instruction);
+    inline void beginEdit(const Word &word);
+    inline void edited(std::size_t instruction, const Word &word);
+    inline void endStep(std::size_t instruction);
+
+    std::vector<Profile> profiles(const RuleSet &rules) const;
+    void printReport(std::ostream &stream, const RuleSet &rules, const Alphabet &alphabet) const;
+    void writeJson(std::ostream &stream, const RuleSet &rules, const Alphabet &alphabet,
+                   const std::string &sourceName) const;
+
+private:
+    static std::string jsonString(const std::string &str);
+
+private:
+    std::vector<Profile> mProfiles;
+    std::vector<uint64_t> mSelections;  /* instruction -> searches, that selected it */
+    uint64_t mNotFoundSearches;         /* searches, that found no one instruction */
+    uint64_t mStepsCount;
+    uint64_t mMovedBefore;              /* moved bytes of the word before the edit */
+    bool mIsSampling;
+    std::chrono::steady_clock::time_point mStepStart;
+};
+
+
+void InstructionsProfiler::beginStep() {
+
+    /* Starts timing of the step, if it is sampled. */
+
+    mIsSampling = (mStepsCount++ % SAMPLE_PERIOD == 0);
+    if (mIsSampling)
+        mStepStart = std::chrono::steady_clock::now();
+}
+
+
+void InstructionsProfiler::scanned(std::size_t instruction, const Word &word, std::size_t from, std::size_t end) {
+
+    /* Counts symbols of @word in [@from, @end), read by the search of @instruction.
+     * @end = npos - up to the end of the word. */
+
+    if (instruction >= mProfiles.size())
+        return;
+
+    const std::size_t size = word.size();
+    if (end > size)
+        end = size;
+    if (end > from)
+        mProfiles[instruction].scannedBytes += end - from;
+}
+
+
+void InstructionsProfiler::selected(std::size_t instruction) {
+
+    /* Remembers the result of one search: the lowest-numbered instruction, that occurs in the word,
+     * or npos. */
+
+    if (instruction < mSelections.size())
+        ++mSelections[instruction];
+    else
+        ++mNotFoundSearches;
+}
+
+
+void InstructionsProfiler::beginEdit(const Word &word) {
+    mMovedBefore = word.movedBytes();
+}
+
+
+void InstructionsProfiler::edited(std::size_t instruction, const Word &word) {
+
+    /* Counts bytes, moved since beginEdit(), for @instruction. */
+
+    Profile &profile = mProfiles[instruction];
+    ++profile.firings;
+    profile.movedBytes += word.movedBytes() - mMovedBefore;
+}
+
+
+void InstructionsProfiler::endStep(std::size_t instruction) {
+
+    /* Adds time of the sampled step to @instruction, executed by it. */
+
+    if (! mIsSampling || instruction >= mProfiles.size())
+        return;
+
+    Profile &profile = mProfiles[instruction];
+    ++profile.sampledSteps;
+    profile.sampledTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - mStepStart).count();
+}
+
+
+#endif // PROFILER_H
@@ -0,0 +1,367 @@
+#include "regressionrunner.h"
+#include "libmna.h"
+#include "watchdog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <new>
+#include <iomanip>
+#include <sstream>
+
+#ifdef LINUX
+#include <dirent.h>
+#endif
+
+
+#define NAME_COLUMN_WIDTH    32
+#define STATUS_COLUMN_WIDTH  8
+#define STEPS_COLUMN_WIDTH   14
+#define SPEED_COLUMN_WIDTH   12
+#define TIME_COLUMN_WIDTH    12
+#define MAX_SHOWN_WORD       40
+#define MIN_COMPARED_TIME    0.01      /* seconds, shorter runs are too noisy to compare speed */
+
+
+static bool hasSuffix(const std::string &str, const char *suffix) {
+    const std::size_t length = std::char_traits<char>::length(suffix);
+    return str.size() > length && str.compare(str.size() - length, length, suffix) == 0;
+}
+
+
+static std::string shortened(const std::string &word) {
+
+    /* Returns @word, cut to MAX_SHOWN_WORD bytes for the report. */
+
+    if (word.size() <= MAX_SHOWN_WORD)
+        return word;
+    return word.substr(0, MAX_SHOWN_WORD) + "...";
+}
+
+
+RegressionRunner::RegressionRunner(const Execution::Options &options, double timeLimit, std::size_t threadsCount) :
+    mOptions(options), mTimeLimit(timeLimit), mPool(threadsCount),
+    mTolerance(0), mIsUpdatingBaseline(false), mIsPassed(false) {}
+
+
+void RegressionRunner::setBaseline(const std::string &fileName, double tolerance, bool isUpdating) {
+
+    /* Results are compared with the baseline "fileName": the slowdown of time per step
+     * up to @tolerance (0.25 - 25%) is allowed. If @isUpdating, the results are not compared,
+     * the baseline is rewritten by the steps and times of passed files. */
+
+    mBaselineFileName = fileName;
+    mTolerance = tolerance;
+    mIsUpdatingBaseline = isUpdating;
+}
+
+
+bool RegressionRunner::isPassed() const {
+
+    /* Returns true if all files of the last run have expected results and there were no regressions. */
+
+    return mIsPassed;
+}
+
+
+bool RegressionRunner::run(const std::string &directory, std::ostream &output) {
+
+    /* Executes all files of @directory in parallel and prints the line of every file (in the order
+     * of names) and the summary. Returns false if the directory or the baseline can't be read,
+     * or the baseline can't be written; results of the files are reported by isPassed(). */
+
+    mIsPassed = false;
+
+    std::vector<std::string> names;
+    if (! listFiles(directory, names)) {
+        output << "ERROR: Can't read directory \"" << directory << "\". Process stopped." << std::endl;
+        return false;
+    }
+
+    mBaseline.clear();
+    if (! mBaselineFileName.empty() && ! mIsUpdatingBaseline && ! loadBaseline(output))
+        return false;
+
+    const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    std::vector<Case> cases(names.size());
+    for (std::size_t i=0; i<cases.size(); ++i) {
+        Case *test = &cases[i];
+        test->name = names[i];
+        mPool.submit([this, &directory, test](std::size_t) { runCase(directory, *test); });
+    }
+    mPool.wait();
+
+    const double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    output << std::setw(NAME_COLUMN_WIDTH)   << std::left  << "File "
+           << std::setw(STATUS_COLUMN_WIDTH) << std::left  << "Result "
+           << std::setw(STEPS_COLUMN_WIDTH)  << std::right << "Steps"
+           << std::setw(SPEED_COLUMN_WIDTH)  << std::right << "ns/step"
+           << std::setw(TIME_COLUMN_WIDTH)   << std::right << "Time, s" << std::endl;
+
+    std::size_t passedCount = 0, failedCount = 0, regressionsCount = 0;
+    for (std::size_t i=0; i<cases.size(); ++i) {
+        if (! mBaseline.empty())
+            compareWithBaseline(cases[i]);
+        printCase(cases[i], output);
+
+        if (cases[i].status == Passed)
+            ++passedCount;
+        else if (cases[i].status == StepsChanged || cases[i].status == Slower)
+            ++regressionsCount;
+        else
+            ++failedCount;
+    }
+
+    output << std::endl << "Files: " << cases.size() << ", passed: " << passedCount
+           << ", failed: " << failedCount << ", regressions: " << regressionsCount
+           << ", wall time: " << wallTime << " s." << std::endl;
+    if (cases.empty())
+        output << "WARNING: There are no algorithm files in directory \"" << directory << "\"." << std::endl;
+
+    if (mIsUpdatingBaseline && ! saveBaseline(cases, output))
+        return false;
+
+    mIsPassed = failedCount == 0 && regressionsCount == 0;
+    return true;
+}
+
+
+bool RegressionRunner::listFiles(const std::string &directory, std::vector<std::string> &names) {
+
+    /* Collects names of the algorithm files of @directory in alphabetical order.
+     * Returns false if the directory can't be read. */
+
+    names.clear();
+
+#ifdef LINUX
+    DIR *dir = opendir(directory.c_str());
+    if (! dir)
+        return false;
+
+    while (const dirent *entry = readdir(dir)) {
+        const std::string name = entry->d_name;
+        if (hasSuffix(name, ".mna") || hasSuffix(name, ".mnb"))
+            names.push_back(name);
+    }
+    closedir(dir);
+
+    std::sort(names.begin(), names.end());
+    return true;
+#else
+    (void)directory;
+    return false;
+#endif
+}
+
+
+bool RegressionRunner::readExpected(const std::string &fileName, Case &test) const {
+
+    /* Reads the expected word and the budgets of @test from "fileName".
+     * Returns false if it can't be read (see the message of @test). */
+
+    std::ifstream file(fileName.c_str());
+    if (! file) {
+        test.message = "Can't open file \"" + fileName + "\".";
+        return false;
+    }
+
+    std::string line;
+    for (std::size_t number=1; std::getline(file, line); ++number) {
+
+        /* Files with Windows line ends. */
+        if (! line.empty() && line[line.size() - 1] == '\r')
+            line.resize(line.size() - 1);
+
+        if (number == 1)
+            test.expectedWord = line;
+        else if (line.compare(0, 10, "max-steps=") == 0)
+            test.maxSteps = std::strtoul(line.c_str() + 10, 0, 10);
+        else if (line.compare(0, 11, "time-limit=") == 0)
+            test.timeLimit = std::strtod(line.c_str() + 11, 0);
+        else if (! line.empty()) {
+            std::ostringstream message;
+            message << "Unknown line " << number << " of file \"" << fileName << "\".";
+            test.message = message.str();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+void RegressionRunner::runCase(const std::string &directory, Case &test) {
+
+    /* Loads and executes the file of @test with its budgets, and checks its result. */
+
+    test.maxSteps = mOptions.maxSteps;
+    test.timeLimit = mTimeLimit;
+    test.status = Broken;
+    test.stepsCount = 0;
+    test.time = 0;
+
+    const std::string fileName = directory + "/" + test.name;
+    if (! readExpected(fileName.substr(0, fileName.size() - 4) + ".expected", test))
+        return;
+
+    try {
+        MarkovAlgorithm algorithm;
+        algorithm.setSourceWordOnly(true);
+        if (! algorithm.load(fileName, 1)) {
+            const std::string &messages = algorithm.messages();
+            test.message = messages.substr(0, messages.find('\n'));
+            return;
+        }
+
+        Watchdog watchdog;
+        Execution::Options options = mOptions;
+        options.maxSteps = test.maxSteps;
+        options.watchdog = &watchdog;
+        options.searchPool = 0;
+
+        MarkovContext context(algorithm, options);
+        MarkovResult result;
+
+        watchdog.start(test.timeLimit, 0);
+        context.runSourceWord(result);
+        watchdog.stop();
+
+        test.stepsCount = result.stepsCount;
+        test.time = watchdog.elapsedTime();
+
+        if (Execution::isAbnormalStop(result.stopReason)) {
+            test.status = Failed;
+            test.message = std::string("Execution stopped: ") + Execution::stopReasonText(result.stopReason);
+        }
+        else if (result.word != test.expectedWord) {
+            test.status = Failed;
+            test.message = "Result \"" + shortened(result.word) + "\" differs from expected \""
+                         + shortened(test.expectedWord) + "\".";
+        }
+        else
+            test.status = Passed;
+
+    } catch (std::bad_alloc &) {
+        test.status = Broken;
+        test.message = "Not enough memory.";
+    } catch (std::exception &) {
+        test.status = Broken;
+        test.message = "Unknown error occured.";
+    }
+}
+
+
+void RegressionRunner::compareWithBaseline(Case &test) const {
+
+    /* Marks passed @test as regression, if its steps differ from the baseline,
+     * or it is slower than the baseline by more than the tolerance.
+     * Speed is compared only for the runs, that take at least MIN_COMPARED_TIME. */
+
+    std::map<std::string, BaselineEntry>::const_iterator entry = mBaseline.find(test.name);
+    if (test.status != Passed || entry == mBaseline.end())
+        return;
+
+    const BaselineEntry &baseline = entry->second;
+    std::ostringstream message;
+
+    if (test.stepsCount != baseline.stepsCount) {
+        test.status = StepsChanged;
+        message << "Steps changed from " << baseline.stepsCount << ".";
+    }
+    else if (test.stepsCount > 0 && test.time >= MIN_COMPARED_TIME && baseline.time >= MIN_COMPARED_TIME) {
+        const double nsPerStep = test.time * 1e9 / test.stepsCount;
+        if (nsPerStep > baseline.nsPerStep * (1 + mTolerance)) {
+            test.status = Slower;
+            message << std::fixed << std::setprecision(0)
+                    << "Slower than " << baseline.nsPerStep << " ns/step of the baseline by "
+                    << (nsPerStep / baseline.nsPerStep - 1) * 100 << "%.";
+        }
+    }
+
+    test.message = message.str();
+}
+
+
+bool RegressionRunner::loadBaseline(std::ostream &output) {
+
+    /* Reads the baseline: lines "name steps ns/step seconds", "#" starts a comment. */
+
+    std::ifstream file(mBaselineFileName.c_str());
+    if (! file) {
+        output << "ERROR: Can't open baseline \"" << mBaselineFileName << "\". Process stopped." << std::endl;
+        return false;
+    }
+
+    std::string line;
+    for (std::size_t number=1; std::getline(file, line); ++number) {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream fields(line);
+        std::string name;
+        BaselineEntry entry;
+        if (! (fields >> name >> entry.stepsCount >> entry.nsPerStep >> entry.time)) {
+            output << "ERROR: Line " << number << " of baseline \"" << mBaselineFileName
+                   << "\" is damaged. Process stopped." << std::endl;
+            return false;
+        }
+        mBaseline[name] = entry;
+    }
+
+    return true;
+}
+
+
+bool RegressionRunner::saveBaseline(const std::vector<Case> &cases, std::ostream &output) const {
+
+    /* Writes steps and times of passed @cases to the baseline. */
+
+    std::ofstream file(mBaselineFileName.c_str());
+    file << "# file steps ns/step seconds" << std::endl;
+    for (std::size_t i=0; i<cases.size(); ++i) {
+        const Case &test = cases[i];
+        if (test.status != Passed)
+            continue;
+
+        file << test.name << ' ' << test.stepsCount << ' '
+             << (test.stepsCount ? test.time * 1e9 / test.stepsCount : 0) << ' ' << test.time << std::endl;
+    }
+
+    file.close();
+    if (! file) {
+        output << "ERROR: Can't write baseline \"" << mBaselineFileName << "\". Process stopped." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+void RegressionRunner::printCase(const Case &test, std::ostream &output) {
+
+    /* Prints the line of @test and its message. */
+
+    static const char *const statusNames[] = { "PASS", "FAIL", "ERROR", "STEPS", "SLOWER" };
+
+    output << std::setw(NAME_COLUMN_WIDTH - 1)   << std::left  << test.name << " "
+           << std::setw(STATUS_COLUMN_WIDTH) << std::left  << statusNames[test.status];
+
+    if (test.status == Broken)
+        output << test.message << std::endl;
+    else {
+        const std::ios_base::fmtflags flags = output.flags();
+        output << std::setw(STEPS_COLUMN_WIDTH) << std::right << test.stepsCount
+               << std::setw(SPEED_COLUMN_WIDTH) << std::right << std::fixed << std::setprecision(1)
+               << (test.stepsCount ? test.time * 1e9 / test.stepsCount : 0.0)
+               << std::setw(TIME_COLUMN_WIDTH) << std::right << std::setprecision(4) << test.time;
+        output.flags(flags);
+        output << std::setprecision(6);
+
+        if (! test.message.empty())
+            output << "  " << test.message;
+        output << std::endl;
+    }
+}
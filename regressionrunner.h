@@ -0,0 +1,86 @@
+#ifndef REGRESSIONRUNNER_H
+#define REGRESSIONRUNNER_H
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "execution.h"
+#include "threadpool.h"
+
+
+/* Executes every algorithm file (.mna or .mnb) of the directory for its source word on the thread pool
+ * and checks the result by the expected word, kept next to it in the file "name.expected":
+ *
+ *     expected word (as it is printed by --trace=final)
+ *     max-steps=N             - optional budgets of the file instead of the common ones
+ *     time-limit=SECONDS
+ *
+ * Every file is loaded and executed by one worker with its own watchdog, so the time budget
+ * and the measured time belong to the file alone.
+ *
+ * Results can be compared with the baseline - the text file with steps and time per step
+ * of every passed file from the previous run: a file, that takes another number of steps,
+ * or is slower than the baseline by more than the tolerance, is a regression. */
+class RegressionRunner {
+public:
+    RegressionRunner(const Execution::Options &options, double timeLimit, std::size_t threadsCount = 0);
+
+    void setBaseline(const std::string &fileName, double tolerance, bool isUpdating);
+    bool run(const std::string &directory, std::ostream &output);
+    bool isPassed() const;
+
+private:
+    RegressionRunner(const RegressionRunner &);
+    RegressionRunner& operator=(const RegressionRunner &);
+
+    enum Status {
+        Passed,
+        Failed,                 /* wrong result word, or execution was stopped by a limit */
+        Broken,                 /* the file or its expected word can't be read */
+        StepsChanged,           /* regressions against the baseline */
+        Slower
+    };
+
+    struct Case {
+        std::string name;
+        std::string expectedWord;
+        std::size_t maxSteps;
+        double timeLimit;
+
+        Status status;
+        std::string message;
+        std::size_t stepsCount;
+        double time;                /* seconds of execution */
+    };
+
+    struct BaselineEntry {
+        std::size_t stepsCount;
+        double nsPerStep;
+        double time;
+    };
+
+    static bool listFiles(const std::string &directory, std::vector<std::string> &names);
+    bool readExpected(const std::string &fileName, Case &test) const;
+    void runCase(const std::string &directory, Case &test);
+    void compareWithBaseline(Case &test) const;
+    bool loadBaseline(std::ostream &output);
+    bool saveBaseline(const std::vector<Case> &cases, std::ostream &output) const;
+    static void printCase(const Case &test, std::ostream &output);
+
+private:
+    const Execution::Options mOptions;
+    const double mTimeLimit;                /* seconds of every file, 0 - unlimited */
+    ThreadPool mPool;
+
+    std::string mBaselineFileName;          /* empty - no baseline */
+    double mTolerance;                      /* allowed slowdown, 0.25 - 25% */
+    bool mIsUpdatingBaseline;
+    std::map<std::string, BaselineEntry> mBaseline;
+
+    bool mIsPassed;
+};
+
+
+#endif // REGRESSIONRUNNER_H
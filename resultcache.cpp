@@ -0,0 +1,455 @@
+#include "resultcache.h"
+#include "checkpoint.h"
+#include "fnvhash.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef LINUX
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+#define RESULT_CACHE_MAGIC          "MNARCACH"
+#define RESULT_CACHE_FORMAT_VERSION 1
+#define RESULT_CACHE_BYTE_ORDER     0x01020304u
+
+
+namespace {
+
+struct FileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+};
+
+
+/* Header of record, followed by @wordSize units of the source word and @resultSize units
+ * of the result word, padded to 8 bytes. Checksum covers everything after it. */
+struct RecordHeader {
+    uint64_t checksum;
+    uint64_t key;                   /* of the algorithm (see ResultCache::key()) */
+    uint64_t stepsCount;
+    uint64_t cycleLength;
+    uint32_t stopReason;
+    uint32_t wordSize;
+    uint32_t resultSize;
+    uint32_t reserved;
+};
+
+
+bool isCacheFile(const MappedFile &file) {
+
+    /* Returns true if @file starts with the header of this version. */
+
+    FileHeader header;
+    if (file.size() < sizeof(header))
+        return false;
+
+    std::memcpy(&header, file.data(), sizeof(header));
+    return std::memcmp(header.magic, RESULT_CACHE_MAGIC, sizeof(header.magic)) == 0
+            && header.byteOrder == RESULT_CACHE_BYTE_ORDER && header.version == RESULT_CACHE_FORMAT_VERSION;
+}
+
+
+std::size_t paddedSize(std::size_t size) {
+    return (size + 7) & ~(std::size_t)7;
+}
+
+
+/* Lock of the cache file between processes. Does nothing on other systems. */
+class FileLock {
+public:
+    FileLock(const std::string &fileName, bool isExclusive) : mDescriptor(-1) {
+#ifdef LINUX
+        mDescriptor = ::open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+        if (mDescriptor >= 0)
+            flock(mDescriptor, isExclusive ? LOCK_EX : LOCK_SH);
+#else
+        (void)fileName;
+        (void)isExclusive;
+#endif
+    }
+
+    ~FileLock() {
+#ifdef LINUX
+        if (mDescriptor >= 0)
+            ::close(mDescriptor);       /* releases the lock */
+#endif
+    }
+
+private:
+    int mDescriptor;
+};
+
+
+uint64_t fileId(const std::string &fileName) {
+
+    /* Returns inode of the file, so replacement of the file can be detected; 0 on other systems. */
+
+#ifdef LINUX
+    struct stat info;
+    if (stat(fileName.c_str(), &info) == 0)
+        return (uint64_t)info.st_ino;
+#else
+    (void)fileName;
+#endif
+    return 0;
+}
+
+}
+
+
+struct ResultCache::Record {
+    RecordHeader header;
+    const char *word;
+    const char *result;
+};
+
+
+
+ResultCache::ResultCache(const std::string &fileName, std::size_t maxSize) :
+    mFileName(fileName), mMaxSize(maxSize), mKey(0), mMappedId(0), mCheckedId(0), mCheckedSize(0),
+    mHits(0), mMisses(0) {}
+
+
+bool ResultCache::open(uint64_t key) {
+
+    /* Maps the file and indexes the records of algorithm @key. Missing file is an empty cache.
+     * The file over the size limit is rewritten, the mapping stays on the old file then.
+     * Returns false if the file is not a result cache or can't be rewritten (see error()). */
+
+    mKey = key;
+    mIndex.clear();
+    mMappedId = mCheckedId = 0;
+    mCheckedSize = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFoundOffsets.clear();
+    }
+    {
+        FileLock lock(mFileName + ".lock", false);
+
+        if (! mFile.open(mFileName))
+            return true;
+
+        if (mFile.size() == 0)
+            return true;
+
+        if (! isCacheFile(mFile)) {
+            mFile.close();
+            mError = "File \"" + mFileName + "\" is not a result cache of this version of the interpreter.";
+            return false;
+        }
+
+        std::size_t offset = sizeof(FileHeader);
+        Record record;
+        while (std::size_t size = readRecord(mFile.data(), mFile.size(), offset, record)) {
+            if (record.header.key == key)
+                mIndex.insert(std::make_pair(FnvHash::add(FnvHash::FIRST, record.word, record.header.wordSize), offset));
+            offset += size;
+        }
+
+        mMappedId = mCheckedId = fileId(mFileName);
+        mCheckedSize = offset;
+    }
+
+    /* Otherwise a run, that only reads, would never trim the file. */
+    if (mMaxSize && mFile.size() > mMaxSize)
+        return write(std::string());
+    return true;
+}
+
+
+bool ResultCache::find(const char *word, std::size_t size, Result &result) {
+
+    /* Looks for the result of the word of @size units. May be called from any thread. */
+
+    typedef std::unordered_multimap<uint64_t, std::size_t>::const_iterator Iterator;
+    std::pair<Iterator, Iterator> range = mIndex.equal_range(FnvHash::add(FnvHash::FIRST, word, size));
+
+    for (Iterator it=range.first; it!=range.second; ++it) {
+
+        /* Indexed records were checked by open(). */
+        RecordHeader header;
+        const char *record = mFile.data() + it->second;
+        std::memcpy(&header, record, sizeof(header));
+        if (header.wordSize != size || std::memcmp(record + sizeof(header), word, size) != 0)
+            continue;
+
+        result.stopReason = (Execution::StopReason)header.stopReason;
+        result.stepsCount = (std::size_t)header.stepsCount;
+        result.cycleLength = (std::size_t)header.cycleLength;
+        result.word = record + sizeof(header) + size;
+        result.wordSize = header.resultSize;
+
+        ++mHits;
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFoundOffsets.insert(it->second);
+        return true;
+    }
+
+    ++mMisses;
+    return false;
+}
+
+
+void ResultCache::add(const char *word, std::size_t size, const Execution &execution) {
+
+    /* Adds the result of finished @execution of the word of @size units to the records,
+     * that are appended by the next flush(). Result word is kept only for normal stops,
+     * results of the time and memory limits are not kept. May be called from any thread. */
+
+    const Execution::StopReason reason = execution.stopReason();
+    const bool isNormalStop = reason == Execution::NoInstructionFound || reason == Execution::FinalInstructionExecuted;
+    if (! isCacheable(reason) || size > UINT32_MAX || (isNormalStop && execution.word().size() > UINT32_MAX))
+        return;
+
+    RecordHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.key = mKey;
+    header.stepsCount = execution.stepsCount();
+    header.cycleLength = reason == Execution::CycleDetected ? execution.cycleLength() : 0;
+    header.stopReason = (uint32_t)reason;
+    header.wordSize = (uint32_t)size;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    const std::size_t start = mPending.size();
+    mPending.append((const char *)&header, sizeof(header));
+    mPending.append(word, size);
+    if (isNormalStop)
+        execution.word().appendTo(mPending);
+
+    header.resultSize = (uint32_t)(mPending.size() - start - sizeof(header) - size);
+    mPending.resize(start + paddedSize(mPending.size() - start), '\0');
+
+    char *record = &mPending[start];
+    std::memcpy(record, &header, sizeof(header));
+    header.checksum = FnvHash::add(FnvHash::FIRST, record + sizeof(header.checksum),
+                                   mPending.size() - start - sizeof(header.checksum));
+    std::memcpy(record, &header.checksum, sizeof(header.checksum));
+}
+
+
+bool ResultCache::flush() {
+
+    /* Writes the added records to the file. Must be called from one thread.
+     * Records of other processes, that were written after open(), are kept.
+     * Returns false if the file can't be written (see error()); the records are lost then. */
+
+    std::string pending;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        pending.swap(mPending);
+    }
+    if (pending.empty())
+        return true;
+
+    return write(pending);
+}
+
+
+bool ResultCache::write(const std::string &pending) {
+
+    /* Appends @pending records to the file or rewrites it, if it is over the size limit
+     * or has a torn tail. Returns false if the file can't be written (see error()). */
+
+    FileLock lock(mFileName + ".lock", true);
+
+    MappedFile current;
+    const uint64_t id = fileId(mFileName);
+    if (! current.open(mFileName) || current.size() == 0)
+        return rewrite(pending, 0, 0, id);
+
+    /* The file was replaced by something else, it is not overwritten. */
+    if (! isCacheFile(current)) {
+        mError = "File \"" + mFileName + "\" is not a result cache of this version of the interpreter.";
+        return false;
+    }
+
+    /* Only records of other processes are checked, if the file was not replaced;
+     * the tail may be torn by a crashed writer. */
+    std::size_t validSize = sizeof(FileHeader);
+    if (id && id == mCheckedId && mCheckedSize <= current.size())
+        validSize = mCheckedSize;
+
+    Record record;
+    while (std::size_t size = readRecord(current.data(), current.size(), validSize, record))
+        validSize += size;
+
+    if (validSize < current.size() || (mMaxSize && validSize + pending.size() > mMaxSize))
+        return rewrite(pending, current.data(), validSize, id);
+
+    std::FILE *file = std::fopen(mFileName.c_str(), "ab");
+    bool isWritten = file && std::fwrite(pending.data(), 1, pending.size(), file) == pending.size();
+    isWritten = file && std::fclose(file) == 0 && isWritten;
+    if (! isWritten) {
+        mError = "Can't write file \"" + mFileName + "\".";
+        return false;
+    }
+
+    mCheckedId = id;
+    mCheckedSize = validSize + pending.size();
+    return true;
+}
+
+
+bool ResultCache::rewrite(const std::string &pending, const char *data, std::size_t size, uint64_t fileId) {
+
+    /* Writes the newest of the records of @size bytes of the file @data (with inode @fileId)
+     * and @pending records, that fit into half of the size limit, to the temporary file
+     * and renames it over the file. Records, that were found in this run, count as the newest. */
+
+    struct Span {
+        const char *data;
+        std::size_t size;
+    };
+
+    std::vector<Span> spans;            /* from the oldest to the newest */
+    std::vector<Span> foundSpans;
+    std::vector<std::size_t> found;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        found.assign(mFoundOffsets.begin(), mFoundOffsets.end());
+    }
+    std::sort(found.begin(), found.end());
+
+    const bool isMapped = data && fileId && fileId == mMappedId;
+    Record record;
+    for (std::size_t offset=sizeof(FileHeader); offset<size; ) {
+        const std::size_t recordSize = readRecord(data, size, offset, record);
+        const Span span = {data + offset, recordSize};
+        if (isMapped && std::binary_search(found.begin(), found.end(), offset))
+            foundSpans.push_back(span);
+        else
+            spans.push_back(span);
+        offset += recordSize;
+    }
+    spans.insert(spans.end(), foundSpans.begin(), foundSpans.end());
+
+    for (std::size_t offset=0; offset<pending.size(); ) {
+        const std::size_t recordSize = readRecord(pending.data(), pending.size(), offset, record);
+        const Span span = {pending.data() + offset, recordSize};
+        spans.push_back(span);
+        offset += recordSize;
+    }
+
+    /* The newest records are taken, while they fit. */
+    const std::size_t budget = mMaxSize ? mMaxSize / 2 : (std::size_t)-1;
+    std::vector<bool> isKept(spans.size(), false);
+    std::size_t keptSize = sizeof(FileHeader);
+    for (std::size_t i=spans.size(); i-- > 0; ) {
+        if (keptSize + spans[i].size <= budget) {
+            keptSize += spans[i].size;
+            isKept[i] = true;
+        }
+    }
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, RESULT_CACHE_MAGIC, sizeof(header.magic));
+    header.version = RESULT_CACHE_FORMAT_VERSION;
+    header.byteOrder = RESULT_CACHE_BYTE_ORDER;
+
+    const std::string tempFileName = mFileName + ".tmp";
+    std::FILE *file = std::fopen(tempFileName.c_str(), "wb");
+    if (! file) {
+        mError = "Can't create file \"" + tempFileName + "\".";
+        return false;
+    }
+
+    bool isWritten = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    for (std::size_t i=0; i<spans.size() && isWritten; ++i) {
+        if (isKept[i])
+            isWritten = std::fwrite(spans[i].data, 1, spans[i].size, file) == spans[i].size;
+    }
+    isWritten = std::fclose(file) == 0 && isWritten;
+
+    if (! isWritten || std::rename(tempFileName.c_str(), mFileName.c_str()) != 0) {
+        std::remove(tempFileName.c_str());
+        mError = "Can't write file \"" + mFileName + "\".";
+        return false;
+    }
+
+    /* The mapping is the replaced file now. */
+    mCheckedId = ::fileId(mFileName);
+    mCheckedSize = keptSize;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFoundOffsets.clear();
+    }
+    return true;
+}
+
+
+std::size_t ResultCache::readRecord(const char *data, std::size_t size, std::size_t offset, Record &record) {
+
+    /* Reads the record at @offset of @size bytes of @data.
+     * Returns size of the record or 0 if there is no whole record with the right checksum. */
+
+    RecordHeader &header = record.header;
+    if (offset + sizeof(header) > size)
+        return 0;
+
+    std::memcpy(&header, data + offset, sizeof(header));
+    const std::size_t recordSize = paddedSize(sizeof(header) + (std::size_t)header.wordSize + header.resultSize);
+    if (recordSize > size - offset || FnvHash::add(FnvHash::FIRST, data + offset + sizeof(header.checksum),
+                                                   recordSize - sizeof(header.checksum)) != header.checksum)
+        return 0;
+
+    record.word = data + offset + sizeof(header);
+    record.result = record.word + header.wordSize;
+    return recordSize;
+}
+
+
+std::size_t ResultCache::pendingSize() const {
+
+    /* Returns the size of records, that are not flushed yet. */
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPending.size();
+}
+
+
+uint64_t ResultCache::hits() const {
+    return mHits;
+}
+
+
+uint64_t ResultCache::misses() const {
+    return mMisses;
+}
+
+
+const std::string& ResultCache::error() const {
+    return mError;
+}
+
+
+bool ResultCache::isCacheable(Execution::StopReason reason) {
+
+    /* Returns true if the result depends only on the algorithm, the word and the key options:
+     * time and memory limits depend on the machine. */
+
+    return reason != Execution::NotStopped && reason != Execution::MemoryLimitReached
+            && reason != Execution::TimeLimitReached;
+}
+
+
+uint64_t ResultCache::key(const RuleSet &rules, const Alphabet &alphabet, const Execution::Options &options) {
+
+    /* Returns fingerprint of the algorithm (see Checkpoint::fingerprint()) with the options,
+     * that change the result: limits of steps and of the word length and detection of cycles. */
+
+    uint64_t hash = Checkpoint::fingerprint(rules, alphabet);
+    hash = FnvHash::add(hash, options.maxSteps);
+    hash = FnvHash::add(hash, options.maxWordLength);
+    hash = FnvHash::add(hash, options.isDetectingCycles ? 1 : 0);
+    return hash;
+}
@@ -0,0 +1,91 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <stdint.h>
+
+#include "execution.h"
+#include "mappedfile.h"
+
+
+class Alphabet;
+
+
+/* Results of executions, kept in a file between runs of the process:
+ * (key of the algorithm, source word) -> (result word, number of steps, stop reason).
+ *
+ * The file is a log of records with checksums, new records are appended at the end.
+ * It is mapped at open() and indexed by the words of the algorithm, so lookups read the mapping
+ * and do not copy results. Records of the run are collected in memory and appended by flush(),
+ * they are found from the next open().
+ * When the file grows over the size limit (or is over it at open(), e.g. after the limit was lowered),
+ * it is rewritten with the newest records (records, that were found in this run, count as the newest)
+ * into a temporary file, that is renamed over it.
+ *
+ * Several processes may use one file: readers map it under shared lock, writers append or rewrite it
+ * under exclusive lock (the lock file is "file.lock"). Mapping of the replaced file stays valid,
+ * torn record of the crashed writer is cut off by the next writer. */
+class ResultCache {
+public:
+    struct Result {
+        Execution::StopReason stopReason;
+        std::size_t stepsCount;
+        std::size_t cycleLength;
+        const char *word;           /* units, valid while the cache is open */
+        std::size_t wordSize;
+    };
+
+    ResultCache(const std::string &fileName, std::size_t maxSize);
+
+    bool open(uint64_t key);
+    bool find(const char *word, std::size_t size, Result &result);
+    void add(const char *word, std::size_t size, const Execution &execution);
+    bool flush();
+
+    std::size_t pendingSize() const;
+    uint64_t hits() const;
+    uint64_t misses() const;
+    const std::string& error() const;
+
+    static bool isCacheable(Execution::StopReason reason);
+    static uint64_t key(const RuleSet &rules, const Alphabet &alphabet, const Execution::Options &options);
+
+private:
+    ResultCache(const ResultCache &);
+    ResultCache& operator=(const ResultCache &);
+
+    struct Record;
+
+    static std::size_t readRecord(const char *data, std::size_t size, std::size_t offset, Record &record);
+    bool write(const std::string &pending);
+    bool rewrite(const std::string &pending, const char *data, std::size_t size, uint64_t fileId);
+
+private:
+    const std::string mFileName;
+    const std::size_t mMaxSize;             /* bytes of the file */
+    uint64_t mKey;
+
+    MappedFile mFile;                       /* the file at open() */
+    uint64_t mMappedId;                     /* inode of the mapped file, 0 - unknown */
+    std::unordered_multimap<uint64_t, std::size_t> mIndex;     /* hash of the word -> offset of record */
+
+    /* Whole records at the beginning of the file, that were checked by this process. */
+    uint64_t mCheckedId;
+    std::size_t mCheckedSize;
+
+    mutable std::mutex mMutex;
+    std::string mPending;                   /* records to append */
+    std::unordered_set<std::size_t> mFoundOffsets;     /* records of the mapping, that were found */
+
+    std::atomic<uint64_t> mHits;
+    std::atomic<uint64_t> mMisses;
+    std::string mError;
+};
+
+
+#endif // RESULTCACHE_H
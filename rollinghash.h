@@ -0,0 +1,29 @@
+#ifndef ROLLINGHASH_H
+#define ROLLINGHASH_H
+
+#include <stdint.h>
+
+
+/* Polynomial hash modulo 2^64: hash(s) = sum of value(s[i]) * BASE^i.
+ * BASE is odd, so it has the inverse and symbols can be removed from both ends of the hash.
+ * Hash of concatenation: hash(a + b) = hash(a) + BASE^|a| * hash(b). */
+struct RollingHash {
+    static const uint64_t BASE = 0x9E3779B97F4A7C15ull;
+
+    static uint64_t value(char symbol) {
+        return (uint64_t)(unsigned char)symbol + 1;
+    }
+
+    static uint64_t inverseBase() {
+
+        /* Newton's iterations: every one doubles the number of correct low bits. */
+
+        uint64_t inverse = BASE;
+        for (int i=0; i<6; ++i)
+            inverse *= 2 - BASE * inverse;
+        return inverse;
+    }
+};
+
+
+#endif // ROLLINGHASH_H
@@ -0,0 +1,138 @@
+#include "rulesanalyzer.h"
+#include "ruleset.h"
+
+#include <string>
+
+
+RulesAnalyzer::RulesAnalyzer(const RuleSet &rules, Words words) :
+    mRules(rules), mWords(words) {
+
+    for (std::size_t i=0; i<256; ++i)
+        mIsProducible[i] = false;
+}
+
+
+void RulesAnalyzer::analyze() {
+
+    /* Finds instructions, that can never be executed.
+     * Instruction, that is both unreachable and shadowed, is reported as unreachable. */
+
+    mFindings.clear();
+    findProducibleSymbols();
+
+    for (std::size_t i=0; i<mRules.instructionsCount(); ++i) {
+        if (mRules.isPruned(i))
+            continue;
+
+        const char *replaceble = mRules.replaceble(i);
+        const std::size_t length = mRules.replacebleLength(i);
+
+        std::size_t pos = 0;
+        while (pos < length && mIsProducible[(unsigned char)replaceble[pos]])
+            ++pos;
+
+        if (pos < length) {
+            Finding finding = {i, UnreachableRule, replaceble[pos], 0};
+            mFindings.push_back(finding);
+            continue;
+        }
+
+        /* The lowest-numbered instruction, that occurs in the replaceble part, is the instruction itself
+         * or the earlier one, that shadows it. */
+        std::size_t first = i, firstPos = 0;
+        if (mRules.matcher().findFirst(replaceble, length, first, firstPos) && first < i) {
+            Finding finding = {i, ShadowedRule, 0, first};
+            mFindings.push_back(finding);
+        }
+    }
+}
+
+
+const std::vector<RulesAnalyzer::Finding>& RulesAnalyzer::findings() const {
+
+    /* Returns instructions, that can never be executed, in ascending order. */
+
+    return mFindings;
+}
+
+
+std::vector<std::size_t> RulesAnalyzer::removedInstructions() const {
+
+    /* Returns indexes of the instructions, that can be removed (see RuleSet::prune()). */
+
+    std::vector<std::size_t> instructions;
+    for (std::size_t i=0; i<mFindings.size(); ++i)
+        instructions.push_back(mFindings[i].instruction);
+    return instructions;
+}
+
+
+void RulesAnalyzer::findProducibleSymbols() {
+
+    /* Propagates producible symbols from the source word through the instructions.
+     * Every instruction waits for the distinct symbols of its replaceble part;
+     * when the last of them becomes producible, symbols of its replacer become producible too.
+     * Every symbol and every instruction is processed once.
+     * Any symbol is producible, if not only the source word is executed. */
+
+    if (mWords == AnyWords) {
+        for (std::size_t i=0; i<256; ++i)
+            mIsProducible[i] = true;
+        return;
+    }
+
+    std::vector<std::vector<std::size_t> > waiting(256);
+    std::vector<std::size_t> missing(mRules.instructionsCount(), 0);
+    std::vector<std::size_t> lastInstruction(256, std::string::npos);
+
+    for (std::size_t i=0; i<mRules.instructionsCount(); ++i) {
+        if (mRules.isPruned(i))
+            continue;
+
+        const char *replaceble = mRules.replaceble(i);
+        for (std::size_t pos=0; pos<mRules.replacebleLength(i); ++pos) {
+            unsigned char symbol = (unsigned char)replaceble[pos];
+            if (lastInstruction[symbol] != i) {
+                lastInstruction[symbol] = i;
+                waiting[symbol].push_back(i);
+                ++missing[i];
+            }
+        }
+    }
+
+    for (std::size_t i=0; i<256; ++i)
+        mIsProducible[i] = false;
+
+    std::vector<unsigned char> queue;
+    produce(mRules.sourceWord(), mRules.sourceWordSize(), queue);
+
+    while (! queue.empty()) {
+        unsigned char symbol = queue.back();
+        queue.pop_back();
+
+        for (std::size_t k=0; k<waiting[symbol].size(); ++k) {
+            const std::size_t i = waiting[symbol][k];
+            if (--missing[i] > 0)
+                continue;
+
+            /* Instruction can be executed: system symbols are added after every step. */
+            produce("!@", 2, queue);
+            if (! mRules.isErasing(i))
+                produce(mRules.replacer(i), mRules.replacerLength(i), queue);
+        }
+    }
+}
+
+
+void RulesAnalyzer::produce(const char *symbols, std::size_t size, std::vector<unsigned char> &queue) {
+
+    /* Marks @symbols as producible and queues the new ones. */
+
+    for (std::size_t pos=0; pos<size; ++pos) {
+        unsigned char symbol = (unsigned char)symbols[pos];
+        if (! mIsProducible[symbol]) {
+            mIsProducible[symbol] = true;
+            queue.push_back(symbol);
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef RULESANALYZER_H
+#define RULESANALYZER_H
+
+#include <string>
+#include <vector>
+
+
+class RuleSet;
+
+
+/* Static analysis of the rule set, that finds instructions, which can never be executed:
+ * - unreachable: replaceble part contains a symbol, that can never appear in the word.
+ *   Symbols of the source word are producible; symbols of replacer (and system symbols "!" and "@")
+ *   become producible, when all symbols of replaceble part of the instruction are producible.
+ *   Found only if the rule set is executed for its source word alone (SourceWordOnly):
+ *   other words may contain any symbols;
+ * - shadowed: replaceble part of the instruction contains replaceble part of an earlier instruction,
+ *   so wherever it occurs, the earlier one occurs too and wins.
+ * Such instructions can be removed from matching without any change of the result. */
+class RulesAnalyzer {
+public:
+    enum Verdict {
+        UnreachableRule,
+        ShadowedRule
+    };
+
+    /* Words, that the rule set is executed for. */
+    enum Words {
+        SourceWordOnly,
+        AnyWords
+    };
+
+    /* Instruction, that can never be executed. */
+    struct Finding {
+        std::size_t instruction;
+        Verdict verdict;
+        char symbol;                /* unreachable: symbol, that never appears in the word */
+        std::size_t shadowedBy;     /* shadowed: index of the earlier instruction */
+    };
+
+    RulesAnalyzer(const RuleSet &rules, Words words = AnyWords);
+
+    void analyze();
+    const std::vector<Finding>& findings() const;
+    std::vector<std::size_t> removedInstructions() const;
+
+private:
+    RulesAnalyzer(const RulesAnalyzer &);
+    RulesAnalyzer& operator=(const RulesAnalyzer &);
+
+    void findProducibleSymbols();
+    void produce(const char *symbols, std::size_t size, std::vector<unsigned char> &queue);
+
+private:
+    const RuleSet &mRules;
+    const Words mWords;
+    std::vector<Finding> mFindings;
+    bool mIsProducible[256];
+};
+
+
+#endif // RULESANALYZER_H
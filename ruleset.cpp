@@ -0,0 +1,363 @@
+#include "ruleset.h"
+#include "fnvhash.h"
+
+#include <cstring>
+#include <fstream>
+#include <ostream>
+
+#include <assert.h>
+
+
+#define FILE_MAGIC          "MNARULES"
+#define FILE_FORMAT_VERSION 2
+#define FILE_BYTE_ORDER     0x01020304u
+#define SECTION_ALIGNMENT   8
+
+
+namespace {
+
+/* Header of compiled rule set file.
+ * All offsets are counted from the beginning of the file,
+ * offsets of the alphabet and source word - from the beginning of the symbols pool.
+ * Version 2: the alphabet is UTF-8 text of interned symbols in the order of their units,
+ * the source word and instructions are units (see Alphabet). */
+struct FileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t fileSize;
+    uint64_t checksum;              /* of everything after the header */
+
+    uint64_t poolOffset, poolSize;
+    uint64_t alphabetOffset, alphabetSize;
+    uint64_t sourceWordOffset, sourceWordSize;
+    uint64_t rulesOffset, rulesCount;
+
+    uint64_t symbolClassesOffset;
+    uint64_t transitionsOffset;
+    uint64_t outputsOffset;
+    uint64_t lengthsOffset;
+    uint32_t classesCount;
+    uint32_t statesCount;
+};
+
+
+uint64_t appendSection(std::string &body, const void *data, std::size_t size) {
+
+    /* Appends @data to @body at aligned position.
+     * Returns offset of the section in the file. */
+
+    while (body.size() % SECTION_ALIGNMENT)
+        body.push_back('\0');
+
+    uint64_t offset = sizeof(FileHeader) + body.size();
+    body.append((const char *)data, size);
+    return offset;
+}
+
+
+bool isInside(uint64_t offset, uint64_t size, uint64_t limit) {
+    return offset <= limit && size <= limit - offset;
+}
+
+}
+
+
+
+RuleSet::RuleSet() :
+    mPool(0), mPoolSize(0), mRules(0), mRulesCount(0),
+    mAlphabet(0), mAlphabetSize(0),
+    mSourceWord(0), mSourceWordSize(0) {}
+
+
+void RuleSet::assign(std::string &pool, std::vector<Rule> &rules,
+                     std::size_t alphabetOffset, std::size_t alphabetSize,
+                     std::size_t sourceWordOffset, std::size_t sourceWordSize) {
+
+    /* Takes the pool of symbols and instructions, described by offsets in it (see RulesLoader),
+     * then builds the matching tables. @pool and @rules are swapped, not copied. */
+
+
+#ifndef NDEBUG
+    assert(alphabetOffset + alphabetSize <= pool.size());
+    assert(sourceWordOffset + sourceWordSize <= pool.size());
+#endif
+
+    mFile.close();
+    mPoolStorage.swap(pool);
+    mRulesStorage.swap(rules);
+
+    mPool = mPoolStorage.data();
+    mPoolSize = mPoolStorage.size();
+    mRules = mRulesStorage.data();
+    mRulesCount = mRulesStorage.size();
+    mAlphabet = mPool + alphabetOffset;
+    mAlphabetSize = alphabetSize;
+    mSourceWord = mPool + sourceWordOffset;
+    mSourceWordSize = sourceWordSize;
+
+    mMatcher.build(*this);
+}
+
+
+void RuleSet::prune(const std::vector<std::size_t> &instructions) {
+
+    /* Excludes @instructions from matching and rebuilds the matching tables.
+     * Instructions keep their numbers, so the trace is not changed. */
+
+
+#ifndef NDEBUG
+    assert(mRules == mRulesStorage.data());
+#endif
+
+    if (instructions.empty())
+        return;
+
+    for (std::size_t i=0; i<instructions.size(); ++i)
+        mRulesStorage[instructions[i]].flags |= PrunedRule;
+
+    mMatcher.build(*this);
+}
+
+
+bool RuleSet::save(const std::string &fileName, std::ostream &log) const {
+
+    /* Writes the rule set together with matching tables to binary file "fileName".
+     * The file is loaded by load() without any parsing. Errors are reported to @log. */
+
+
+    const InstructionsMatcher::Tables &tables = mMatcher.tables();
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    header.version = FILE_FORMAT_VERSION;
+    header.byteOrder = FILE_BYTE_ORDER;
+
+    std::string body;
+    header.rulesOffset = appendSection(body, mRules, mRulesCount * sizeof(Rule));
+    header.rulesCount = mRulesCount;
+
+    header.lengthsOffset = appendSection(body, tables.lengths, tables.instructionsCount * sizeof(uint32_t));
+    header.outputsOffset = appendSection(body, tables.outputs, tables.statesCount * sizeof(uint32_t));
+    header.transitionsOffset = appendSection(body, tables.transitions,
+                                             (std::size_t)tables.statesCount * tables.classesCount * sizeof(uint32_t));
+    header.symbolClassesOffset = appendSection(body, tables.symbolClasses, 256 * sizeof(uint16_t));
+    header.classesCount = tables.classesCount;
+    header.statesCount = tables.statesCount;
+
+    header.poolOffset = appendSection(body, mPool, mPoolSize);
+    header.poolSize = mPoolSize;
+    header.alphabetOffset = mAlphabet - mPool;
+    header.alphabetSize = mAlphabetSize;
+    header.sourceWordOffset = mSourceWord - mPool;
+    header.sourceWordSize = mSourceWordSize;
+
+    header.fileSize = sizeof(header) + body.size();
+    header.checksum = FnvHash::addWords(FnvHash::FIRST, body.data(), body.size());
+
+
+    std::ofstream file(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (! file) {
+        log << "Can't create file \"" << fileName << "\". Process stopped." << std::endl;
+        return false;
+    }
+
+    file.write((const char *)&header, sizeof(header));
+    file.write(body.data(), body.size());
+    file.close();
+
+    if (file.fail()) {
+        log << "ERROR: Can't write file \"" << fileName << "\". Process stopped." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool RuleSet::isCompiledFile(const std::string &fileName) {
+
+    /* Returns true if file "fileName" starts as compiled rule set. */
+
+    std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary);
+    char magic[8];
+    if (! file.read(magic, sizeof(magic)))
+        return false;
+
+    return std::memcmp(magic, FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+
+bool RuleSet::load(const std::string &fileName, std::ostream &log) {
+
+    /* Maps compiled rule set file "fileName" into memory and uses its arrays directly.
+     * Only the structure of the file is checked: version, checksum and bounds of all sections.
+     * Errors are reported to @log. */
+
+
+    if (! mFile.open(fileName)) {
+        log << "Can't open file \"" << fileName << "\". Process stopped." << std::endl;
+        return false;
+    }
+
+    const char *data = mFile.data();
+    const uint64_t size = mFile.size();
+
+    FileHeader header;
+    if (size < sizeof(header)) {
+        log << "ERROR: File \"" << fileName << "\" is not a compiled rule set." << std::endl;
+        mFile.close();
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0
+            || header.byteOrder != FILE_BYTE_ORDER || header.fileSize != size) {
+        log << "ERROR: File \"" << fileName << "\" is not a compiled rule set "
+                  << "or it was compiled on the machine with another byte order." << std::endl;
+        mFile.close();
+        return false;
+    }
+
+    if (header.version != FILE_FORMAT_VERSION) {
+        log << "ERROR: Compiled rule set \"" << fileName << "\" has version " << header.version
+                  << ", but version " << FILE_FORMAT_VERSION << " is expected. Compile it again." << std::endl;
+        mFile.close();
+        return false;
+    }
+
+    if (FnvHash::addWords(FnvHash::FIRST, data + sizeof(header), size - sizeof(header)) != header.checksum) {
+        log << "ERROR: Compiled rule set \"" << fileName << "\" is damaged (checksum mismatch)." << std::endl;
+        mFile.close();
+        return false;
+    }
+
+
+    /* Bounds of all sections. */
+    const uint64_t cells = (uint64_t)header.statesCount * header.classesCount;
+    bool isCorrect =
+            isInside(header.poolOffset, header.poolSize, size)
+            && isInside(header.alphabetOffset, header.alphabetSize, header.poolSize)
+            && isInside(header.sourceWordOffset, header.sourceWordSize, header.poolSize)
+            && header.rulesCount > 0
+            && header.rulesCount <= size / sizeof(Rule)
+            && isInside(header.rulesOffset, header.rulesCount * sizeof(Rule), size)
+            && isInside(header.lengthsOffset, header.rulesCount * sizeof(uint32_t), size)
+            && header.statesCount <= size / sizeof(uint32_t)
+            && isInside(header.outputsOffset, header.statesCount * sizeof(uint32_t), size)
+            && header.classesCount <= 256
+            && cells <= size / sizeof(uint32_t)
+            && isInside(header.transitionsOffset, cells * sizeof(uint32_t), size)
+            && isInside(header.symbolClassesOffset, 256 * sizeof(uint16_t), size)
+            && (header.rulesOffset | header.lengthsOffset | header.outputsOffset
+                | header.transitionsOffset | header.symbolClassesOffset) % SECTION_ALIGNMENT == 0;
+
+    const Rule *rules = isCorrect ? (const Rule *)(data + header.rulesOffset) : 0;
+    for (std::size_t i=0; isCorrect && i<header.rulesCount; ++i) {
+        isCorrect = rules[i].replacebleLength > 0
+                && isInside(rules[i].replacebleOffset, rules[i].replacebleLength, header.poolSize)
+                && isInside(rules[i].replacerOffset, rules[i].replacerLength, header.poolSize)
+                && ((const uint32_t *)(data + header.lengthsOffset))[i] == rules[i].replacebleLength;
+    }
+
+    InstructionsMatcher::Tables tables;
+    if (isCorrect) {
+        tables.classesCount = header.classesCount;
+        tables.statesCount = header.statesCount;
+        tables.instructionsCount = (uint32_t)header.rulesCount;
+        tables.symbolClasses = (const uint16_t *)(data + header.symbolClassesOffset);
+        tables.transitions = (const uint32_t *)(data + header.transitionsOffset);
+        tables.outputs = (const uint32_t *)(data + header.outputsOffset);
+        tables.lengths = (const uint32_t *)(data + header.lengthsOffset);
+        isCorrect = mMatcher.attach(tables);
+    }
+
+    if (! isCorrect) {
+        log << "ERROR: Compiled rule set \"" << fileName << "\" is inconsistent." << std::endl;
+        mFile.close();
+        return false;
+    }
+
+
+    mPoolStorage.clear();
+    mRulesStorage.clear();
+
+    mPool = data + header.poolOffset;
+    mPoolSize = header.poolSize;
+    mRules = rules;
+    mRulesCount = header.rulesCount;
+    mAlphabet = mPool + header.alphabetOffset;
+    mAlphabetSize = header.alphabetSize;
+    mSourceWord = mPool + header.sourceWordOffset;
+    mSourceWordSize = header.sourceWordSize;
+    return true;
+}
+
+
+std::size_t RuleSet::instructionsCount() const {
+    return mRulesCount;
+}
+
+
+const char* RuleSet::replaceble(std::size_t index) const {
+    return mPool + mRules[index].replacebleOffset;
+}
+
+
+std::size_t RuleSet::replacebleLength(std::size_t index) const {
+    return mRules[index].replacebleLength;
+}
+
+
+const char* RuleSet::replacer(std::size_t index) const {
+    return mPool + mRules[index].replacerOffset;
+}
+
+
+std::size_t RuleSet::replacerLength(std::size_t index) const {
+    return mRules[index].replacerLength;
+}
+
+
+bool RuleSet::isFinal(std::size_t index) const {
+    return (mRules[index].flags & FinalRule) != 0;
+}
+
+
+bool RuleSet::isErasing(std::size_t index) const {
+    return (mRules[index].flags & ErasingRule) != 0;
+}
+
+
+bool RuleSet::isPruned(std::size_t index) const {
+    return (mRules[index].flags & PrunedRule) != 0;
+}
+
+
+const char* RuleSet::alphabet() const {
+
+    /* Returns UTF-8 text of the symbols, that restores units of the rule set (see Alphabet::assign()). */
+
+    return mAlphabet;
+}
+
+
+std::size_t RuleSet::alphabetSize() const {
+    return mAlphabetSize;
+}
+
+
+const char* RuleSet::sourceWord() const {
+    return mSourceWord;
+}
+
+
+std::size_t RuleSet::sourceWordSize() const {
+    return mSourceWordSize;
+}
+
+
+const InstructionsMatcher& RuleSet::matcher() const {
+    return mMatcher;
+}
@@ -0,0 +1,85 @@
+#ifndef RULESET_H
+#define RULESET_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <stdint.h>
+
+#include "matcher.h"
+#include "mappedfile.h"
+
+
+/* Compiled rule set: alphabet, source word, instructions and matching tables, stored in flat arrays.
+ * Source word and instructions are stored by units of the alphabet: one byte per symbol.
+ * It is either assigned by the loader of text file, or mapped from binary file as is -
+ * in both cases execution reads the same arrays, without parsing and per-instruction allocations. */
+class RuleSet {
+public:
+    enum RuleFlags {
+        FinalRule   = 1,    /* "->." */
+        ErasingRule = 2,    /* replacer is "!" */
+        PrunedRule  = 4     /* can never be executed, is not matched (see RulesAnalyzer) */
+    };
+
+    struct Rule {
+        uint64_t replacebleOffset;      /* offsets in the symbols pool */
+        uint64_t replacerOffset;
+        uint32_t replacebleLength;
+        uint32_t replacerLength;
+        uint32_t flags;
+        uint32_t reserved;
+    };
+
+    RuleSet();
+
+    void assign(std::string &pool, std::vector<Rule> &rules,
+                std::size_t alphabetOffset, std::size_t alphabetSize,
+                std::size_t sourceWordOffset, std::size_t sourceWordSize);
+    void prune(const std::vector<std::size_t> &instructions);
+    bool save(const std::string &fileName, std::ostream &log) const;
+    bool load(const std::string &fileName, std::ostream &log);
+    static bool isCompiledFile(const std::string &fileName);
+
+    std::size_t instructionsCount() const;
+    const char* replaceble(std::size_t index) const;
+    std::size_t replacebleLength(std::size_t index) const;
+    const char* replacer(std::size_t index) const;
+    std::size_t replacerLength(std::size_t index) const;
+    bool isFinal(std::size_t index) const;
+    bool isErasing(std::size_t index) const;
+    bool isPruned(std::size_t index) const;
+
+    const char* alphabet() const;
+    std::size_t alphabetSize() const;
+    const char* sourceWord() const;
+    std::size_t sourceWordSize() const;
+
+    const InstructionsMatcher& matcher() const;
+
+private:
+    RuleSet(const RuleSet &);
+    RuleSet& operator=(const RuleSet &);
+
+private:
+    const char *mPool;
+    std::size_t mPoolSize;
+    const Rule *mRules;
+    std::size_t mRulesCount;
+    const char *mAlphabet;
+    std::size_t mAlphabetSize;
+    const char *mSourceWord;
+    std::size_t mSourceWordSize;
+
+    InstructionsMatcher mMatcher;
+
+    /* Storage of compiled rule set. */
+    std::string mPoolStorage;
+    std::vector<Rule> mRulesStorage;
+
+    /* Storage of loaded rule set. */
+    MappedFile mFile;
+};
+
+
+#endif // RULESET_H
@@ -0,0 +1,132 @@
+#include "rulesetcache.h"
+#include "rollinghash.h"
+
+#include <cstring>
+
+
+RuleSetCache::RuleSetCache(std::size_t capacity) :
+    mCapacity(capacity ? capacity : 1), mHits(0), mMisses(0), mEvictions(0) {}
+
+
+RuleSetCache::Algorithm RuleSetCache::acquire(const char *text, std::size_t size, std::string &errors) {
+
+    /* Returns the algorithm of @size bytes of @text, loading it on a miss.
+     * Text is parsed without the lock, so a miss does not stop requests for other algorithms.
+     * Returns null and the messages of the loader in @errors if the text contains errors;
+     * such texts are not cached. */
+
+    const uint64_t textHash = hash(text, size);
+
+    Algorithm algorithm = find(textHash, text, size);
+    if (algorithm)
+        return algorithm;
+
+    std::shared_ptr<MarkovAlgorithm> loaded = std::make_shared<MarkovAlgorithm>();
+    if (! loaded->parse(text, size, 1)) {
+        errors = loaded->messages();
+        return Algorithm();
+    }
+
+    return insert(textHash, text, size, loaded);
+}
+
+
+std::size_t RuleSetCache::capacity() const {
+    return mCapacity;
+}
+
+
+std::size_t RuleSetCache::size() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEntries.size();
+}
+
+
+uint64_t RuleSetCache::hits() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHits;
+}
+
+
+uint64_t RuleSetCache::misses() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMisses;
+}
+
+
+uint64_t RuleSetCache::evictions() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEvictions;
+}
+
+
+uint64_t RuleSetCache::hash(const char *text, std::size_t size) {
+
+    /* Returns hash of @size bytes of @text (see RollingHash). */
+
+    uint64_t result = 0;
+    uint64_t power = 1;
+    for (std::size_t i=0; i<size; ++i) {
+        result += RollingHash::value(text[i]) * power;
+        power *= RollingHash::BASE;
+    }
+    return result;
+}
+
+
+RuleSetCache::Algorithm RuleSetCache::find(uint64_t hash, const char *text, std::size_t size) {
+
+    /* Returns cached algorithm of the text and makes it the most recently used,
+     * or null if it is not cached. */
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::unordered_map<uint64_t, Entries::iterator>::iterator it = mIndex.find(hash);
+    if (it == mIndex.end() || it->second->text.size() != size ||
+            std::memcmp(it->second->text.data(), text, size) != 0) {
+        ++mMisses;
+        return Algorithm();
+    }
+
+    ++mHits;
+    mEntries.splice(mEntries.begin(), mEntries, it->second);
+    return it->second->algorithm;
+}
+
+
+RuleSetCache::Algorithm RuleSetCache::insert(uint64_t hash, const char *text, std::size_t size,
+                                             const Algorithm &algorithm) {
+
+    /* Adds loaded @algorithm as the most recently used and evicts the least recently used ones
+     * over the capacity. If the same text was loaded by another thread meanwhile, its algorithm is kept
+     * and returned, so the workers share one copy. Entry with the same hash and other text is replaced. */
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::unordered_map<uint64_t, Entries::iterator>::iterator it = mIndex.find(hash);
+    if (it != mIndex.end()) {
+        Entries::iterator entry = it->second;
+        if (entry->text.size() == size && std::memcmp(entry->text.data(), text, size) == 0) {
+            mEntries.splice(mEntries.begin(), mEntries, entry);
+            return entry->algorithm;
+        }
+
+        mEntries.erase(entry);
+        mIndex.erase(it);
+    }
+
+    Entry entry;
+    entry.hash = hash;
+    entry.text.assign(text, size);
+    entry.algorithm = algorithm;
+    mEntries.push_front(entry);
+    mIndex[hash] = mEntries.begin();
+
+    while (mEntries.size() > mCapacity) {
+        mIndex.erase(mEntries.back().hash);
+        mEntries.pop_back();
+        ++mEvictions;
+    }
+
+    return algorithm;
+}
@@ -0,0 +1,61 @@
+#ifndef RULESETCACHE_H
+#define RULESETCACHE_H
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+
+#include "libmna.h"
+
+
+/* Loaded algorithms, keyed by the hash of their text, with eviction of the least recently used.
+ * The text is kept with the algorithm and compared on every hit, so a collision of hashes
+ * is a miss, not a wrong algorithm. Evicted algorithms live while requests use them.
+ * All methods may be called from any thread. */
+class RuleSetCache {
+public:
+    typedef std::shared_ptr<const MarkovAlgorithm> Algorithm;
+
+    explicit RuleSetCache(std::size_t capacity);
+
+    Algorithm acquire(const char *text, std::size_t size, std::string &errors);
+
+    std::size_t capacity() const;
+    std::size_t size() const;
+    uint64_t hits() const;
+    uint64_t misses() const;
+    uint64_t evictions() const;
+
+    static uint64_t hash(const char *text, std::size_t size);
+
+private:
+    RuleSetCache(const RuleSetCache &);
+    RuleSetCache& operator=(const RuleSetCache &);
+
+    struct Entry {
+        uint64_t hash;
+        std::string text;
+        Algorithm algorithm;
+    };
+
+    typedef std::list<Entry> Entries;
+
+    Algorithm find(uint64_t hash, const char *text, std::size_t size);
+    Algorithm insert(uint64_t hash, const char *text, std::size_t size, const Algorithm &algorithm);
+
+private:
+    const std::size_t mCapacity;
+    Entries mEntries;                                       /* the most recently used first */
+    std::unordered_map<uint64_t, Entries::iterator> mIndex; /* hash -> entry */
+
+    mutable std::mutex mMutex;
+    uint64_t mHits;
+    uint64_t mMisses;
+    uint64_t mEvictions;
+};
+
+
+#endif // RULESETCACHE_H
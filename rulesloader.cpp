@@ -0,0 +1,678 @@
+#include "rulesloader.h"
+#include "alphabet.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include <assert.h>
+
+
+#define MIN_CHUNK_SIZE    (256 * 1024)
+#define CHUNKS_PER_THREAD 4
+
+
+static const char* skipBlanks(const char *pos, const char *end) {
+
+    /* Returns the first symbol from @pos, that is not space or tab. */
+
+    while (pos < end && (*pos == ' ' || *pos == '\t'))
+        ++pos;
+    return pos;
+}
+
+
+RulesLoader::RulesLoader(Alphabet &alphabet, std::ostream &log) :
+    mAlphabet(alphabet), mLog(log), mNext(0), mEnd(0) {
+
+    mLine.begin = mLine.end = 0;
+    mLine.number = 0;
+}
+
+
+bool RulesLoader::load(const std::string &fileName, RuleSet &rules, std::size_t threadsCount) {
+
+    /* Loads file "fileName" into @rules, errors and warnings are written to the log.
+     * Instructions are parsed by @threadsCount threads (0 - by the number of processors). */
+
+
+#ifndef NDEBUG
+    assert(! fileName.empty());
+#endif
+
+    if (! mFile.open(fileName)) {
+        mLog << "Can't open file \"" << fileName << "\". Process stopped." << std::endl;
+        return false;
+    }
+
+    const bool isLoaded = parse(mFile.data(), mFile.size(), rules, threadsCount);
+    mFile.close();
+    return isLoaded;
+}
+
+
+bool RulesLoader::parse(const char *text, std::size_t size, RuleSet &rules, std::size_t threadsCount) {
+
+    /* Loads @size bytes of @text in the format of the file into @rules.
+     * Rules do not refer to @text after loading. */
+
+    mNext = text;
+    mEnd = text + size;
+    mLine.number = 0;
+    mDeferredPool.clear();
+    mDeferredRules.clear();
+
+    if (! loadAlphabet())
+        return false;
+
+    std::string sourceWord;
+    if (! loadSourceWord(sourceWord))
+        return false;
+
+    std::string pool;
+    std::vector<RuleSet::Rule> rulesList;
+    if (! loadInstructions(pool, rulesList, threadsCount))
+        return false;
+
+    /* Symbols of instructions may be interned while loading, so the alphabet is stored the last. */
+    const std::size_t sourceWordOffset = pool.size();
+    pool += sourceWord;
+    const std::size_t alphabetOffset = pool.size();
+    pool += mAlphabet.symbols();
+
+    rules.assign(pool, rulesList, alphabetOffset, pool.size() - alphabetOffset,
+                 sourceWordOffset, sourceWord.size());
+    return true;
+}
+
+
+bool RulesLoader::nextLine(const char *&next, const char *end, Line &line) {
+
+    /* Reads the line, that starts at @next, and moves @next to the beginning of the next line.
+     * Returns false at the end of the text. */
+
+    if (next >= end)
+        return false;
+
+    const char *newLine = (const char *)std::memchr(next, '\n', end - next);
+    line.begin = next;
+    line.end = newLine ? newLine : end;
+    ++line.number;
+
+    next = newLine ? newLine + 1 : end;
+    return true;
+}
+
+
+bool RulesLoader::nextInformativeLine(const char *&next, const char *end, Line &line, const char *&pos) {
+
+    /* Skips empty and commented lines and lines of spaces and tabs.
+     * @pos is set to the first informative symbol of the line. Returns false at the end of the text. */
+
+    while (nextLine(next, end, line)) {
+        if (line.begin == line.end)
+            continue;
+
+        /* Ignore commented string. */
+        if (line.end - line.begin >= 2 && line.begin[0] == '/' && line.begin[1] == '/')
+            continue;
+
+        /* Line of uninformative symbols. */
+        pos = skipBlanks(line.begin, line.end);
+        if (pos < line.end)
+            return true;
+    }
+
+    return false;
+}
+
+
+bool RulesLoader::loadAlphabet() {
+
+    /* Reads the first informative line as alphabet definition: T={a, b, ...}.
+     * Symbols can be separated by commas; "\," and "\\" define comma and backslash. */
+
+    bool fileContainsErrors = false;
+    const char *pos = 0;
+
+    while (nextInformativeLine(mNext, mEnd, mLine, pos)) {
+
+        /* Check if it is "T" or "t", that defines start of alphabet's enum. */
+        if (*pos != 't' && *pos != 'T') {
+            mLog << "[" << mLine.number << "; " << pos - mLine.begin << "] "
+                 << "Syntax error: invalid symbol detected. "
+                 << "\"T\" or \"t\" is expected as an symbol, that defines alphabet's enum."
+                 << std::endl;
+            fileContainsErrors = true;
+            break;
+        }
+
+        pos = skipBlanks(pos + 1, mLine.end);
+        if (pos >= mLine.end) {
+            mLog << "[" << mLine.number << "; " << pos - mLine.begin << "] "
+                 << "Syntax error: unexpected end of line. \"=\" is expected."
+                 << std::endl;
+            fileContainsErrors = true;
+            break;
+        }
+
+        if (*pos != '=') {
+            mLog << "[" << mLine.number << "; " << pos - mLine.begin << "] "
+                 << "Syntax error: invalid symbol detected. \"=\" is expected."
+                 << std::endl;
+            fileContainsErrors = true;
+            break;
+        }
+
+        pos = skipBlanks(pos + 1, mLine.end);
+        if (pos >= mLine.end) {
+            mLog << "[" << mLine.number << "; " << pos - mLine.begin << "] "
+                 << "Syntax error: unexpected end of line, that defines alphabet. "
+                 << "\"{\" is expected."
+                 << std::endl;
+            fileContainsErrors = true;
+            break;
+        }
+
+        if (*pos != '{') {
+            mLog << "[" << mLine.number << "; " << pos - mLine.begin << "] "
+                 << "Syntax error: invalid symbol detected. \"{\" is expected. "
+                 << std::endl;
+            return false;
+        }
+
+        ++pos;
+        if (pos + 1 >= mLine.end) {
+            mLog << "[" << mLine.number << "; " << pos - mLine.begin << "] "
+                 << "Syntax error: unexpected end of line. Symbol of the alphabet is expected. "
+                 << std::endl;
+            fileContainsErrors = true;
+            break;
+        }
+
+        for (; pos < mLine.end && *pos != '}'; ++pos) {
+
+            /* Comma and tab are separators. */
+            if (*pos == ',' || *pos == '\t')
+                continue;
+
+            /* Overrided comma or backslash takes two symbols of the line. */
+            if (*pos == '\\') {
+                if (pos + 1 < mLine.end && (pos[1] == ',' || pos[1] == '\\')) {
+                    if (! mAlphabet.addSymbol(pos[1]))
+                        mLog << "[" << mLine.number << "; " << pos - mLine.begin << "] "
+                             << "Warning: symbol \"" << pos[1] << "\" is duplicated. "
+                             << std::endl;
+                    ++pos;
+                }
+                continue;
+            }
+
+            /* Symbol can take several bytes of UTF-8. */
+            const std::size_t length = Alphabet::symbolLength(pos, mLine.end - pos);
+            if (mAlphabet.isSymbolPresent(pos, length)) {
+                mLog << "[" << mLine.number << "; " << pos - mLine.begin << "] "
+                     << "Warning: symbol \"" << std::string(pos, length) << "\" is duplicated. "
+                     << std::endl;
+            }
+            else if (! mAlphabet.addSymbol(pos, length)) {
+                mLog << "[" << mLine.number << "; " << pos - mLine.begin << "] "
+                     << "ERROR: too many non-ASCII symbols, at most " << Alphabet::MAX_WIDE_SYMBOLS
+                     << " are supported. "
+                     << std::endl;
+                fileContainsErrors = true;
+                break;
+            }
+
+            pos += length - 1;
+        }
+
+        break;
+    }
+
+
+    if (fileContainsErrors) {
+        mLog << "Alphabet was not loaded since errors occured. "
+             << std::endl;
+        return false;
+    }
+
+    /* Algorithm can't work without alphabet. */
+    if (mAlphabet.symbolsCount() == 0) {
+        mLog << "Alphabet was not loaded. "
+             << "It is possible that current file does not contains alphabet definition at all. "
+             << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool RulesLoader::loadSourceWord(std::string &sourceWord) {
+
+    /* Reads the next informative line as source word definition: V=word.
+     * Symbols, that are absent in the alphabet, are loaded with warning. */
+
+    /* Add system symbols to the alphabet. */
+    mAlphabet.addSymbol('!');
+    mAlphabet.addSymbol('@');
+
+    bool fileContainsErrors = false;
+    const char *pos = 0;
+
+    while (nextInformativeLine(mNext, mEnd, mLine, pos)) {
+
+        /* Check if it is "V" or "v", that defines start of source word. */
+        if (*pos != 'v' && *pos != 'V') {
+            mLog << "[" << mLine.number << "; " << pos - mLine.begin << "] "
+                 << "Syntax error: invalid symbol detected. "
+                 << "\"V\" or \"v\" is expected as an symbol, that defines beginnning of the source word."
+                 << std::endl;
+            fileContainsErrors = true;
+            break;
+        }
+
+        pos = skipBlanks(pos + 1, mLine.end);
+        if (pos >= mLine.end) {
+            mLog << "[" << mLine.number << "; " << pos - mLine.begin << "] "
+                 << "Syntax error: unexpected end of line. \"=\" is expected."
+                 << std::endl;
+            fileContainsErrors = true;
+            break;
+        }
+
+        if (*pos != '=') {
+            mLog << "[" << mLine.number << "; " << pos - mLine.begin << "] "
+                 << "Syntax error: invalid symbol detected. \"=\" is expected."
+                 << std::endl;
+            fileContainsErrors = true;
+            break;
+        }
+
+        pos = skipBlanks(pos + 1, mLine.end);
+        if (pos >= mLine.end) {
+            mLog << "[" << mLine.number << "; " << pos - mLine.begin << "] "
+                 << "Syntax error: unexpected end of line, that defines source word. "
+                 << std::endl;
+            fileContainsErrors = true;
+            break;
+        }
+
+        for (; pos < mLine.end; ++pos) {
+
+            /* Ignore commented end of line */
+            if (*pos == '/' && pos + 1 < mLine.end && pos[1] == '/')
+                break;
+
+            if (*pos == '\t')
+                continue;
+
+            const std::size_t length = Alphabet::symbolLength(pos, mLine.end - pos);
+            if (! mAlphabet.isSymbolPresent(pos, length)) {
+                mLog << "[" << mLine.number << "; " << pos - mLine.begin << "] "
+                     << "WARNING: detected symbol \"" << std::string(pos, length)
+                     << "\" is absent in the loaded alphabet. "
+                     << std::endl;
+            }
+
+            if (! appendSymbol(mLine, pos, sourceWord)) {
+                fileContainsErrors = true;
+                break;
+            }
+        }
+
+        break;
+    }
+
+
+    if (fileContainsErrors) {
+        mLog << "Source word was not loaded since errors occured. "
+             << std::endl;
+        return false;
+    }
+
+    if (sourceWord.empty()) {
+        mLog << "Warning: source word is empty. "
+             << std::endl;
+    }
+
+    return true;
+}
+
+
+bool RulesLoader::loadInstructions(std::string &pool, std::vector<RuleSet::Rule> &rules, std::size_t threadsCount) {
+
+    /* Parses the rest of the file - one instruction per informative line - into @pool and @rules.
+     * Big sections are split into chunks at line boundaries, that are parsed in parallel. */
+
+
+    const std::size_t size = mEnd - mNext;
+
+    std::size_t workersCount = threadsCount ? threadsCount : std::thread::hardware_concurrency();
+    std::size_t chunksCount = 1;
+    if (workersCount > 1)
+        chunksCount = std::max((std::size_t)1, std::min(workersCount * CHUNKS_PER_THREAD, size / MIN_CHUNK_SIZE));
+
+    std::vector<Chunk> chunks(chunksCount);
+    const char *begin = mNext;
+    for (std::size_t i=0; i<chunksCount; ++i) {
+        Chunk &chunk = chunks[i];
+        chunk.begin = begin;
+        chunk.end = mEnd;
+
+        if (i + 1 < chunksCount) {
+            const char *target = std::max(begin, mNext + size / chunksCount * (i + 1));
+            const char *newLine = (const char *)std::memchr(target, '\n', mEnd - target);
+            if (newLine)
+                chunk.end = newLine + 1;
+        }
+
+        begin = chunk.end;
+    }
+
+    if (chunksCount == 1)
+        parseChunk(chunks[0]);
+    else {
+        ThreadPool threads(threadsCount);
+        for (std::size_t i=0; i<chunksCount; ++i) {
+            Chunk *chunk = &chunks[i];
+            threads.submit([this, chunk](std::size_t) { parseChunk(*chunk); });
+        }
+        threads.wait();
+    }
+
+
+    /* Chunks are joined in the order of the file. */
+    bool fileContainsErrors = false;
+    std::size_t firstLine = mLine.number;
+    for (std::size_t i=0; i<chunksCount; ++i) {
+        const bool isStopped = ! joinChunk(chunks[i], firstLine, pool, rules);
+        fileContainsErrors = fileContainsErrors || chunks[i].hasErrors || isStopped;
+        if (isStopped)
+            break;
+
+        firstLine += chunks[i].linesCount;
+    }
+
+    const std::size_t deferredOffset = pool.size();
+    pool += mDeferredPool;
+    for (std::size_t i=0; i<mDeferredRules.size(); ++i) {
+        rules[mDeferredRules[i]].replacebleOffset += deferredOffset;
+        rules[mDeferredRules[i]].replacerOffset += deferredOffset;
+    }
+
+    if (fileContainsErrors) {
+        mLog << "Errors occured while instructions loading. "
+             << std::endl;
+        return false;
+    }
+
+    if (rules.empty()) {
+        mLog << "No one instruction was loaded. Nothing to execute."
+             << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+void RulesLoader::parseChunk(Chunk &chunk) const {
+
+    /* Parses instructions of @chunk. Called by several threads at once:
+     * the alphabet is only read, results and diagnostics are kept in @chunk. */
+
+    chunk.hasErrors = false;
+    chunk.isStopped = false;
+
+    const char *next = chunk.begin;
+    const char *pos = 0;
+    Line line;
+    line.number = 0;
+
+    while (nextInformativeLine(next, chunk.end, line, pos)) {
+        if (! parseInstruction(chunk, line, pos)) {
+            chunk.isStopped = true;
+            break;
+        }
+    }
+
+    chunk.linesCount = line.number;
+}
+
+
+bool RulesLoader::parseInstruction(Chunk &chunk, const Line &line, const char *pos) const {
+
+    /* Parses instruction "replaceble->replacer" or "replaceble->.replacer" from @pos of @line.
+     * Replacer ends at ";" or "//". Returns false on syntax error, that stops loading. */
+
+    const std::size_t replacebleOffset = chunk.pool.size();
+    const char *replacebleBegin = pos, *replacebleEnd = line.end;
+    std::size_t replacebleSymbols = 0;
+    bool isFinal = false, isDeferred = false;
+
+    for (; pos < line.end; ++pos) {
+        if (*pos == '-' && pos + 2 < line.end && pos[1] == '>' && pos[2] == '.') {
+            replacebleEnd = pos;
+            pos += 3;
+            isFinal = true;
+            break;
+        }
+
+        if (*pos == '-' && pos + 1 < line.end && pos[1] == '>') {
+            replacebleEnd = pos;
+            pos += 2;
+            break;
+        }
+
+        if (*pos == '\t')
+            continue;
+
+        const std::size_t length = Alphabet::symbolLength(pos, line.end - pos);
+        if (! mAlphabet.isSymbolPresent(pos, length)) {
+            Message message = {AbsentSymbolMessage, line.number, (std::size_t)(pos - line.begin),
+                               std::string(pos, length)};
+            chunk.messages.push_back(message);
+        }
+
+        appendUnit(pos, length, chunk.pool, isDeferred);
+        ++replacebleSymbols;
+        pos += length - 1;
+    }
+
+    if (pos >= line.end) {
+        Message message = {EndOfLineMessage, line.number, (std::size_t)(pos - line.begin), std::string()};
+        chunk.messages.push_back(message);
+        chunk.pool.resize(replacebleOffset);
+        return false;
+    }
+
+    const std::size_t replacerOffset = chunk.pool.size();
+    const char *replacerBegin = pos;
+    for (; pos < line.end; ++pos) {
+        if (*pos == ';')
+            break;
+        if (*pos == '/' && pos + 1 < line.end && pos[1] == '/')
+            break;
+        if (*pos == '\t')
+            continue;
+
+        const std::size_t length = Alphabet::symbolLength(pos, line.end - pos);
+        appendUnit(pos, length, chunk.pool, isDeferred);
+        pos += length - 1;
+    }
+
+    if (replacebleSymbols == 0) {
+        Message message = {InvalidInstructionMessage, line.number, 0, std::string()};
+        chunk.messages.push_back(message);
+        chunk.hasErrors = true;
+        chunk.pool.resize(replacebleOffset);
+        return true;
+    }
+
+    RuleSet::Rule rule;
+    std::memset(&rule, 0, sizeof(rule));
+    rule.flags = isFinal ? RuleSet::FinalRule : 0;
+
+    if (isDeferred) {
+        DeferredRule deferred = {chunk.rules.size(), line.number, line,
+                                 replacebleBegin, replacebleEnd, replacerBegin, pos};
+        chunk.deferredRules.push_back(deferred);
+        chunk.pool.resize(replacebleOffset);
+    }
+    else {
+        rule.replacebleOffset = replacebleOffset;
+        rule.replacebleLength = (uint32_t)(replacerOffset - replacebleOffset);
+        rule.replacerOffset = replacerOffset;
+        rule.replacerLength = (uint32_t)(chunk.pool.size() - replacerOffset);
+        if (rule.replacerLength == 1 && chunk.pool[replacerOffset] == '!')
+            rule.flags |= RuleSet::ErasingRule;
+    }
+
+    chunk.rules.push_back(rule);
+    return true;
+}
+
+
+void RulesLoader::appendUnit(const char *symbol, std::size_t length, std::string &units, bool &isDeferred) const {
+
+    /* Appends the unit of the symbol to @units without changing the alphabet.
+     * If the symbol was never interned, sets @isDeferred: the instruction is encoded later. */
+
+    char unit = 0;
+    if (length == 1 && (unsigned char)*symbol < 0x80)
+        units.push_back(*symbol);
+    else if (mAlphabet.findUnit(symbol, length, unit))
+        units.push_back(unit);
+    else
+        isDeferred = true;
+}
+
+
+bool RulesLoader::joinChunk(const Chunk &chunk, std::size_t firstLine,
+                            std::string &pool, std::vector<RuleSet::Rule> &rules) {
+
+    /* Appends rules of @chunk, which first line follows line @firstLine of the file,
+     * to @pool and @rules, and prints its diagnostics. Deferred rules are encoded here -
+     * new symbols are interned in the order of the file.
+     * Returns false if loading must be stopped. */
+
+    const std::size_t poolOffset = pool.size();
+    const std::size_t firstRule = rules.size();
+    pool += chunk.pool;
+
+    for (std::size_t i=0; i<chunk.rules.size(); ++i) {
+        RuleSet::Rule rule = chunk.rules[i];
+        rule.replacebleOffset += poolOffset;
+        rule.replacerOffset += poolOffset;
+        rules.push_back(rule);
+    }
+
+    std::size_t deferred = 0;
+    for (std::size_t i=0; i<chunk.messages.size(); ++i) {
+        const Message &message = chunk.messages[i];
+        for (; deferred < chunk.deferredRules.size() && chunk.deferredRules[deferred].line < message.line; ++deferred) {
+            const DeferredRule &rule = chunk.deferredRules[deferred];
+            if (! encodeRule(rule, firstLine, rules[firstRule + rule.rule]))
+                return false;
+            mDeferredRules.push_back(firstRule + rule.rule);
+        }
+
+        printMessage(message, firstLine);
+    }
+
+    for (; deferred < chunk.deferredRules.size(); ++deferred) {
+        const DeferredRule &rule = chunk.deferredRules[deferred];
+        if (! encodeRule(rule, firstLine, rules[firstRule + rule.rule]))
+            return false;
+        mDeferredRules.push_back(firstRule + rule.rule);
+    }
+
+    return ! chunk.isStopped;
+}
+
+
+bool RulesLoader::encodeRule(const DeferredRule &deferred, std::size_t firstLine, RuleSet::Rule &rule) {
+
+    /* Interns symbols of the deferred instruction and appends its units to the deferred pool.
+     * Offsets of @rule are counted from the beginning of the deferred pool. */
+
+    Line line = deferred.source;
+    line.number += firstLine;
+
+    rule.replacebleOffset = mDeferredPool.size();
+    if (! appendSymbols(line, deferred.replacebleBegin, deferred.replacebleEnd, mDeferredPool))
+        return false;
+    rule.replacebleLength = (uint32_t)(mDeferredPool.size() - rule.replacebleOffset);
+
+    rule.replacerOffset = mDeferredPool.size();
+    if (! appendSymbols(line, deferred.replacerBegin, deferred.replacerEnd, mDeferredPool))
+        return false;
+    rule.replacerLength = (uint32_t)(mDeferredPool.size() - rule.replacerOffset);
+
+    if (rule.replacerLength == 1 && mDeferredPool[rule.replacerOffset] == '!')
+        rule.flags |= RuleSet::ErasingRule;
+
+    return true;
+}
+
+
+bool RulesLoader::appendSymbol(const Line &line, const char *&pos, std::string &units) {
+
+    /* Appends the unit of the symbol at @pos to @units, interning the symbol if it is new,
+     * and moves @pos to the last byte of the symbol.
+     * Returns false if there is no free unit for the symbol. */
+
+    const std::size_t length = Alphabet::symbolLength(pos, line.end - pos);
+
+    char unit = 0;
+    if (! mAlphabet.encode(pos, length, unit)) {
+        mLog << "[" << line.number << "; " << pos - line.begin << "] "
+             << "ERROR: too many non-ASCII symbols, at most " << Alphabet::MAX_WIDE_SYMBOLS
+             << " are supported. "
+             << std::endl;
+        return false;
+    }
+
+    units.push_back(unit);
+    pos += length - 1;
+    return true;
+}
+
+
+bool RulesLoader::appendSymbols(const Line &line, const char *begin, const char *end, std::string &units) {
+
+    /* Appends units of all symbols from @begin to @end of @line, except tabs. */
+
+    for (const char *pos=begin; pos<end; ++pos) {
+        if (*pos != '\t' && ! appendSymbol(line, pos, units))
+            return false;
+    }
+
+    return true;
+}
+
+
+void RulesLoader::printMessage(const Message &message, std::size_t firstLine) {
+
+    /* Prints diagnostic of a chunk, which first line follows line @firstLine of the file. */
+
+    switch (message.kind) {
+    case AbsentSymbolMessage:
+        mLog << "[" << firstLine + message.line << "; " << message.pos << "] "
+             << "WARNING: detected symbol \"" << message.symbol << "\" is absent in the loaded alphabet. "
+             << std::endl;
+        break;
+    case EndOfLineMessage:
+        mLog << "[" << firstLine + message.line << "; " << message.pos << "] "
+             << "Syntax error: unexpected end of line, that defines instruction. "
+             << std::endl;
+        break;
+    case InvalidInstructionMessage:
+        mLog << "ERROR: Instruction at line " << firstLine + message.line << " is invalid. "
+             << std::endl;
+        break;
+    }
+}
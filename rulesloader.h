@@ -0,0 +1,108 @@
+#ifndef RULESLOADER_H
+#define RULESLOADER_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "ruleset.h"
+#include "mappedfile.h"
+
+
+class Alphabet;
+
+
+/* Loads text of the algorithm: alphabet, source word and instructions - from file or from memory.
+ * The file is mapped into memory and read once by pointers, lines are never copied.
+ * Alphabet and source word are read first, then the instructions are split into chunks
+ * at line boundaries and parsed in parallel; chunks are joined in the order of the file,
+ * so the order of instructions and diagnostics (with line and column numbers) are the same
+ * as if the file was parsed line by line. */
+class RulesLoader {
+public:
+    RulesLoader(Alphabet &alphabet, std::ostream &log);
+
+    bool load(const std::string &fileName, RuleSet &rules, std::size_t threadsCount = 0);
+    bool parse(const char *text, std::size_t size, RuleSet &rules, std::size_t threadsCount = 0);
+
+private:
+    RulesLoader(const RulesLoader &);
+    RulesLoader& operator=(const RulesLoader &);
+
+    /* Line of the mapped file, without "\n". */
+    struct Line {
+        const char *begin;
+        const char *end;
+        std::size_t number;
+    };
+
+    enum MessageKind {
+        AbsentSymbolMessage,        /* symbol is absent in the loaded alphabet */
+        EndOfLineMessage,           /* instruction has no "->" */
+        InvalidInstructionMessage   /* replaceble part is empty */
+    };
+
+    /* Diagnostic of a chunk; line is counted from the beginning of the chunk. */
+    struct Message {
+        MessageKind kind;
+        std::size_t line;
+        std::size_t pos;
+        std::string symbol;
+    };
+
+    /* Instruction with symbols, that are not interned yet: its units are found
+     * after all chunks are parsed, in the order of the file. */
+    struct DeferredRule {
+        std::size_t rule;
+        std::size_t line;
+        Line source;
+        const char *replacebleBegin, *replacebleEnd;
+        const char *replacerBegin, *replacerEnd;
+    };
+
+    /* Part of the instructions section and results of its parsing.
+     * Offsets of the rules are counted from the beginning of the chunk pool. */
+    struct Chunk {
+        const char *begin;
+        const char *end;
+        std::size_t linesCount;
+        std::string pool;
+        std::vector<RuleSet::Rule> rules;
+        std::vector<Message> messages;
+        std::vector<DeferredRule> deferredRules;
+        bool hasErrors;
+        bool isStopped;             /* syntax error, that stops loading */
+    };
+
+    static bool nextLine(const char *&next, const char *end, Line &line);
+    static bool nextInformativeLine(const char *&next, const char *end, Line &line, const char *&pos);
+    bool loadAlphabet();
+    bool loadSourceWord(std::string &sourceWord);
+    bool loadInstructions(std::string &pool, std::vector<RuleSet::Rule> &rules, std::size_t threadsCount);
+
+    void parseChunk(Chunk &chunk) const;
+    bool parseInstruction(Chunk &chunk, const Line &line, const char *pos) const;
+    void appendUnit(const char *symbol, std::size_t length, std::string &units, bool &isDeferred) const;
+    bool joinChunk(const Chunk &chunk, std::size_t firstLine, std::string &pool, std::vector<RuleSet::Rule> &rules);
+    bool encodeRule(const DeferredRule &deferred, std::size_t firstLine, RuleSet::Rule &rule);
+    bool appendSymbol(const Line &line, const char *&pos, std::string &units);
+    bool appendSymbols(const Line &line, const char *begin, const char *end, std::string &units);
+    void printMessage(const Message &message, std::size_t firstLine);
+
+private:
+    Alphabet &mAlphabet;
+    std::ostream &mLog;
+
+    MappedFile mFile;
+    const char *mNext;              /* beginning of the next line */
+    const char *mEnd;
+    Line mLine;                     /* the last read line */
+
+    /* Units of deferred instructions are stored after all chunks,
+     * so the pool does not depend on the number of chunks. */
+    std::string mDeferredPool;
+    std::vector<std::size_t> mDeferredRules;
+};
+
+
+#endif // RULESLOADER_H
@@ -0,0 +1,573 @@
+#include "server.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <sstream>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+#define MAX_HEADER_SIZE  1024
+#define READ_CHUNK_SIZE  65536
+
+/* Responses, that a socket client has not read yet; the connection of the client, that does not read
+ * them, is closed, when the next response comes over this size. */
+#define MAX_OUTPUT_BACKLOG  (16 * 1024 * 1024)
+
+
+const std::size_t Server::LATENCY_BUCKETS;
+
+
+/* Set by SIGINT and SIGTERM, so listen() closes the socket before exit. */
+static volatile std::sig_atomic_t isStopRequested = 0;
+
+
+static void requestStop(int) {
+    isStopRequested = 1;
+}
+
+
+static bool parseSize(const std::string &text, std::size_t &size) {
+
+    /* Reads decimal @size from the whole @text. */
+
+    if (text.empty() || text[0] < '0' || text[0] > '9')
+        return false;
+
+    char *end = 0;
+    errno = 0;
+    unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+    if (*end || errno == ERANGE || value > (unsigned long long)(std::size_t)-1)
+        return false;
+
+    size = (std::size_t)value;
+    return true;
+}
+
+
+static bool setNonBlocking(int descriptor) {
+    const int flags = fcntl(descriptor, F_GETFL, 0);
+    return flags >= 0 && fcntl(descriptor, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+
+/* Input and output of one client. Descriptors of the socket are closed, when the last request
+ * of the connection is answered; standard input and output are not closed.
+ * Standard output is written by the workers; the socket is non-blocking, responses are queued
+ * and written by the thread of poll(), so a client, that does not read, does not stall the workers. */
+struct Server::Connection {
+    Connection(int input, int output, bool isOwner) :
+        input(input), output(output), isOwner(isOwner), offset(0), isMalformed(false), isInputOver(false),
+        isBroken(false) {}
+
+    ~Connection() {
+        if (isOwner)
+            ::close(input);
+    }
+
+    int input;
+    int output;
+    bool isOwner;
+
+    std::string buffer;             /* read, but not taken bytes (from offset) */
+    std::size_t offset;
+    bool isMalformed;               /* the input can't be framed any more */
+    bool isInputOver;               /* requests are not read any more */
+
+    std::mutex mutex;               /* of writing */
+    std::string pending;            /* queued responses of the socket */
+    bool isBroken;                  /* the client does not read responses any more */
+};
+
+
+struct Server::Request {
+    std::shared_ptr<Connection> connection;
+    std::string id;
+    std::string rules;
+    std::string word;
+    std::chrono::steady_clock::time_point startTime;
+};
+
+
+Server::Server(const Execution::Options &options, std::size_t threadsCount, std::size_t cacheSize) :
+    mOptions(options), mCache(cacheSize), mPool(threadsCount), mWakeupInput(-1), mWakeupOutput(-1),
+    mRequestsCount(0), mErrorsCount(0), mTotalLatency(0), mMaxLatency(0) {
+
+    /* Time and memory are limits of the whole process, so only limits of steps and length
+     * work for every request separately. */
+    mOptions.watchdog = 0;
+
+    for (std::size_t i=0; i<LATENCY_BUCKETS; ++i)
+        mLatencies[i] = 0;
+    for (std::size_t i=0; i<mPool.threadsCount(); ++i)
+        mWorkers.push_back(new Worker());
+}
+
+
+Server::~Server() {
+
+    mPool.wait();
+    for (std::size_t i=0; i<mWorkers.size(); ++i) {
+        delete mWorkers[i]->context;
+        delete mWorkers[i];
+    }
+}
+
+
+bool Server::serve(int input, int output) {
+
+    /* Executes requests from descriptor @input and writes responses to @output,
+     * until the input is over. Returns false if the input is malformed or can't be read. */
+
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::shared_ptr<Connection> connection = std::make_shared<Connection>(input, output, false);
+    receive(connection);
+
+    mPool.wait();
+    return ! connection->isMalformed;
+}
+
+
+bool Server::listen(const std::string &socketPath, std::ostream &log) {
+
+    /* Accepts connections of Unix domain socket "socketPath" and executes requests of all of them,
+     * until the process gets SIGINT or SIGTERM. Socket, left by the previous process, is replaced.
+     * Returns false if the socket can't be created. */
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        log << "ERROR: Invalid socket path \"" << socketPath << "\". Process stopped." << std::endl;
+        return false;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+    struct stat info;
+    if (stat(socketPath.c_str(), &info) == 0 && S_ISSOCK(info.st_mode))
+        unlink(socketPath.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || bind(listener, (sockaddr *)&address, sizeof(address)) != 0 ||
+            ::listen(listener, SOMAXCONN) != 0) {
+        log << "ERROR: Can't listen socket \"" << socketPath << "\": " << std::strerror(errno)
+            << ". Process stopped." << std::endl;
+        if (listener >= 0)
+            ::close(listener);
+        return false;
+    }
+
+    /* Workers wake up poll() by this pipe, when they queue responses. */
+    int wakeup[2];
+    if (pipe(wakeup) != 0 || ! setNonBlocking(wakeup[0]) || ! setNonBlocking(wakeup[1])) {
+        log << "ERROR: Can't create pipe: " << std::strerror(errno) << ". Process stopped." << std::endl;
+        ::close(listener);
+        return false;
+    }
+    mWakeupInput = wakeup[0];
+    mWakeupOutput = wakeup[1];
+
+    /* Signals interrupt poll(), they are not restarted. */
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = requestStop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, 0);
+    sigaction(SIGTERM, &action, 0);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    log << "Listening on \"" << socketPath << "\"." << std::endl;
+
+    std::vector<std::shared_ptr<Connection> > connections;
+    std::vector<pollfd> descriptors;
+
+    while (! isStopRequested) {
+        descriptors.resize(connections.size() + 2);
+        descriptors[0].fd = listener;
+        descriptors[0].events = POLLIN;
+        descriptors[1].fd = mWakeupInput;
+        descriptors[1].events = POLLIN;
+        for (std::size_t i=0; i<connections.size(); ++i) {
+            Connection &client = *connections[i];
+            std::lock_guard<std::mutex> lock(client.mutex);
+            /* Descriptor, that is neither read nor written, is not polled: its hangup would wake up poll(). */
+            descriptors[i + 2].fd = client.isInputOver && client.pending.empty() ? -1 : client.input;
+            descriptors[i + 2].events = (client.isInputOver ? 0 : POLLIN) | (client.pending.empty() ? 0 : POLLOUT);
+        }
+
+        if (poll(&descriptors[0], descriptors.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        char wakeups[64];
+        if (descriptors[1].revents)
+            while (::read(mWakeupInput, wakeups, sizeof(wakeups)) > 0) {}
+
+        /* Connections are removed, when their input is over and the last response is written,
+         * or when the client does not read; their descriptors are closed after the last request is done. */
+        std::size_t kept = 0;
+        for (std::size_t i=0; i<connections.size(); ++i) {
+            Connection &client = *connections[i];
+            const short events = descriptors[i + 2].revents;
+
+            if (events & ~POLLIN) {
+                std::lock_guard<std::mutex> lock(client.mutex);
+                writePending(client);
+            }
+            if (events && ! client.isInputOver && ! receive(connections[i]))
+                client.isInputOver = true;
+
+            bool isDone;
+            {
+                std::lock_guard<std::mutex> lock(client.mutex);
+                isDone = client.isBroken || (client.isInputOver && client.pending.empty()
+                                             && connections[i].use_count() == 1);
+            }
+            if (! isDone)
+                connections[kept++] = connections[i];
+        }
+        connections.resize(kept);
+
+        if (descriptors[0].revents & POLLIN) {
+            int client = accept(listener, 0, 0);
+            if (client >= 0 && setNonBlocking(client))
+                connections.push_back(std::make_shared<Connection>(client, client, true));
+            else if (client >= 0)
+                ::close(client);
+        }
+    }
+
+    ::close(listener);
+    unlink(socketPath.c_str());
+    connections.clear();
+    mPool.wait();
+
+    ::close(mWakeupInput);
+    ::close(mWakeupOutput);
+    mWakeupInput = mWakeupOutput = -1;
+    return true;
+}
+
+
+std::string Server::statistics() const {
+
+    /* Returns counters of requests, of the cache and of latency, one per line. */
+
+    static const char *bounds[LATENCY_BUCKETS] = { "<10 us", "<100 us", "<1 ms", "<10 ms", "<100 ms", ">=100 ms" };
+
+    const uint64_t requestsCount = mRequestsCount;
+
+    std::ostringstream text;
+    text << "requests: " << requestsCount << "\n"
+         << "errors: " << mErrorsCount << "\n"
+         << "cache: " << mCache.size() << " of " << mCache.capacity() << " rule sets"
+         << ", hits " << mCache.hits() << ", misses " << mCache.misses()
+         << ", evictions " << mCache.evictions() << "\n"
+         << "latency: mean " << (requestsCount ? mTotalLatency / 1000.0 / requestsCount : 0.0) << " us"
+         << ", max " << mMaxLatency / 1000.0 << " us\n"
+         << "latency histogram:";
+
+    for (std::size_t i=0; i<LATENCY_BUCKETS; ++i)
+        text << (i ? ", " : " ") << bounds[i] << " " << mLatencies[i];
+
+    return text.str();
+}
+
+
+bool Server::receive(const std::shared_ptr<Connection> &connection) {
+
+    /* Reads available bytes of @connection and submits complete requests.
+     * The standard input is read until it is over, socket - once, when poll() reports it.
+     * Returns false if the connection is over. */
+
+    Connection &client = *connection;
+    const bool isStream = ! client.isOwner;
+    char chunk[READ_CHUNK_SIZE];
+
+    do {
+        ssize_t size = ::read(client.input, chunk, sizeof(chunk));
+        if (size < 0 && errno == EINTR)
+            continue;
+        if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return true;
+        if (size <= 0)
+            return false;
+
+        client.buffer.append(chunk, (std::size_t)size);
+
+        bool isTaken = true;
+        while (isTaken)
+            if (! takeRequest(connection, isTaken))
+                return false;
+
+        /* Taken bytes are dropped, when they make the most of the buffer. */
+        if (client.offset > client.buffer.size() / 2) {
+            client.buffer.erase(0, client.offset);
+            client.offset = 0;
+        }
+    } while (isStream);
+
+    return true;
+}
+
+
+bool Server::takeRequest(const std::shared_ptr<Connection> &connection, bool &isTaken) {
+
+    /* Submits the first request of the buffer of @connection, if it is read completely (@isTaken).
+     * Returns false if the request is malformed, so the rest of the input can't be framed. */
+
+    Connection &client = *connection;
+    isTaken = false;
+
+    const std::size_t end = client.buffer.find('\n', client.offset);
+    if (end == std::string::npos) {
+        if (client.buffer.size() - client.offset <= MAX_HEADER_SIZE)
+            return true;
+
+        std::string response;
+        appendResponse(response, "-", "ERROR", "Too long header of the request.", 31);
+        respond(client, response);
+        client.isMalformed = true;
+        return false;
+    }
+
+    std::vector<std::string> fields;
+    std::istringstream header(client.buffer.substr(client.offset, end - client.offset));
+    for (std::string field; header >> field; )
+        fields.push_back(field);
+
+    /* Blank lines between requests are skipped, so requests may be framed as responses are. */
+    if (fields.empty()) {
+        client.offset = end + 1;
+        isTaken = true;
+        return true;
+    }
+
+    std::size_t rulesSize = 0;
+    std::size_t wordSize = 0;
+
+    if (fields.size() == 2 && fields[0] == "STATS") {
+        client.offset = end + 1;
+        isTaken = true;
+
+        const std::string text = statistics();
+        std::string response;
+        appendResponse(response, fields[1], "STATS", text.data(), text.size());
+        respond(client, response);
+        return true;
+    }
+
+    if (fields.size() != 4 || fields[0] != "RUN" || ! parseSize(fields[2], rulesSize) ||
+            ! parseSize(fields[3], wordSize)) {
+        const std::string message = "Unknown request \"" + client.buffer.substr(client.offset, end - client.offset) + "\".";
+        std::string response;
+        appendResponse(response, "-", "ERROR", message.data(), message.size());
+        respond(client, response);
+        client.isMalformed = true;
+        return false;
+    }
+
+    const std::size_t bodySize = client.buffer.size() - end - 1;
+    if (bodySize < rulesSize || bodySize - rulesSize < wordSize)
+        return true;
+
+    std::shared_ptr<Request> request = std::make_shared<Request>();
+    request->connection = connection;
+    request->id = fields[1];
+    request->rules.assign(client.buffer, end + 1, rulesSize);
+    request->word.assign(client.buffer, end + 1 + rulesSize, wordSize);
+    request->startTime = std::chrono::steady_clock::now();
+
+    client.offset = end + 1 + rulesSize + wordSize;
+    isTaken = true;
+
+    mPool.submit([this, request](std::size_t worker) { process(*request, worker); });
+    return true;
+}
+
+
+void Server::process(Request &request, std::size_t worker) {
+
+    /* Executes @request by the state of @worker and writes the response.
+     * Error of one request is reported in its response and does not stop the server. */
+
+    Worker &state = *mWorkers[worker];
+    bool isOk = false;
+
+    try {
+        execute(request, state, isOk);
+    } catch (std::exception &) {
+        state.response.clear();
+        appendResponse(state.response, request.id, "ERROR", "Unknown error occured.", 22);
+        isOk = false;
+    }
+
+    respond(*request.connection, state.response);
+    recordLatency(request.startTime, isOk);
+}
+
+
+void Server::execute(Request &request, Worker &worker, bool &isOk) {
+
+    /* Loads (or takes from the cache) rule set of @request, executes it for the word
+     * and writes the response to the buffer of @worker. */
+
+    worker.response.clear();
+    isOk = false;
+
+    std::string errors;
+    RuleSetCache::Algorithm algorithm = mCache.acquire(request.rules.data(), request.rules.size(), errors);
+    if (! algorithm) {
+        while (! errors.empty() && errors[errors.size() - 1] == '\n')
+            errors.resize(errors.size() - 1);
+        appendResponse(worker.response, request.id, "ERROR", errors.data(), errors.size());
+        return;
+    }
+
+    /* Context of the previous rule set is destroyed before its algorithm can be released. */
+    if (worker.algorithm != algorithm) {
+        delete worker.context;
+        worker.context = 0;
+        worker.algorithm = algorithm;
+        worker.context = new MarkovContext(*algorithm, mOptions);
+    }
+
+    if (! worker.context->run(request.word, worker.result)) {
+        static const char message[] = "The word contains non-ASCII symbol, that is absent in the alphabet.";
+        appendResponse(worker.response, request.id, "ERROR", message, sizeof(message) - 1);
+        return;
+    }
+
+    const Execution::StopReason reason = worker.result.stopReason;
+    if (reason == Execution::CycleDetected) {
+        const std::string message = "The word repeats after " + std::to_string(worker.context->execution().cycleLength())
+                                    + " steps, execution never stops.";
+        appendResponse(worker.response, request.id, "ERROR", message.data(), message.size());
+        return;
+    }
+    if (Execution::isAbnormalStop(reason)) {
+        const std::string message = "Execution stopped after " + std::to_string(worker.result.stepsCount)
+                                    + " steps: " + Execution::stopReasonText(reason);
+        appendResponse(worker.response, request.id, "ERROR", message.data(), message.size());
+        return;
+    }
+
+    const std::string status = "OK " + std::to_string(worker.result.stepsCount);
+    appendResponse(worker.response, request.id, status.c_str(), worker.result.word.data(), worker.result.word.size());
+    isOk = true;
+}
+
+
+void Server::respond(Connection &connection, const std::string &response) {
+
+    /* Writes @response to @connection as a whole, so responses of the workers are not mixed.
+     * Response of the socket is queued after the responses, that are not written yet.
+     * If the client does not read responses any more, the rest of them are dropped. */
+
+    std::lock_guard<std::mutex> lock(connection.mutex);
+    if (connection.isBroken)
+        return;
+
+    if (connection.isOwner) {
+        if (connection.pending.size() > MAX_OUTPUT_BACKLOG) {
+            connection.isBroken = true;
+            connection.pending.clear();
+        }
+        else {
+            connection.pending += response;
+            writePending(connection);
+        }
+
+        /* poll() waits for the socket to be writable or removes the broken connection. */
+        if ((connection.isBroken || ! connection.pending.empty()) && mWakeupOutput >= 0) {
+            const char wakeup = 0;
+            ssize_t size = ::write(mWakeupOutput, &wakeup, 1);
+            (void)size;
+        }
+        return;
+    }
+
+    for (std::size_t written = 0; written < response.size(); ) {
+        ssize_t size = ::write(connection.output, response.data() + written, response.size() - written);
+        if (size < 0 && errno == EINTR)
+            continue;
+        if (size <= 0) {
+            connection.isBroken = true;
+            return;
+        }
+        written += (std::size_t)size;
+    }
+}
+
+
+void Server::writePending(Connection &connection) {
+
+    /* Writes queued responses of the socket @connection, while it takes them without blocking.
+     * Must be called under the mutex of the connection. */
+
+    std::size_t written = 0;
+    while (written < connection.pending.size()) {
+        ssize_t size = ::write(connection.output, connection.pending.data() + written,
+                               connection.pending.size() - written);
+        if (size < 0 && errno == EINTR)
+            continue;
+        if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (size <= 0) {
+            connection.isBroken = true;
+            connection.pending.clear();
+            return;
+        }
+        written += (std::size_t)size;
+    }
+    connection.pending.erase(0, written);
+}
+
+
+void Server::recordLatency(std::chrono::steady_clock::time_point startTime, bool isOk) {
+
+    /* Counts finished request, that was read at @startTime. */
+
+    const uint64_t latency = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - startTime).count();
+
+    ++mRequestsCount;
+    if (! isOk)
+        ++mErrorsCount;
+    mTotalLatency += latency;
+
+    uint64_t maxLatency = mMaxLatency;
+    while (latency > maxLatency && ! mMaxLatency.compare_exchange_weak(maxLatency, latency)) {}
+
+    std::size_t bucket = 0;
+    for (uint64_t bound = 10000; bucket + 1 < LATENCY_BUCKETS && latency >= bound; bound *= 10)
+        ++bucket;
+    ++mLatencies[bucket];
+}
+
+
+void Server::appendResponse(std::string &response, const std::string &id, const char *status,
+                            const char *data, std::size_t size) {
+
+    /* Appends response "<id> <status> <size>\n<data>\n" to @response. */
+
+    response += id;
+    response.push_back(' ');
+    response += status;
+    response.push_back(' ');
+    response += std::to_string(size);
+    response.push_back('\n');
+    response.append(data, size);
+    response.push_back('\n');
+}
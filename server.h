@@ -0,0 +1,92 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "libmna.h"
+#include "rulesetcache.h"
+#include "threadpool.h"
+
+
+/* Long-running process, that executes (rule set, word) requests of other programs,
+ * so they do not pay for the start of the process and for loading of the rule set.
+ * Requests are read from standard input or from connections of Unix domain socket by one thread
+ * and executed concurrently on the thread pool; loaded rule sets are kept in RuleSetCache.
+ *
+ * Protocol is framed by sizes in bytes, so rule sets and words may contain any bytes:
+ *   RUN <id> <rules size> <word size>\n<rules><word>  - executes rule set (text of .mna file) for the word;
+ *   STATS <id>\n                                      - returns counters of the server.
+ * Every request gets one response, in the order of completion, with the same <id>:
+ *   <id> OK <steps> <size>\n<word>\n
+ *   <id> ERROR <size>\n<message>\n
+ *   <id> STATS <size>\n<counters>\n
+ * Blank lines before a request are skipped, so a client may end the body with "\n", as responses do.
+ * Malformed request is answered with id "-" and closes the connection.
+ * Responses to a socket are queued and written, when it is writable; connection of the client,
+ * that does not read them, is closed, when they are over 16M bytes. */
+class Server {
+public:
+    Server(const Execution::Options &options, std::size_t threadsCount = 0, std::size_t cacheSize = 64);
+    ~Server();
+
+    bool serve(int input, int output);
+    bool listen(const std::string &socketPath, std::ostream &log);
+
+    std::string statistics() const;
+
+private:
+    Server(const Server &);
+    Server& operator=(const Server &);
+
+    struct Connection;
+    struct Request;
+
+    /* Execution state of one worker. The context is kept while the worker executes the same rule set. */
+    struct Worker {
+        Worker() : context(0) {}
+
+        RuleSetCache::Algorithm algorithm;
+        MarkovContext *context;
+        MarkovResult result;
+        std::string response;
+    };
+
+    bool receive(const std::shared_ptr<Connection> &connection);
+    bool takeRequest(const std::shared_ptr<Connection> &connection, bool &isTaken);
+    void process(Request &request, std::size_t worker);
+    void execute(Request &request, Worker &worker, bool &isOk);
+    void respond(Connection &connection, const std::string &response);
+    void writePending(Connection &connection);
+    void recordLatency(std::chrono::steady_clock::time_point startTime, bool isOk);
+
+    static void appendResponse(std::string &response, const std::string &id, const char *status,
+                               const char *data, std::size_t size);
+
+private:
+    Execution::Options mOptions;
+    RuleSetCache mCache;
+    ThreadPool mPool;
+    std::vector<Worker *> mWorkers;         /* worker -> execution state */
+    int mWakeupInput;                       /* pipe, that wakes up poll() of listen(); -1 - not listening */
+    int mWakeupOutput;
+
+    /* Counters of finished RUN requests. Latency is counted from the end of reading of the request
+     * to the end of writing of the response, by histogram with bounds 10 us, 100 us, 1 ms, 10 ms, 100 ms. */
+    static const std::size_t LATENCY_BUCKETS = 6;
+
+    std::atomic<uint64_t> mRequestsCount;
+    std::atomic<uint64_t> mErrorsCount;
+    std::atomic<uint64_t> mTotalLatency;    /* nanoseconds */
+    std::atomic<uint64_t> mMaxLatency;
+    std::atomic<uint64_t> mLatencies[LATENCY_BUCKETS];
+};
+
+
+#endif // SERVER_H
@@ -0,0 +1,183 @@
+#include "threadpool.h"
+
+#include <algorithm>
+
+#include <assert.h>
+
+
+ThreadPool::ThreadPool(std::size_t threadsCount) :
+    mNextQueue(0), mQueuedCount(0), mPendingCount(0), mIsStopping(false) {
+
+    /* Starts @threadsCount workers (by the number of processors if 0). */
+
+    if (threadsCount == 0)
+        threadsCount = std::thread::hardware_concurrency();
+    if (threadsCount == 0)
+        threadsCount = 1;
+
+    for (std::size_t i=0; i<threadsCount; ++i)
+        mQueues.push_back(new Queue());
+    for (std::size_t i=0; i<threadsCount; ++i)
+        mThreads.push_back(std::thread(&ThreadPool::work, this, i));
+}
+
+
+ThreadPool::~ThreadPool() {
+
+    /* Finishes all submitted tasks and stops workers. */
+
+    wait();
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIsStopping = true;
+    }
+    mTaskAdded.notify_all();
+
+    for (std::size_t i=0; i<mThreads.size(); ++i)
+        mThreads[i].join();
+    for (std::size_t i=0; i<mQueues.size(); ++i)
+        delete mQueues[i];
+}
+
+
+std::size_t ThreadPool::threadsCount() const {
+    return mThreads.size();
+}
+
+
+void ThreadPool::submit(const Task &task) {
+
+    /* Adds @task to the queues in turn.
+     * Must be called from one thread (not from tasks). */
+
+    Queue &queue = *mQueues[mNextQueue];
+    mNextQueue = (mNextQueue + 1) % mQueues.size();
+
+    ++mPendingCount;
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.pushBack(task);
+        ++mQueuedCount;
+    }
+
+    /* Sleeping worker checks the counter under mMutex, so the notification can't be lost. */
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+    }
+    mTaskAdded.notify_one();
+}
+
+
+void ThreadPool::wait() {
+
+    /* Blocks until all submitted tasks are finished. */
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (mPendingCount != 0)
+        mAllDone.wait(lock);
+}
+
+
+bool ThreadPool::takeTask(std::size_t worker, Task &task) {
+
+    /* Takes the oldest task of @worker, or steals the newest task of another worker.
+     * Returns false if all queues are empty. */
+
+    {
+        Queue &own = *mQueues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.count > 0) {
+            own.popFront(task);
+            --mQueuedCount;
+            return true;
+        }
+    }
+
+    for (std::size_t i=1; i<mQueues.size(); ++i) {
+        Queue &victim = *mQueues[(worker + i) % mQueues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.count > 0) {
+            victim.popBack(task);
+            --mQueuedCount;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void ThreadPool::work(std::size_t worker) {
+
+    /* Main loop of the worker: executes tasks while they are,
+     * sleeps while all queues are empty. */
+
+    Task task;
+    for (;;) {
+        if (takeTask(worker, task)) {
+            task(worker);
+            task = Task();
+
+            if (--mPendingCount == 0) {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mAllDone.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (mQueuedCount == 0 && ! mIsStopping)
+            mTaskAdded.wait(lock);
+
+        if (mQueuedCount == 0 && mIsStopping)
+            return;
+    }
+}
+
+
+void ThreadPool::Queue::pushBack(const Task &task) {
+
+    /* Appends @task, doubling the buffer if it is full. */
+
+    if (count == tasks.size()) {
+        std::vector<Task> buffer(std::max<std::size_t>(tasks.size() * 2, 16));
+        for (std::size_t i=0; i<count; ++i)
+            buffer[i].swap(tasks[(first + i) % tasks.size()]);
+        tasks.swap(buffer);
+        first = 0;
+    }
+
+    tasks[(first + count) % tasks.size()] = task;
+    ++count;
+}
+
+
+void ThreadPool::Queue::popFront(Task &task) {
+
+    /* Moves the oldest task to @task. */
+
+#ifndef NDEBUG
+    assert(count > 0);
+#endif
+
+    task.swap(tasks[first]);
+    tasks[first] = Task();
+    first = (first + 1) % tasks.size();
+    --count;
+}
+
+
+void ThreadPool::Queue::popBack(Task &task) {
+
+    /* Moves the newest task to @task. */
+
+#ifndef NDEBUG
+    assert(count > 0);
+#endif
+
+    Task &last = tasks[(first + count - 1) % tasks.size()];
+    task.swap(last);
+    last = Task();
+    --count;
+}
@@ -0,0 +1,63 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/* Fixed set of worker threads with work stealing.
+ * Every worker has its own queue: it takes its tasks from the front,
+ * and when the queue is empty - steals from the back of other queues.
+ * Task receives index of the worker, so it can use per-worker state. */
+class ThreadPool {
+public:
+    typedef std::function<void(std::size_t worker)> Task;
+
+    explicit ThreadPool(std::size_t threadsCount = 0);
+    ~ThreadPool();
+
+    std::size_t threadsCount() const;
+    void submit(const Task &task);
+    void wait();
+
+private:
+    ThreadPool(const ThreadPool &);
+    ThreadPool& operator=(const ThreadPool &);
+
+    /* Ring buffer of tasks. It grows, but never shrinks, so steady submitting does not allocate
+     * (unlike std::deque, that allocates and frees its blocks in turn). */
+    struct Queue {
+        Queue() : first(0), count(0) {}
+
+        void pushBack(const Task &task);
+        void popFront(Task &task);
+        void popBack(Task &task);
+
+        std::mutex mutex;
+        std::vector<Task> tasks;
+        std::size_t first;          /* index of the oldest task */
+        std::size_t count;
+    };
+
+    void work(std::size_t worker);
+    bool takeTask(std::size_t worker, Task &task);
+
+private:
+    std::vector<Queue *> mQueues;
+    std::vector<std::thread> mThreads;
+    std::size_t mNextQueue;
+
+    std::mutex mMutex;
+    std::condition_variable mTaskAdded;
+    std::condition_variable mAllDone;
+    std::atomic<std::size_t> mQueuedCount;      /* tasks in queues */
+    std::atomic<std::size_t> mPendingCount;     /* tasks not finished yet */
+    bool mIsStopping;
+};
+
+
+#endif // THREADPOOL_H
@@ -0,0 +1,175 @@
+#include "tracewriter.h"
+
+#include <chrono>
+#include <cstring>
+
+
+#define HAND_OFF_SIZE     (64 * 1024)
+#define HAND_OFF_INTERVAL std::chrono::milliseconds(20)
+#define MAX_FRONT_SIZE    (4 * 1024 * 1024)
+
+
+/* TraceWriter::Buffer */
+TraceWriter::Buffer::Buffer(TraceWriter &writer) :
+    mWriter(writer) {
+
+    setp(mChunk, mChunk + sizeof(mChunk));
+}
+
+
+void TraceWriter::Buffer::drain() {
+
+    /* Moves small writes, collected in the chunk, to the front buffer. */
+
+    mWriter.mFront.append(pbase(), pptr() - pbase());
+    setp(mChunk, mChunk + sizeof(mChunk));
+}
+
+
+TraceWriter::Buffer::int_type TraceWriter::Buffer::overflow(int_type symbol) {
+
+    drain();
+    if (mWriter.mFront.size() >= HAND_OFF_SIZE)
+        mWriter.handOff(mWriter.mFront.size() >= MAX_FRONT_SIZE);
+
+    if (traits_type::eq_int_type(symbol, traits_type::eof()))
+        return traits_type::not_eof(symbol);
+
+    *pptr() = traits_type::to_char_type(symbol);
+    pbump(1);
+    return symbol;
+}
+
+
+std::streamsize TraceWriter::Buffer::xsputn(const char *data, std::streamsize size) {
+
+    /* Small writes are collected in the chunk, big ones are appended to the front buffer directly.
+     * Big front buffer is handed off if the writer is idle; the front buffer above the high-water mark
+     * waits for the writer, so the trace for a stalled reader is not collected in memory. */
+
+    if (size <= epptr() - pptr()) {
+        std::memcpy(pptr(), data, size);
+        pbump((int)size);
+        return size;
+    }
+
+    drain();
+    mWriter.mFront.append(data, size);
+    if (mWriter.mFront.size() >= HAND_OFF_SIZE)
+        mWriter.handOff(mWriter.mFront.size() >= MAX_FRONT_SIZE);
+    return size;
+}
+
+
+int TraceWriter::Buffer::sync() {
+
+    /* Flush of the stream doesn't wait for the writer
+     * and hands off the text only if the writer asked for it. */
+
+    drain();
+    if (mWriter.mIsHandOffRequested.load(std::memory_order_relaxed) || mWriter.mFront.size() >= HAND_OFF_SIZE)
+        mWriter.handOff(mWriter.mFront.size() >= MAX_FRONT_SIZE);
+    return 0;
+}
+
+
+
+/* TraceWriter */
+TraceWriter::TraceWriter(std::ostream &target) :
+    mTarget(target), mBuffer(*this), mStream(&mBuffer),
+    mHasBack(false), mIsStopping(false), mIsHandOffRequested(false) {
+
+    mThread = std::thread(&TraceWriter::work, this);
+}
+
+
+TraceWriter::~TraceWriter() {
+
+    /* Writes everything, that was collected, and stops the writer thread. */
+
+    flush();
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIsStopping = true;
+    }
+    mBackReady.notify_one();
+    mThread.join();
+}
+
+
+std::ostream& TraceWriter::stream() {
+    return mStream;
+}
+
+
+void TraceWriter::flush() {
+
+    /* Blocks until all collected text is written to the target stream. */
+
+    mBuffer.drain();
+    handOff(true);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (mHasBack)
+        mBackWritten.wait(lock);
+}
+
+
+bool TraceWriter::handOff(bool isWaiting) {
+
+    /* Swaps the front buffer with the back one, if the writer has finished the previous one.
+     * If @isWaiting is false and the writer is busy - returns false immediately. */
+
+    if (mFront.empty())
+        return true;
+
+    std::unique_lock<std::mutex> lock(mMutex, std::defer_lock);
+    if (isWaiting)
+        lock.lock();
+    else if (! lock.try_lock())
+        return false;
+
+    while (mHasBack) {
+        if (! isWaiting)
+            return false;
+        mBackWritten.wait(lock);
+    }
+
+    mFront.swap(mBack);
+    mHasBack = true;
+    mIsHandOffRequested.store(false, std::memory_order_relaxed);
+    lock.unlock();
+
+    mBackReady.notify_one();
+    return true;
+}
+
+
+void TraceWriter::work() {
+
+    /* Writes back buffers to the target stream until the writer is stopped.
+     * If nothing was handed off for a while - asks the producer to hand off on the next flush,
+     * so the trace of slow execution still appears in time. */
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;) {
+        while (! mHasBack && ! mIsStopping) {
+            if (mBackReady.wait_for(lock, HAND_OFF_INTERVAL) == std::cv_status::timeout)
+                mIsHandOffRequested.store(true, std::memory_order_relaxed);
+        }
+
+        if (! mHasBack)
+            return;
+
+        /* The producer doesn't touch the back buffer while mHasBack is set. */
+        lock.unlock();
+        mTarget.write(mBack.data(), mBack.size());
+        mTarget.flush();
+        mBack.clear();
+        lock.lock();
+
+        mHasBack = false;
+        mBackWritten.notify_all();
+    }
+}
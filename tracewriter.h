@@ -0,0 +1,70 @@
+#ifndef TRACEWRITER_H
+#define TRACEWRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+
+/* Output stream, that is written to the target stream by a separate thread.
+ * Text is collected in the front buffer and handed to the writer thread when it grows big,
+ * or on flush of the stream (std::endl) if the writer asked for it - at most every few
+ * milliseconds, so flushes do not turn into system calls. If the writer is busy, the text
+ * stays in the front buffer, so the producer doesn't wait for the terminal or the disk -
+ * until the front buffer reaches the high-water mark (4 MB): then the producer waits for the writer,
+ * so a slow or stalled reader throttles the execution instead of the trace growing in memory. */
+class TraceWriter {
+public:
+    explicit TraceWriter(std::ostream &target);
+    ~TraceWriter();
+
+    std::ostream& stream();
+    void flush();
+
+private:
+    TraceWriter(const TraceWriter &);
+    TraceWriter& operator=(const TraceWriter &);
+
+    /* Collects the text of the stream into the front buffer. */
+    class Buffer : public std::streambuf {
+    public:
+        explicit Buffer(TraceWriter &writer);
+
+        void drain();
+
+    protected:
+        int_type overflow(int_type symbol);
+        std::streamsize xsputn(const char *data, std::streamsize size);
+        int sync();
+
+    private:
+        TraceWriter &mWriter;
+        char mChunk[4096];
+    };
+
+    bool handOff(bool isWaiting);
+    void work();
+
+private:
+    std::ostream &mTarget;
+    Buffer mBuffer;
+    std::ostream mStream;
+
+    std::string mFront;             /* filled by the producer */
+    std::string mBack;              /* written by the writer thread */
+    bool mHasBack;
+    bool mIsStopping;
+    std::atomic<bool> mIsHandOffRequested;
+
+    std::mutex mMutex;
+    std::condition_variable mBackReady;
+    std::condition_variable mBackWritten;
+    std::thread mThread;
+};
+
+
+#endif // TRACEWRITER_H
@@ -0,0 +1,131 @@
+#include "watchdog.h"
+
+#ifdef LINUX
+#include <cstdio>
+#include <unistd.h>
+#endif
+
+
+#define CHECK_INTERVAL std::chrono::milliseconds(10)
+
+
+Watchdog::Watchdog() :
+    mAlarm(NoAlarm), mPeakMemory(0),
+    mTimeLimit(0), mMemoryLimit(0), mIsRunning(false) {}
+
+
+Watchdog::~Watchdog() {
+    stop();
+}
+
+
+void Watchdog::start(double timeLimit, std::size_t memoryLimit) {
+
+    /* Starts watching: execution time is limited by @timeLimit seconds,
+     * memory of the process - by @memoryLimit bytes (0 - no limit).
+     * The thread is started only if there is some limit. */
+
+    stop();
+
+    mAlarm = NoAlarm;
+    mPeakMemory = 0;
+    mTimeLimit = timeLimit;
+    mMemoryLimit = memoryLimit;
+    mStartTime = mStopTime = std::chrono::steady_clock::now();
+    mIsRunning = true;
+
+    if (timeLimit > 0 || memoryLimit > 0)
+        mThread = std::thread(&Watchdog::work, this);
+}
+
+
+void Watchdog::stop() {
+
+    /* Stops watching. The alarm stays as is. */
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (! mIsRunning)
+            return;
+        mIsRunning = false;
+        mStopTime = std::chrono::steady_clock::now();
+    }
+    mStopped.notify_one();
+
+    if (mThread.joinable())
+        mThread.join();
+}
+
+
+double Watchdog::elapsedTime() const {
+
+    /* Returns seconds from start() to stop() (or to now, if it is still running). */
+
+    std::chrono::steady_clock::time_point end = mIsRunning ? std::chrono::steady_clock::now() : mStopTime;
+    return std::chrono::duration<double>(end - mStartTime).count();
+}
+
+
+std::size_t Watchdog::peakMemory() const {
+
+    /* Returns the biggest memory of the process, that was seen while watching. */
+
+    std::size_t memory = currentMemory();
+    return memory > mPeakMemory ? memory : mPeakMemory.load();
+}
+
+
+std::size_t Watchdog::currentMemory() {
+
+    /* Returns resident memory of the process in bytes (0 if it is unknown). */
+
+#ifdef LINUX
+    std::FILE *file = std::fopen("/proc/self/statm", "r");
+    if (file == 0)
+        return 0;
+
+    unsigned long size = 0, resident = 0;
+    int count = std::fscanf(file, "%lu %lu", &size, &resident);
+    std::fclose(file);
+
+    if (count != 2)
+        return 0;
+    return (std::size_t)resident * (std::size_t)sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
+
+
+void Watchdog::work() {
+
+    /* Wakes up at the deadline and every CHECK_INTERVAL to check the memory. */
+
+    const std::chrono::steady_clock::time_point deadline =
+            mStartTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(mTimeLimit));
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (mIsRunning) {
+        const std::size_t memory = currentMemory();
+        if (memory > mPeakMemory)
+            mPeakMemory = memory;
+
+        if (mMemoryLimit > 0 && memory > mMemoryLimit) {
+            mAlarm = MemoryAlarm;
+            return;
+        }
+
+        std::chrono::steady_clock::time_point wakeUp = std::chrono::steady_clock::now() + CHECK_INTERVAL;
+        if (mTimeLimit > 0) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                mAlarm = TimeAlarm;
+                return;
+            }
+            if (deadline < wakeUp)
+                wakeUp = deadline;
+        }
+
+        mStopped.wait_until(lock, wakeUp);
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+
+/* Thread, that watches the wall-clock deadline and the memory of the process.
+ * When a limit is exceeded it raises the alarm, which executions check at every step
+ * by one atomic read - they never read the clock themselves. */
+class Watchdog {
+public:
+    enum Alarm {
+        NoAlarm,
+        TimeAlarm,
+        MemoryAlarm
+    };
+
+    Watchdog();
+    ~Watchdog();
+
+    void start(double timeLimit, std::size_t memoryLimit);
+    void stop();
+
+    Alarm alarm() const {
+        return (Alarm)mAlarm.load(std::memory_order_relaxed);
+    }
+
+    double elapsedTime() const;
+    std::size_t peakMemory() const;
+
+    static std::size_t currentMemory();
+
+private:
+    Watchdog(const Watchdog &);
+    Watchdog& operator=(const Watchdog &);
+
+    void work();
+
+private:
+    std::atomic<int> mAlarm;
+    std::atomic<std::size_t> mPeakMemory;
+
+    double mTimeLimit;                  /* seconds, 0 - unlimited */
+    std::size_t mMemoryLimit;           /* bytes, 0 - unlimited */
+    std::chrono::steady_clock::time_point mStartTime;
+    std::chrono::steady_clock::time_point mStopTime;
+    bool mIsRunning;
+
+    std::mutex mMutex;
+    std::condition_variable mStopped;
+    std::thread mThread;
+};
+
+
+#endif // WATCHDOG_H
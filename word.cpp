@@ -0,0 +1,1093 @@
+#include "word.h"
+#include "patternsearch.h"
+#include "rollinghash.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+#include <assert.h>
+
+
+#define MIN_GAP_SIZE   64
+#define RUN_CHUNK_SIZE 256
+
+
+static const uint64_t INVERSE_BASE = RollingHash::inverseBase();
+
+
+
+/* WordChunkVisitor */
+bool WordChunkVisitor::visitRun(char symbol, std::size_t count) {
+
+    /* Passes the run to visit() by chunks of the stack buffer. */
+
+    char chunk[RUN_CHUNK_SIZE];
+    std::memset(chunk, symbol, std::min(count, (std::size_t)RUN_CHUNK_SIZE));
+
+    while (count > 0) {
+        std::size_t size = std::min(count, (std::size_t)RUN_CHUNK_SIZE);
+        if (! visit(chunk, size))
+            return false;
+        count -= size;
+    }
+
+    return true;
+}
+
+
+
+/* GapBufferStorage */
+GapBufferStorage::GapBufferStorage() :
+    mGapBegin(0), mGapEnd(0),
+    mIsHashing(false), mBeforeHash(0), mBeforePower(1), mAfterHash(0), mAfterPower(1),
+    mMovedBytes(0) {}
+
+
+std::size_t GapBufferStorage::size() const {
+    return mBuffer.size() - (mGapEnd - mGapBegin);
+}
+
+
+char GapBufferStorage::at(std::size_t pos) const {
+
+#ifndef NDEBUG
+    assert(pos < size());
+#endif
+
+    if (pos < mGapBegin)
+        return mBuffer[pos];
+
+    return mBuffer[pos + (mGapEnd - mGapBegin)];
+}
+
+
+void GapBufferStorage::assign(const char *data, std::size_t size) {
+
+    /* Replaces all content by @data.
+     * The gap is placed at the end of the word and takes the rest of the buffer, so the buffer
+     * of the previous word is reused, and a new one is allocated with the gap for the first edits. */
+
+    if (mBuffer.size() < size + MIN_GAP_SIZE) {
+        std::vector<char> buffer(size + size / 2 + MIN_GAP_SIZE);
+        mBuffer.swap(buffer);
+    }
+
+    std::copy(data, data + size, mBuffer.begin());
+    mGapBegin = size;
+    mGapEnd = mBuffer.size();
+
+    if (mIsHashing)
+        setHashing(true);
+}
+
+
+void GapBufferStorage::replace(std::size_t pos, std::size_t length, const char *data, std::size_t size) {
+
+    /* Replaces @length symbols at @pos by @size symbols from @data.
+     * Only symbols between the previous edit and @pos are moved. */
+
+
+#ifndef NDEBUG
+    assert(pos + length <= this->size());
+#endif
+
+    moveGap(pos);
+
+    if (mIsHashing) {
+        for (std::size_t i=0; i<length; ++i) {
+            mAfterHash = (mAfterHash - RollingHash::value(mBuffer[mGapEnd + i])) * INVERSE_BASE;
+            mAfterPower *= INVERSE_BASE;
+        }
+        for (std::size_t i=0; i<size; ++i) {
+            mBeforeHash += RollingHash::value(data[i]) * mBeforePower;
+            mBeforePower *= RollingHash::BASE;
+        }
+    }
+
+    mGapEnd += length;
+
+    reserveGap(size);
+    std::memcpy(mBuffer.data() + mGapBegin, data, size);
+    mGapBegin += size;
+    mMovedBytes += size;
+}
+
+
+void GapBufferStorage::moveGap(std::size_t pos) {
+
+    /* Moves the gap so that it begins at @pos.
+     * Moved symbols pass from one part of the hash to another. */
+
+    if (pos < mGapBegin) {
+        std::size_t count = mGapBegin - pos;
+        for (std::size_t i=mGapBegin; mIsHashing && i>pos; --i) {
+            const uint64_t value = RollingHash::value(mBuffer[i - 1]);
+            mBeforePower *= INVERSE_BASE;
+            mBeforeHash -= value * mBeforePower;
+            mAfterHash = value + mAfterHash * RollingHash::BASE;
+            mAfterPower *= RollingHash::BASE;
+        }
+
+        std::memmove(mBuffer.data() + mGapEnd - count, mBuffer.data() + pos, count);
+        mGapBegin -= count;
+        mGapEnd -= count;
+        mMovedBytes += count;
+    }
+    else if (pos > mGapBegin) {
+        std::size_t count = pos - mGapBegin;
+        for (std::size_t i=0; mIsHashing && i<count; ++i) {
+            const uint64_t value = RollingHash::value(mBuffer[mGapEnd + i]);
+            mAfterHash = (mAfterHash - value) * INVERSE_BASE;
+            mAfterPower *= INVERSE_BASE;
+            mBeforeHash += value * mBeforePower;
+            mBeforePower *= RollingHash::BASE;
+        }
+
+        std::memmove(mBuffer.data() + mGapBegin, mBuffer.data() + mGapEnd, count);
+        mGapBegin += count;
+        mGapEnd += count;
+        mMovedBytes += count;
+    }
+}
+
+
+void GapBufferStorage::reserveGap(std::size_t size) {
+
+    /* Grows the buffer geometrically if the gap is shorter than @size. */
+
+    if (mGapEnd - mGapBegin >= size)
+        return;
+
+    std::size_t tail = mBuffer.size() - mGapEnd;
+    std::size_t capacity = std::max(mBuffer.size() * 2, mBuffer.size() + size + MIN_GAP_SIZE);
+
+    std::vector<char> buffer(capacity);
+    std::memcpy(buffer.data(), mBuffer.data(), mGapBegin);
+    std::memcpy(buffer.data() + capacity - tail, mBuffer.data() + mGapEnd, tail);
+
+    mBuffer.swap(buffer);
+    mGapEnd = capacity - tail;
+    mMovedBytes += mGapBegin + tail;
+}
+
+
+bool GapBufferStorage::compare(std::size_t pos, const char *data, std::size_t size) const {
+
+    /* Returns true if @size symbols at @pos are equal to @data. */
+
+    if (pos > this->size() || size > this->size() - pos)
+        return false;
+
+    std::size_t before = pos < mGapBegin ? std::min(size, mGapBegin - pos) : 0;
+    if (before && std::memcmp(mBuffer.data() + pos, data, before) != 0)
+        return false;
+
+    std::size_t after = size - before;
+    if (after) {
+        std::size_t physical = pos + before + (mGapEnd - mGapBegin);
+        return std::memcmp(mBuffer.data() + physical, data + before, after) == 0;
+    }
+
+    return true;
+}
+
+
+std::size_t GapBufferStorage::find(const char *pattern, std::size_t length,
+                                   std::size_t from, std::size_t lastStart) const {
+
+    /* Returns the leftmost occurrence of @pattern, that starts in [from, lastStart], or npos.
+     * Parts of the word before and after the gap are searched directly,
+     * occurrences that cross the gap are checked one by one. */
+
+
+    std::size_t contentSize = size();
+    if (length == 0 || length > contentSize)
+        return std::string::npos;
+
+    lastStart = std::min(lastStart, contentSize - length);
+    if (from > lastStart)
+        return std::string::npos;
+
+    /* Before the gap. */
+    if (mGapBegin >= length && from + length <= mGapBegin) {
+        std::size_t last = std::min(lastStart, mGapBegin - length);
+        std::size_t found = PatternSearch::find(mBuffer.data() + from, last + length - from, pattern, length);
+        if (found != std::string::npos)
+            return from + found;
+    }
+
+    /* Across the gap. */
+    std::size_t crossFrom = std::max(from, mGapBegin + 1 > length ? mGapBegin + 1 - length : 0);
+    std::size_t crossLast = std::min(lastStart, mGapBegin ? mGapBegin - 1 : 0);
+    for (std::size_t pos=crossFrom; mGapBegin && pos<=crossLast; ++pos) {
+        if (compare(pos, pattern, length))
+            return pos;
+    }
+
+    /* After the gap. */
+    std::size_t afterFrom = std::max(from, mGapBegin);
+    if (afterFrom <= lastStart) {
+        const char *begin = mBuffer.data() + afterFrom + (mGapEnd - mGapBegin);
+        std::size_t found = PatternSearch::find(begin, lastStart + length - afterFrom, pattern, length);
+        if (found != std::string::npos)
+            return afterFrom + found;
+    }
+
+    return std::string::npos;
+}
+
+
+bool GapBufferStorage::scan(std::size_t from, std::size_t to, WordChunkVisitor &visitor) const {
+
+    /* Passes symbols [from, to) to @visitor as (at most) two chunks. */
+
+    if (from < to && from < mGapBegin) {
+        std::size_t end = std::min(to, mGapBegin);
+        if (! visitor.visit(mBuffer.data() + from, end - from))
+            return false;
+        from = end;
+    }
+
+    if (from < to) {
+        if (! visitor.visit(mBuffer.data() + from + (mGapEnd - mGapBegin), to - from))
+            return false;
+    }
+
+    return true;
+}
+
+
+
+void GapBufferStorage::setHashing(bool isEnabled) {
+
+    /* Enables or disables hash updates. Enabled hash is computed from scratch. */
+
+    mIsHashing = isEnabled;
+    mBeforeHash = mAfterHash = 0;
+    mBeforePower = mAfterPower = 1;
+    if (! isEnabled)
+        return;
+
+    for (std::size_t i=0; i<mGapBegin; ++i) {
+        mBeforeHash += RollingHash::value(mBuffer[i]) * mBeforePower;
+        mBeforePower *= RollingHash::BASE;
+    }
+    for (std::size_t i=mGapEnd; i<mBuffer.size(); ++i) {
+        mAfterHash += RollingHash::value(mBuffer[i]) * mAfterPower;
+        mAfterPower *= RollingHash::BASE;
+    }
+}
+
+
+uint64_t GapBufferStorage::hash() const {
+
+#ifndef NDEBUG
+    assert(mIsHashing);
+#endif
+
+    return mBeforeHash + mBeforePower * mAfterHash;
+}
+
+
+uint64_t GapBufferStorage::power() const {
+
+#ifndef NDEBUG
+    assert(mIsHashing);
+#endif
+
+    return mBeforePower * mAfterPower;
+}
+
+
+uint64_t GapBufferStorage::movedBytes() const {
+    return mMovedBytes;
+}
+
+
+
+/* RunLengthStorage */
+static void repeatHash(std::size_t count, uint64_t &sum, uint64_t &power) {
+
+    /* Writes to @sum 1 + BASE + ... + BASE^(count-1) and to @power BASE^count,
+     * doubling the block of repetitions, so it costs log(count). */
+
+    uint64_t blockSum = 1, blockPower = RollingHash::BASE;
+    sum = 0;
+    power = 1;
+
+    for (; count > 0; count >>= 1) {
+        if (count & 1) {
+            sum += power * blockSum;
+            power *= blockPower;
+        }
+        blockSum += blockPower * blockSum;
+        blockPower *= blockPower;
+    }
+}
+
+
+static uint64_t inversePower(std::size_t count) {
+
+    /* Returns BASE^-count, squaring, so it costs log(count). */
+
+    uint64_t power = 1, blockPower = INVERSE_BASE;
+    for (; count > 0; count >>= 1) {
+        if (count & 1)
+            power *= blockPower;
+        blockPower *= blockPower;
+    }
+
+    return power;
+}
+
+
+RunLengthStorage::RunLengthStorage() :
+    mSize(0), mMovedBytes(0), mIsHashing(false), mHash(0), mPower(1),
+    mEditRun(0), mEditStart(0), mEditHash(0), mEditPower(1),
+    mCursorRun(0), mCursorStart(0) {}
+
+
+std::size_t RunLengthStorage::size() const {
+    return mSize;
+}
+
+
+char RunLengthStorage::at(std::size_t pos) const {
+
+#ifndef NDEBUG
+    assert(pos < size());
+#endif
+
+    return mRuns[locate(pos)].symbol;
+}
+
+
+void RunLengthStorage::encode(const char *data, std::size_t size, std::vector<Run> &runs) {
+
+    /* Writes runs of @size symbols of @data to @runs. */
+
+    runs.clear();
+    for (std::size_t pos=0; pos<size; ++pos) {
+        if (runs.empty() || runs.back().symbol != data[pos]) {
+            Run run = {0, data[pos]};
+            runs.push_back(run);
+        }
+        ++runs.back().count;
+    }
+}
+
+
+void RunLengthStorage::assign(const char *data, std::size_t size) {
+
+    /* Replaces all content by @data. */
+
+    encode(data, size, mRuns);
+    mSize = size;
+    mCursorRun = mCursorStart = 0;
+
+    if (mIsHashing)
+        setHashing(true);
+}
+
+
+std::size_t RunLengthStorage::locate(std::size_t pos) const {
+
+    /* Returns index of the run, that contains @pos (size of runs for the end of the word),
+     * and moves the cursor to it. The first and the last runs are found at once,
+     * others - by walking from the cursor. */
+
+    if (pos >= mSize)
+        return mRuns.size();
+
+    if (pos < mRuns.front().count) {
+        mCursorRun = mCursorStart = 0;
+    }
+    else if (pos >= mSize - mRuns.back().count) {
+        mCursorRun = mRuns.size() - 1;
+        mCursorStart = mSize - mRuns.back().count;
+    }
+    else if (mCursorRun >= mRuns.size()) {
+        mCursorRun = mCursorStart = 0;
+    }
+
+    while (pos < mCursorStart)
+        mCursorStart -= mRuns[--mCursorRun].count;
+    while (pos >= mCursorStart + mRuns[mCursorRun].count)
+        mCursorStart += mRuns[mCursorRun++].count;
+
+    return mCursorRun;
+}
+
+
+std::size_t RunLengthStorage::split(std::size_t pos) {
+
+    /* Splits the run, that contains @pos, so that a run begins at @pos.
+     * Returns index of this run. */
+
+    const std::size_t index = locate(pos);
+    if (index == mRuns.size() || pos == mCursorStart)
+        return index;
+
+    Run tail = {mCursorStart + mRuns[index].count - pos, mRuns[index].symbol};
+    mRuns[index].count = pos - mCursorStart;
+    mRuns.insert(mRuns.begin() + index + 1, tail);
+    mMovedBytes += (mRuns.size() - index - 1) * sizeof(Run);
+
+    if (mIsHashing && mEditRun > index)
+        ++mEditRun;
+    return index + 1;
+}
+
+
+void RunLengthStorage::merge(std::size_t index) {
+
+    /* Joins run @index with the previous one, if they have the same symbol. */
+
+    if (index == 0 || index >= mRuns.size() || mRuns[index - 1].symbol != mRuns[index].symbol)
+        return;
+
+    if (mCursorRun == index)
+        mCursorStart -= mRuns[index - 1].count;
+    if (mCursorRun >= index)
+        --mCursorRun;
+
+    if (mIsHashing && mEditRun == index)
+        moveEdit(index - 1, mEditStart - mRuns[index - 1].count);
+    else if (mIsHashing && mEditRun > index)
+        --mEditRun;
+
+    mRuns[index - 1].count += mRuns[index].count;
+    mRuns.erase(mRuns.begin() + index);
+    mMovedBytes += (mRuns.size() - index) * sizeof(Run);
+}
+
+
+void RunLengthStorage::moveEdit(std::size_t index, std::size_t start) {
+
+    /* Moves the point of the last edit to run @index, that begins at @start (the end of the word
+     * for the size of runs), passing runs from the nearest of the previous edit, the beginning
+     * and the end of the word. Runs, that are passed backwards, are removed from the hash
+     * before the edit as one part, so the inverse power is computed once. */
+
+    if (start < mEditStart && start < mEditStart - start) {
+        mEditRun = mEditStart = 0;
+        mEditHash = 0;
+        mEditPower = 1;
+    }
+    else if (start > mEditStart && mSize - start < start - mEditStart) {
+        mEditRun = mRuns.size();
+        mEditStart = mSize;
+        mEditHash = mHash;
+        mEditPower = mPower;
+    }
+
+    for (; mEditRun < index; ++mEditRun) {
+        uint64_t sum, power;
+        repeatHash(mRuns[mEditRun].count, sum, power);
+        mEditHash += mEditPower * RollingHash::value(mRuns[mEditRun].symbol) * sum;
+        mEditPower *= power;
+        mEditStart += mRuns[mEditRun].count;
+    }
+
+    if (mEditRun > index) {
+        uint64_t partHash = 0;
+        std::size_t partSize = 0;
+        while (mEditRun > index) {
+            const Run &run = mRuns[--mEditRun];
+            uint64_t sum, power;
+            repeatHash(run.count, sum, power);
+            partHash = RollingHash::value(run.symbol) * sum + power * partHash;
+            partSize += run.count;
+        }
+
+        mEditStart -= partSize;
+        mEditPower *= inversePower(partSize);
+        mEditHash -= mEditPower * partHash;
+    }
+
+#ifndef NDEBUG
+    assert(mEditStart == start);
+#endif
+}
+
+
+void RunLengthStorage::replace(std::size_t pos, std::size_t length, const char *data, std::size_t size) {
+
+    /* Replaces @length symbols at @pos by @size symbols from @data.
+     * Runs of the replaced part are replaced by runs of @data, then runs are joined at both ends.
+     * Hash is patched by the hashes before and after the replaced part (see moveEdit()):
+     * hash = hash(before) + BASE^pos * hash(data) + BASE^(pos + size) * hash(after). */
+
+
+#ifndef NDEBUG
+    assert(pos + length <= this->size());
+#endif
+
+    const std::size_t first = split(pos);
+    const std::size_t last = split(pos + length);
+
+    encode(data, size, mInserted);
+    const std::size_t inserted = mInserted.size();
+    const std::size_t removed = last - first;
+
+    uint64_t beforeHash = 0, beforePower = 1;
+    if (mIsHashing) {
+        moveEdit(first, pos);
+        beforeHash = mEditHash;
+        beforePower = mEditPower;
+        moveEdit(last, pos + length);
+        const uint64_t afterHash = mHash - mEditHash;
+
+        uint64_t insertedHash = 0, insertedPower = 1;
+        for (std::size_t i=0; i<inserted; ++i) {
+            uint64_t sum, power;
+            repeatHash(mInserted[i].count, sum, power);
+            insertedHash += insertedPower * RollingHash::value(mInserted[i].symbol) * sum;
+            insertedPower *= power;
+        }
+
+        const uint64_t shift = insertedPower * inversePower(length);
+        mHash = beforeHash + beforePower * insertedHash + afterHash * shift;
+        mPower *= shift;
+    }
+
+    std::copy(mInserted.begin(), mInserted.begin() + std::min(inserted, removed), mRuns.begin() + first);
+    if (inserted > removed)
+        mRuns.insert(mRuns.begin() + last, mInserted.begin() + removed, mInserted.end());
+    else
+        mRuns.erase(mRuns.begin() + first + inserted, mRuns.begin() + last);
+
+    /* Copied runs and runs behind the edit, that are shifted. */
+    if (inserted != removed)
+        mMovedBytes += (mRuns.size() - first - inserted) * sizeof(Run);
+    mMovedBytes += inserted * sizeof(Run);
+
+    mSize = mSize - length + size;
+
+    mCursorRun = first;
+    mCursorStart = pos;
+    mEditRun = first;
+    mEditStart = pos;
+    mEditHash = beforeHash;
+    mEditPower = beforePower;
+    merge(first + inserted);
+    merge(first);
+}
+
+
+bool RunLengthStorage::compare(std::size_t pos, const char *data, std::size_t size) const {
+
+    /* Returns true if @size symbols at @pos are equal to @data. */
+
+    if (pos > this->size() || size > this->size() - pos)
+        return false;
+
+    if (size == 0)
+        return true;
+
+    std::size_t index = locate(pos);
+    std::size_t offset = pos - mCursorStart;
+    for (std::size_t i=0; i<size; ++index, offset=0) {
+        const Run &run = mRuns[index];
+        const std::size_t end = i + std::min(run.count - offset, size - i);
+        for (; i<end; ++i) {
+            if (data[i] != run.symbol)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
+std::size_t RunLengthStorage::find(const char *pattern, std::size_t length,
+                                   std::size_t from, std::size_t lastStart) const {
+
+    /* Returns the leftmost occurrence of @pattern, that starts in [from, lastStart], or npos.
+     * The pattern is matched by runs: runs of the word are maximal, so its first run must be
+     * the end of a run of the word, its last run - the beginning of a run,
+     * and the runs between them must be equal to runs of the word. */
+
+
+    if (length == 0 || length > mSize)
+        return std::string::npos;
+
+    lastStart = std::min(lastStart, mSize - length);
+    if (from > lastStart)
+        return std::string::npos;
+
+    encode(pattern, length, mPattern);
+    const std::size_t patternRuns = mPattern.size();
+    const Run &head = mPattern.front();
+    const Run &tail = mPattern.back();
+
+    std::size_t index = locate(from);
+    for (std::size_t start=mCursorStart; index<mRuns.size() && start<=lastStart; start+=mRuns[index++].count) {
+        const Run &run = mRuns[index];
+        if (run.symbol != head.symbol || run.count < head.count)
+            continue;
+
+        /* Pattern of one run may start anywhere in the run. */
+        if (patternRuns == 1) {
+            const std::size_t found = std::max(start, from);
+            if (found + head.count <= start + run.count)
+                return found;
+            continue;
+        }
+
+        const std::size_t found = start + run.count - head.count;
+        if (found < from)
+            continue;
+        if (found > lastStart || index + patternRuns > mRuns.size())
+            return std::string::npos;
+
+        std::size_t k = 1;
+        for (; k+1<patternRuns; ++k) {
+            if (mRuns[index + k].symbol != mPattern[k].symbol || mRuns[index + k].count != mPattern[k].count)
+                break;
+        }
+
+        const Run &next = mRuns[index + k];
+        if (k + 1 == patternRuns && next.symbol == tail.symbol && next.count >= tail.count)
+            return found;
+    }
+
+    return std::string::npos;
+}
+
+
+bool RunLengthStorage::scan(std::size_t from, std::size_t to, WordChunkVisitor &visitor) const {
+
+    /* Passes symbols [from, to) to @visitor run by run. */
+
+    if (from >= to)
+        return true;
+
+    std::size_t index = locate(from);
+    std::size_t offset = from - mCursorStart;
+    for (std::size_t pos=from; pos<to; ++index, offset=0) {
+        const std::size_t count = std::min(mRuns[index].count - offset, to - pos);
+        if (! visitor.visitRun(mRuns[index].symbol, count))
+            return false;
+        pos += count;
+    }
+
+    return true;
+}
+
+
+void RunLengthStorage::setHashing(bool isEnabled) {
+
+    /* Enables or disables hash updates. Enabled hash is computed from scratch by runs. */
+
+    mIsHashing = isEnabled;
+    mHash = 0;
+    mPower = 1;
+    mEditRun = mEditStart = 0;
+    mEditHash = 0;
+    mEditPower = 1;
+    if (! isEnabled)
+        return;
+
+    for (std::size_t i=0; i<mRuns.size(); ++i) {
+        uint64_t sum, power;
+        repeatHash(mRuns[i].count, sum, power);
+        mHash += mPower * RollingHash::value(mRuns[i].symbol) * sum;
+        mPower *= power;
+    }
+}
+
+
+uint64_t RunLengthStorage::hash() const {
+
+#ifndef NDEBUG
+    assert(mIsHashing);
+#endif
+
+    return mHash;
+}
+
+
+uint64_t RunLengthStorage::power() const {
+
+#ifndef NDEBUG
+    assert(mIsHashing);
+#endif
+
+    return mPower;
+}
+
+
+uint64_t RunLengthStorage::movedBytes() const {
+    return mMovedBytes;
+}
+
+
+
+/* Word */
+Word::Word(WordStorage *storage) :
+    mStorage(storage ? storage : new GapBufferStorage()),
+    mHasFirstSymbol(false), mHasLastSymbol(false) {}
+
+
+Word::~Word() {
+    delete mStorage;
+}
+
+
+void Word::setStorage(WordStorage *storage) {
+
+    /* Replaces the storage of symbols by @storage (the word owns it).
+     * The word becomes empty. */
+
+#ifndef NDEBUG
+    assert(storage);
+#endif
+
+    delete mStorage;
+    mStorage = storage;
+    mHasFirstSymbol = mHasLastSymbol = false;
+}
+
+
+std::size_t Word::size() const {
+    return mStorage->size() + (mHasFirstSymbol ? 1 : 0) + (mHasLastSymbol ? 1 : 0);
+}
+
+
+bool Word::empty() const {
+    return size() == 0;
+}
+
+
+char Word::at(std::size_t pos) const {
+
+    /* Returns symbol at @pos, including system symbols.
+     * Throws std::out_of_range as std::string::at() does. */
+
+    if (pos >= size())
+        throw std::out_of_range("Word::at");
+
+    if (mHasFirstSymbol) {
+        if (pos == 0)
+            return '!';
+        --pos;
+    }
+
+    if (pos < mStorage->size())
+        return mStorage->at(pos);
+
+    return '@';
+}
+
+
+void Word::assign(const char *data, std::size_t size) {
+
+    /* Replaces the word by @data. All symbols of @data are stored as is. */
+
+    mStorage->assign(data, size);
+    mHasFirstSymbol = mHasLastSymbol = false;
+}
+
+
+void Word::assign(const std::string &str) {
+    assign(str.data(), str.size());
+}
+
+
+void Word::materializeSystemSymbols(std::size_t pos, std::size_t length) {
+
+    /* Insertion of new symbols before virtual "!" (or after virtual "@")
+     * moves the system symbol inside of the word, so it must be stored. */
+
+    if (length != 0)
+        return;
+
+    if (mHasFirstSymbol && pos == 0) {
+        mStorage->replace(0, 0, "!", 1);
+        mHasFirstSymbol = false;
+    }
+    else if (mHasLastSymbol && pos == size()) {
+        mStorage->replace(mStorage->size(), 0, "@", 1);
+        mHasLastSymbol = false;
+    }
+}
+
+
+void Word::replace(std::size_t pos, std::size_t length, const char *data, std::size_t size) {
+
+    /* Replaces @length symbols at @pos by @size symbols of @data.
+     * If the replaced part covers virtual system symbol - the symbol is removed. */
+
+    if (pos > this->size())
+        throw std::out_of_range("Word::replace");
+
+    length = std::min(length, this->size() - pos);
+    materializeSystemSymbols(pos, length);
+
+    if (mHasFirstSymbol) {
+        if (pos == 0 && length > 0) {
+            mHasFirstSymbol = false;
+            --length;
+        }
+        else
+            --pos;
+    }
+
+    if (mHasLastSymbol && length > 0 && pos + length > mStorage->size()) {
+        mHasLastSymbol = false;
+        --length;
+    }
+
+    mStorage->replace(pos, length, data, size);
+}
+
+
+void Word::replace(std::size_t pos, std::size_t length, const std::string &str) {
+    replace(pos, length, str.data(), str.size());
+}
+
+
+void Word::erase(std::size_t pos, std::size_t length) {
+    replace(pos, length, "", 0);
+}
+
+
+void Word::addFirstSymbol() {
+
+    /* Inserts "!" at the beginning of the word. */
+
+    if (mHasFirstSymbol)
+        mStorage->replace(0, 0, "!", 1);
+    mHasFirstSymbol = true;
+}
+
+
+void Word::addLastSymbol() {
+
+    /* Appends "@" to the end of the word. */
+
+    if (mHasLastSymbol)
+        mStorage->replace(mStorage->size(), 0, "@", 1);
+    mHasLastSymbol = true;
+}
+
+
+bool Word::compare(std::size_t pos, const char *pattern, std::size_t length) const {
+
+    /* Returns true if @length symbols of @pattern occur in the word at @pos. */
+
+    if (pos > size() || length > size() - pos)
+        return false;
+
+    if (length == 0)
+        return true;
+
+    const char *data = pattern;
+
+    if (mHasFirstSymbol) {
+        if (pos == 0) {
+            if (length && *data != '!')
+                return false;
+            ++data;
+            --length;
+        }
+        else
+            --pos;
+    }
+
+    std::size_t stored = std::min(length, mStorage->size() - pos);
+    if (stored && ! mStorage->compare(pos, data, stored))
+        return false;
+
+    /* Only "@" can be left. */
+    if (length > stored)
+        return data[stored] == '@';
+
+    return true;
+}
+
+
+bool Word::compare(std::size_t pos, const std::string &pattern) const {
+    return compare(pos, pattern.data(), pattern.size());
+}
+
+
+std::size_t Word::find(const char *pattern, std::size_t length, std::size_t from, std::size_t lastStart) const {
+
+    /* Returns the leftmost occurrence of @pattern, that starts in [from, lastStart], or npos.
+     * Occurrence may start at virtual "!" (only at 0), lie in stored symbols,
+     * or end at virtual "@" (only at size - length) - they are checked in this order. */
+
+
+    const std::size_t wordSize = size();
+    if (length == 0 || length > wordSize)
+        return std::string::npos;
+
+    lastStart = std::min(lastStart, wordSize - length);
+    if (from > lastStart)
+        return std::string::npos;
+
+    const std::size_t first = mHasFirstSymbol ? 1 : 0;
+    if (first && from == 0 && compare(0, pattern, length))
+        return 0;
+
+    /* Occurrences inside of stored symbols: logical positions [first, first + stored - length]. */
+    const std::size_t stored = mStorage->size();
+    if (stored >= length && lastStart >= first) {
+        std::size_t storedFrom = std::max(from, first) - first;
+        std::size_t storedLast = std::min(lastStart - first, stored - length);
+        if (storedFrom <= storedLast) {
+            std::size_t found = mStorage->find(pattern, length, storedFrom, storedLast);
+            if (found != std::string::npos)
+                return found + first;
+        }
+    }
+
+    if (mHasLastSymbol) {
+        std::size_t pos = wordSize - length;
+        if (pos >= from && pos <= lastStart && !(first && pos == 0) && compare(pos, pattern, length))
+            return pos;
+    }
+
+    return std::string::npos;
+}
+
+
+std::size_t Word::find(const std::string &pattern, std::size_t from, std::size_t lastStart) const {
+    return find(pattern.data(), pattern.size(), from, lastStart);
+}
+
+
+bool Word::scan(WordChunkVisitor &visitor) const {
+
+    /* Passes the whole word, including system symbols, to @visitor chunk by chunk.
+     * Returns false if @visitor stopped the scanning. */
+
+    return scan(0, size(), visitor);
+}
+
+
+bool Word::scan(std::size_t from, std::size_t to, WordChunkVisitor &visitor) const {
+
+    /* Passes symbols [from, to) of the word, including system symbols, to @visitor.
+     * Scanning does not change the gap buffer, so several threads may scan parts of one word
+     * (run-length storage moves its cursor and can't be scanned concurrently). */
+
+#ifndef NDEBUG
+    assert(from <= to && to <= size());
+#endif
+
+    const std::size_t first = mHasFirstSymbol ? 1 : 0;
+    const std::size_t end = first + mStorage->size();
+
+    if (from < to && from < first) {
+        if (! visitor.visit("!", 1))
+            return false;
+        from = first;
+    }
+
+    if (from < to && from < end) {
+        const std::size_t last = std::min(to, end);
+        if (! mStorage->scan(from - first, last - first, visitor))
+            return false;
+        from = last;
+    }
+
+    if (from < to && ! visitor.visit("@", 1))
+        return false;
+
+    return true;
+}
+
+
+namespace {
+
+class StringCollector : public WordChunkVisitor {
+public:
+    StringCollector(std::string &str) : mStr(str) {}
+    bool visit(const char *chunk, std::size_t size) { mStr.append(chunk, size); return true; }
+    bool visitRun(char symbol, std::size_t count) { mStr.append(count, symbol); return true; }
+
+private:
+    std::string &mStr;
+};
+
+
+class StreamWriter : public WordChunkVisitor {
+public:
+    StreamWriter(std::ostream &stream) : mStream(stream) {}
+    bool visit(const char *chunk, std::size_t size) { mStream.write(chunk, size); return true; }
+
+private:
+    std::ostream &mStream;
+};
+
+}
+
+
+void Word::setHashing(bool isEnabled) {
+
+    /* Enables rolling hash of the word (see hash()).
+     * While it is enabled every edit costs a bit more. */
+
+    mStorage->setHashing(isEnabled);
+}
+
+
+uint64_t Word::hash() const {
+
+    /* Returns rolling hash of the whole word, including system symbols.
+     * Equal words have equal hashes, whether system symbols are virtual or stored. */
+
+    uint64_t hash = 0, power = 1;
+    if (mHasFirstSymbol) {
+        hash = RollingHash::value('!');
+        power = RollingHash::BASE;
+    }
+
+    hash += power * mStorage->hash();
+    power *= mStorage->power();
+
+    if (mHasLastSymbol)
+        hash += power * RollingHash::value('@');
+
+    return hash;
+}
+
+
+uint64_t Word::movedBytes() const {
+
+    /* Returns the number of bytes, written or moved by the storage (see WordStorage::movedBytes()).
+     * Only the difference between two calls is meaningful: the storage may be replaced. */
+
+    return mStorage->movedBytes();
+}
+
+
+std::string Word::str() const {
+
+    /* Returns copy of the whole word, including system symbols. */
+
+    std::string result;
+    result.reserve(size());
+    appendTo(result);
+    return result;
+}
+
+
+void Word::appendTo(std::string &str) const {
+
+    /* Appends the whole word, including system symbols, to @str. */
+
+    StringCollector collector(str);
+    scan(collector);
+}
+
+
+std::ostream& operator<<(std::ostream &stream, const Word &word) {
+    StreamWriter writer(stream);
+    word.scan(writer);
+    return stream;
+}
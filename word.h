@@ -0,0 +1,207 @@
+#ifndef WORD_H
+#define WORD_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <stdint.h>
+
+
+/* Receives the word as a sequence of contiguous chunks. */
+class WordChunkVisitor {
+public:
+    virtual ~WordChunkVisitor() {}
+
+    /* Returns false to stop the scanning. */
+    virtual bool visit(const char *chunk, std::size_t size) = 0;
+
+    /* Receives @count repetitions of @symbol. By default they are passed to visit() by chunks. */
+    virtual bool visitRun(char symbol, std::size_t count);
+};
+
+
+/* Storage of the word symbols (without system symbols).
+ * Positions are counted from the first stored symbol. */
+class WordStorage {
+public:
+    virtual ~WordStorage() {}
+
+    virtual std::size_t size() const = 0;
+    virtual char at(std::size_t pos) const = 0;
+
+    virtual void assign(const char *data, std::size_t size) = 0;
+    virtual void replace(std::size_t pos, std::size_t length, const char *data, std::size_t size) = 0;
+
+    virtual bool compare(std::size_t pos, const char *data, std::size_t size) const = 0;
+    virtual std::size_t find(const char *pattern, std::size_t length,
+                             std::size_t from, std::size_t lastStart) const = 0;
+    virtual bool scan(std::size_t from, std::size_t to, WordChunkVisitor &visitor) const = 0;
+
+    /* Rolling hash of stored symbols (see RollingHash), kept up to date by every edit
+     * while hashing is enabled; power() is BASE^size(). */
+    virtual void setHashing(bool isEnabled) = 0;
+    virtual uint64_t hash() const = 0;
+    virtual uint64_t power() const = 0;
+
+    /* Number of bytes, written or moved by edits since the storage was created (for profiling). */
+    virtual uint64_t movedBytes() const = 0;
+};
+
+
+/* Gap buffer: symbols are stored in one buffer with a gap at the place of the last edit.
+ * Edit costs the size of the edit plus the distance from the previous edit.
+ * Hash is kept as two parts - before and after the gap, so it is updated
+ * only for the symbols, that are moved or edited. */
+class GapBufferStorage : public WordStorage {
+public:
+    GapBufferStorage();
+
+    std::size_t size() const;
+    char at(std::size_t pos) const;
+
+    void assign(const char *data, std::size_t size);
+    void replace(std::size_t pos, std::size_t length, const char *data, std::size_t size);
+
+    bool compare(std::size_t pos, const char *data, std::size_t size) const;
+    std::size_t find(const char *pattern, std::size_t length,
+                     std::size_t from, std::size_t lastStart) const;
+    bool scan(std::size_t from, std::size_t to, WordChunkVisitor &visitor) const;
+
+    void setHashing(bool isEnabled);
+    uint64_t hash() const;
+    uint64_t power() const;
+
+    uint64_t movedBytes() const;
+
+private:
+    void moveGap(std::size_t pos);
+    void reserveGap(std::size_t size);
+
+private:
+    std::vector<char> mBuffer;
+    std::size_t mGapBegin, mGapEnd;
+
+    bool mIsHashing;
+    uint64_t mBeforeHash, mBeforePower;     /* of the symbols before the gap */
+    uint64_t mAfterHash, mAfterPower;       /* of the symbols after the gap */
+
+    uint64_t mMovedBytes;
+};
+
+
+/* Run-length encoding: the word is stored as runs of equal symbols (symbol, count),
+ * adjacent runs always have different symbols. Words like "1111...1*11...1" take a few runs,
+ * so search and edits cost the number of runs (and the pattern length),
+ * not the number of symbols. Runs are found from the run of the last access.
+ * Hash of the word is kept with the hash of the symbols before the last edit, like the hash
+ * before the gap of GapBufferStorage, so it is patched by the edit and by the runs
+ * between the previous edit and this one. */
+class RunLengthStorage : public WordStorage {
+public:
+    RunLengthStorage();
+
+    std::size_t size() const;
+    char at(std::size_t pos) const;
+
+    void assign(const char *data, std::size_t size);
+    void replace(std::size_t pos, std::size_t length, const char *data, std::size_t size);
+
+    bool compare(std::size_t pos, const char *data, std::size_t size) const;
+    std::size_t find(const char *pattern, std::size_t length,
+                     std::size_t from, std::size_t lastStart) const;
+    bool scan(std::size_t from, std::size_t to, WordChunkVisitor &visitor) const;
+
+    void setHashing(bool isEnabled);
+    uint64_t hash() const;
+    uint64_t power() const;
+
+    uint64_t movedBytes() const;
+
+private:
+    struct Run {
+        std::size_t count;
+        char symbol;
+    };
+
+    static void encode(const char *data, std::size_t size, std::vector<Run> &runs);
+    std::size_t locate(std::size_t pos) const;
+    std::size_t split(std::size_t pos);
+    void merge(std::size_t index);
+    void moveEdit(std::size_t index, std::size_t start);
+
+private:
+    std::vector<Run> mRuns;
+    std::size_t mSize;
+    uint64_t mMovedBytes;
+
+    bool mIsHashing;
+    uint64_t mHash, mPower;                 /* of the whole word */
+
+    /* The run of the last edit, its first position and hash of the symbols before it. */
+    std::size_t mEditRun;
+    std::size_t mEditStart;
+    uint64_t mEditHash, mEditPower;
+
+    /* The run of the last access and its first position. */
+    mutable std::size_t mCursorRun;
+    mutable std::size_t mCursorStart;
+
+    /* Buffers of replace() and find(). */
+    std::vector<Run> mInserted;
+    mutable std::vector<Run> mPattern;
+};
+
+
+/* Source word of the algorithm.
+ * System symbols "!" (first) and "@" (last) are virtual: they are not stored,
+ * so adding them costs nothing, but they can be matched and replaced like any other symbol. */
+class Word {
+public:
+    Word(WordStorage *storage = 0);
+    ~Word();
+
+    void setStorage(WordStorage *storage);
+
+    std::size_t size() const;
+    bool empty() const;
+    char at(std::size_t pos) const;
+
+    void assign(const char *data, std::size_t size);
+    void assign(const std::string &str);
+    void replace(std::size_t pos, std::size_t length, const char *data, std::size_t size);
+    void replace(std::size_t pos, std::size_t length, const std::string &str);
+    void erase(std::size_t pos, std::size_t length);
+    void addFirstSymbol();
+    void addLastSymbol();
+
+    bool compare(std::size_t pos, const char *pattern, std::size_t length) const;
+    bool compare(std::size_t pos, const std::string &pattern) const;
+    std::size_t find(const char *pattern, std::size_t length, std::size_t from = 0,
+                     std::size_t lastStart = std::string::npos) const;
+    std::size_t find(const std::string &pattern, std::size_t from = 0,
+                     std::size_t lastStart = std::string::npos) const;
+    bool scan(WordChunkVisitor &visitor) const;
+    bool scan(std::size_t from, std::size_t to, WordChunkVisitor &visitor) const;
+
+    void setHashing(bool isEnabled);
+    uint64_t hash() const;
+    uint64_t movedBytes() const;
+
+    std::string str() const;
+    void appendTo(std::string &str) const;
+
+private:
+    Word(const Word &);
+    Word& operator=(const Word &);
+
+    void materializeSystemSymbols(std::size_t pos, std::size_t length);
+
+private:
+    WordStorage *mStorage;
+    bool mHasFirstSymbol, mHasLastSymbol;
+};
+
+std::ostream& operator<<(std::ostream &stream, const Word &word);
+
+
+#endif // WORD_H